@@ -0,0 +1,426 @@
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Library General Public
+// License as published by the Free Software Foundation; either
+// version 2 of the License, or (at your option) any later version.
+//
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Library General Public License for more details.
+//
+// You should have received a copy of the GNU Library General Public
+// License along with this library; if not, write to the
+// Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+// Boston, MA 02110-1335, USA.
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+
+use criterion::{
+    black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput,
+};
+
+use gstthreadshare::jitterbuffer::jitterbuffer::{
+    RTPJitterBuffer, RTPJitterBufferItem, RTPJitterBufferMode, RTPPacketRateCtx,
+};
+
+const CLOCK_RATE: u32 = 8000;
+const SAMPLES_PER_PACKET: u32 = 160;
+const PACKET_DURATION: gst::ClockTime = gst::ClockTime::from_mseconds(20);
+// Close to the wrap around so that all traces go through it
+const FIRST_SEQNUM: u16 = 65_000;
+
+// Gaps and timestamp jumps happen every that many packets
+const EVENT_PERIOD: usize = 1024;
+const GAP_PACKETS: u16 = 500;
+// Well above the 3 s that make the jitterbuffer reset its skew
+const JUMP_SECONDS: u32 = 10;
+
+// The larger size keeps more than 10k packets queued in the insert and pop runs
+const SIZES: [usize; 2] = [256, 16_384];
+const POP_BATCH: usize = 64;
+const INSERT_BATCH: usize = 32;
+// Default max-dropout-time and max-misorder-time of the element
+const MAX_DROPOUT_MS: i32 = 60_000;
+const MAX_MISORDER_MS: i32 = 2_000;
+
+#[derive(Clone, Copy)]
+struct Packet {
+    seqnum: u16,
+    rtptime: u32,
+    dts: gst::ClockTime,
+}
+
+impl Packet {
+    fn pts(&self) -> gst::ClockTime {
+        gst::ClockTime::from_nseconds(
+            self.rtptime as u64 * gst::ClockTime::SECOND.nseconds() / CLOCK_RATE as u64,
+        )
+    }
+}
+
+#[derive(Clone, Copy, Debug)]
+enum Trace {
+    InOrder,
+    // Packets arrive reversed in groups of that many
+    Reordered(usize),
+    // Every fourth packet arrives twice
+    Duplicates,
+    Gaps,
+    TsJumps,
+}
+
+const TRACES: [Trace; 6] = [
+    Trace::InOrder,
+    Trace::Reordered(4),
+    Trace::Reordered(32),
+    Trace::Duplicates,
+    Trace::Gaps,
+    Trace::TsJumps,
+];
+
+impl Trace {
+    fn name(&self) -> String {
+        match self {
+            Trace::InOrder => "in-order".to_string(),
+            Trace::Reordered(depth) => format!("reordered-{}", depth),
+            Trace::Duplicates => "duplicates".to_string(),
+            Trace::Gaps => "gaps".to_string(),
+            Trace::TsJumps => "ts-jumps".to_string(),
+        }
+    }
+
+    // Returns `n_packets` distinct packets in arrival order, the arrival time
+    // always increases by one packet duration
+    fn packets(&self, n_packets: usize) -> Vec<Packet> {
+        let mut packets = Vec::with_capacity(n_packets + n_packets / 4);
+        let mut seqnum = FIRST_SEQNUM;
+        let mut rtptime = 0u32;
+
+        for i in 0..n_packets {
+            if i > 0 && i % EVENT_PERIOD == 0 {
+                match self {
+                    Trace::Gaps => {
+                        seqnum = seqnum.wrapping_add(GAP_PACKETS);
+                        rtptime = rtptime.wrapping_add(GAP_PACKETS as u32 * SAMPLES_PER_PACKET);
+                    }
+                    Trace::TsJumps => {
+                        rtptime = rtptime.wrapping_add(JUMP_SECONDS * CLOCK_RATE);
+                    }
+                    _ => (),
+                }
+            }
+
+            packets.push(Packet {
+                seqnum,
+                rtptime,
+                dts: gst::ClockTime::ZERO,
+            });
+            if let Trace::Duplicates = self {
+                if i % 4 == 0 {
+                    packets.push(packets[packets.len() - 1]);
+                }
+            }
+
+            seqnum = seqnum.wrapping_add(1);
+            rtptime = rtptime.wrapping_add(SAMPLES_PER_PACKET);
+        }
+
+        if let Trace::Reordered(depth) = *self {
+            for group in packets.chunks_mut(depth) {
+                group.reverse();
+            }
+        }
+
+        for (i, packet) in packets.iter_mut().enumerate() {
+            packet.dts = PACKET_DURATION * i as u64;
+        }
+
+        packets
+    }
+}
+
+fn new_jitterbuffer() -> RTPJitterBuffer {
+    let jb = RTPJitterBuffer::new();
+    jb.set_mode(RTPJitterBufferMode::Slave);
+    jb.set_clock_rate(CLOCK_RATE);
+    jb.set_delay(gst::ClockTime::from_mseconds(200));
+
+    jb
+}
+
+fn new_items(jb: &RTPJitterBuffer, packets: &[Packet]) -> Vec<RTPJitterBufferItem> {
+    packets
+        .iter()
+        .map(|packet| {
+            RTPJitterBufferItem::new(
+                jb,
+                gst::Buffer::new(),
+                packet.dts,
+                packet.pts(),
+                Some(packet.seqnum),
+                packet.rtptime,
+            )
+        })
+        .collect()
+}
+
+fn filled_jitterbuffer(packets: &[Packet]) -> RTPJitterBuffer {
+    let jb = new_jitterbuffer();
+    for item in new_items(&jb, packets) {
+        jb.insert(item);
+    }
+
+    jb
+}
+
+fn calculate_pts(c: &mut Criterion) {
+    gst::init().unwrap();
+
+    let mut group = c.benchmark_group("calculate_pts");
+    for trace in TRACES {
+        for n_packets in SIZES {
+            let packets = trace.packets(n_packets);
+            group.throughput(Throughput::Elements(packets.len() as u64));
+            group.bench_with_input(
+                BenchmarkId::new(trace.name(), n_packets),
+                &packets,
+                |b, packets| {
+                    b.iter_batched(
+                        new_jitterbuffer,
+                        |jb| {
+                            for packet in packets {
+                                black_box(jb.calculate_pts(
+                                    packet.dts,
+                                    false,
+                                    packet.rtptime,
+                                    gst::ClockTime::ZERO,
+                                    0,
+                                    false,
+                                ));
+                            }
+                            jb
+                        },
+                        BatchSize::SmallInput,
+                    )
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+fn insert(c: &mut Criterion) {
+    gst::init().unwrap();
+
+    let mut group = c.benchmark_group("insert");
+    for trace in TRACES {
+        for n_packets in SIZES {
+            let packets = trace.packets(n_packets);
+            group.throughput(Throughput::Elements(packets.len() as u64));
+            group.bench_with_input(
+                BenchmarkId::new(trace.name(), n_packets),
+                &packets,
+                |b, packets| {
+                    b.iter_batched(
+                        || {
+                            let jb = new_jitterbuffer();
+                            let items = new_items(&jb, packets);
+                            (jb, items)
+                        },
+                        |(jb, items)| {
+                            for item in items {
+                                black_box(jb.insert(item));
+                            }
+                            jb
+                        },
+                        BatchSize::SmallInput,
+                    )
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+fn insert_list(c: &mut Criterion) {
+    gst::init().unwrap();
+
+    let mut group = c.benchmark_group("insert_list");
+    for trace in TRACES {
+        for n_packets in SIZES {
+            let packets = trace.packets(n_packets);
+            group.throughput(Throughput::Elements(packets.len() as u64));
+            group.bench_with_input(
+                BenchmarkId::new(trace.name(), n_packets),
+                &packets,
+                |b, packets| {
+                    b.iter_batched(
+                        || {
+                            let jb = new_jitterbuffer();
+                            let lists = packets
+                                .chunks(INSERT_BATCH)
+                                .map(|packets| new_items(&jb, packets))
+                                .collect::<Vec<_>>();
+                            (jb, lists)
+                        },
+                        |(jb, lists)| {
+                            for items in lists {
+                                black_box(jb.insert_list(items));
+                            }
+                            jb
+                        },
+                        BatchSize::SmallInput,
+                    )
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+fn pop(c: &mut Criterion) {
+    gst::init().unwrap();
+
+    let mut group = c.benchmark_group("pop");
+    for trace in TRACES {
+        for n_packets in SIZES {
+            let packets = trace.packets(n_packets);
+            group.throughput(Throughput::Elements(packets.len() as u64));
+            group.bench_with_input(
+                BenchmarkId::new(trace.name(), n_packets),
+                &packets,
+                |b, packets| {
+                    b.iter_batched(
+                        || filled_jitterbuffer(packets),
+                        |jb| {
+                            let mut items = Vec::with_capacity(packets.len());
+                            while let (Some(item), _) = jb.pop() {
+                                items.push(item);
+                            }
+                            (jb, items)
+                        },
+                        BatchSize::SmallInput,
+                    )
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+fn pop_ready(c: &mut Criterion) {
+    gst::init().unwrap();
+
+    let mut group = c.benchmark_group("pop_ready");
+    for trace in TRACES {
+        for n_packets in SIZES {
+            let packets = trace.packets(n_packets);
+            group.throughput(Throughput::Elements(packets.len() as u64));
+            group.bench_with_input(
+                BenchmarkId::new(trace.name(), n_packets),
+                &packets,
+                |b, packets| {
+                    b.iter_batched(
+                        || filled_jitterbuffer(packets),
+                        |jb| {
+                            let mut items = Vec::with_capacity(packets.len());
+                            loop {
+                                let (batch, _) = jb.pop_ready(None, POP_BATCH);
+                                if batch.is_empty() {
+                                    break;
+                                }
+                                items.extend(batch);
+                            }
+                            (jb, items)
+                        },
+                        BatchSize::SmallInput,
+                    )
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+fn new_packet_rate_ctx() -> RTPPacketRateCtx {
+    let mut ctx = RTPPacketRateCtx::new();
+    ctx.reset(CLOCK_RATE as i32);
+
+    ctx
+}
+
+fn packet_rate(c: &mut Criterion) {
+    let mut group = c.benchmark_group("packet_rate");
+    for trace in TRACES {
+        let packets = trace.packets(SIZES[1]);
+        group.throughput(Throughput::Elements(packets.len() as u64));
+        group.bench_with_input(
+            BenchmarkId::new("update", trace.name()),
+            &packets,
+            |b, packets| {
+                b.iter_batched(
+                    new_packet_rate_ctx,
+                    |mut ctx| {
+                        for packet in packets {
+                            ctx.update(packet.seqnum, packet.rtptime);
+                            black_box(ctx.max_dropout(MAX_DROPOUT_MS));
+                            black_box(ctx.max_misorder(MAX_MISORDER_MS));
+                        }
+                        ctx
+                    },
+                    BatchSize::SmallInput,
+                )
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("update_list", trace.name()),
+            &packets,
+            |b, packets| {
+                b.iter_batched(
+                    new_packet_rate_ctx,
+                    |mut ctx| {
+                        for packets in packets.chunks(INSERT_BATCH) {
+                            for thresholds in ctx.update_list(
+                                packets.iter().map(|packet| (packet.seqnum, packet.rtptime)),
+                                MAX_DROPOUT_MS,
+                                MAX_MISORDER_MS,
+                            ) {
+                                black_box(thresholds);
+                            }
+                        }
+                        ctx
+                    },
+                    BatchSize::SmallInput,
+                )
+            },
+        );
+    }
+    group.finish();
+}
+
+fn find_earliest(c: &mut Criterion) {
+    gst::init().unwrap();
+
+    let mut group = c.benchmark_group("find_earliest");
+    for trace in TRACES {
+        for n_packets in SIZES {
+            let jb = filled_jitterbuffer(&trace.packets(n_packets));
+            group.bench_function(BenchmarkId::new(trace.name(), n_packets), |b| {
+                b.iter(|| black_box(jb.find_earliest()))
+            });
+        }
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    calculate_pts,
+    insert,
+    insert_list,
+    pop,
+    pop_ready,
+    packet_rate,
+    find_earliest
+);
+criterion_main!(benches);
@@ -16,6 +16,10 @@ fn main() {
     build.define("RTPJitterBufferClass", "TsRTPJitterBufferClass");
     build.define("RTPJitterBufferPrivate", "TsRTPJitterBufferClass");
 
+    if std::env::var_os("CARGO_FEATURE_TUNING").is_some() {
+        build.define("RTP_JITTER_BUFFER_TUNING", None);
+    }
+
     build.compile("libthreadshare-c.a");
 
     println!("cargo:rustc-link-lib=dylib=gstrtp-1.0");
@@ -102,7 +102,13 @@ fn main() {
                     .build()
                     .unwrap();
 
-                (source, None)
+                if is_rtp {
+                    // The jitterbuffer still needs a context to run on
+                    source.set_property("caps", &rtp_caps);
+                    (source, Some(build_context()))
+                } else {
+                    (source, None)
+                }
             }
             "ts-udpsrc" => {
                 let context = build_context();
@@ -21,7 +21,7 @@ use glib::ffi::{gboolean, gpointer, GList, GType};
 use gst::glib;
 
 use gst::ffi::GstClockTime;
-use libc::{c_int, c_uint, c_ulonglong, c_ushort, c_void};
+use libc::{c_int, c_uchar, c_uint, c_ulonglong, c_ushort, c_void};
 
 #[repr(C)]
 #[derive(Copy, Clone)]
@@ -35,11 +35,32 @@ pub struct RTPJitterBufferItem {
     pub seqnum: c_uint,
     pub count: c_uint,
     pub rtptime: c_uint,
+    pub heap_index: c_uint,
+    pub size: c_uint,
 }
 
 #[repr(C)]
 pub struct RTPJitterBuffer(c_void);
 
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct RTPReciprocal {
+    divisor: c_ulonglong,
+    magic: c_ulonglong,
+    shift: c_uchar,
+    add: gboolean,
+}
+
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct RTPTimeScale {
+    clock_rate: c_uint,
+    num: RTPReciprocal,
+    denom: RTPReciprocal,
+    max_time_quot: c_ulonglong,
+    max_rtp_quot: c_ulonglong,
+}
+
 #[repr(C)]
 #[derive(Copy, Clone)]
 pub struct RTPPacketRateCtx {
@@ -47,7 +68,59 @@ pub struct RTPPacketRateCtx {
     clock_rate: c_int,
     last_seqnum: c_ushort,
     last_ts: c_ulonglong,
-    avg_packet_rate: c_uint,
+    pub avg_packet_rate: c_uint,
+    scale: RTPTimeScale,
+    dropout: RTPPacketRateThreshold,
+    misorder: RTPPacketRateThreshold,
+}
+
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct RTPPacketRateThreshold {
+    time_ms: c_int,
+    packet_rate: c_uint,
+    value: c_uint,
+}
+
+#[repr(C)]
+#[derive(Copy, Clone, Default)]
+pub struct RTPPacketRateEntry {
+    pub seqnum: c_ushort,
+    pub ts: c_uint,
+    pub max_dropout: c_uint,
+    pub max_misorder: c_uint,
+}
+
+pub const RTP_JITTER_BUFFER_MAX_WINDOW: usize = 512;
+
+#[repr(C)]
+#[derive(Copy, Clone)]
+pub struct RTPJitterBufferSnapshot {
+    pub clock_rate: c_uint,
+    pub base_time: GstClockTime,
+    pub base_rtptime: GstClockTime,
+    pub base_extrtp: c_ulonglong,
+    pub ext_rtptime: c_ulonglong,
+    pub skew: i64,
+    pub jitter: c_ulonglong,
+    pub window_size: c_uint,
+    pub window: [i64; RTP_JITTER_BUFFER_MAX_WINDOW],
+}
+
+#[cfg(feature = "tuning")]
+pub const RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS: usize = 16;
+
+#[cfg(feature = "tuning")]
+#[repr(C)]
+#[derive(Copy, Clone, Debug, Default)]
+pub struct RTPJitterBufferTuningStats {
+    pub insert_walk: [u64; RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS],
+    pub reorder_distance: [u64; RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS],
+    pub queue_depth: [u64; RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS],
+    pub num_resyncs: u64,
+    pub num_skew_resets: u64,
+    pub skew: i64,
+    pub window_min: i64,
 }
 
 pub type RTPJitterBufferMode = c_int;
@@ -55,6 +128,12 @@ pub const RTP_JITTER_BUFFER_MODE_NONE: RTPJitterBufferMode = 0;
 pub const RTP_JITTER_BUFFER_MODE_SLAVE: RTPJitterBufferMode = 1;
 pub const RTP_JITTER_BUFFER_MODE_BUFFER: RTPJitterBufferMode = 2;
 pub const RTP_JITTER_BUFFER_MODE_SYNCED: RTPJitterBufferMode = 4;
+pub const RTP_JITTER_BUFFER_MODE_PASSTHROUGH: RTPJitterBufferMode = 5;
+
+pub type RTPJitterBufferInsertResult = c_int;
+pub const RTP_JITTER_BUFFER_INSERT_OK: RTPJitterBufferInsertResult = 0;
+pub const RTP_JITTER_BUFFER_INSERT_DUPLICATE: RTPJitterBufferInsertResult = 1;
+pub const RTP_JITTER_BUFFER_INSERT_OUT_OF_RANGE: RTPJitterBufferInsertResult = 2;
 
 extern "C" {
     pub fn rtp_jitter_buffer_new() -> *mut RTPJitterBuffer;
@@ -67,11 +146,38 @@ extern "C" {
     pub fn rtp_jitter_buffer_get_delay(jbuf: *mut RTPJitterBuffer) -> GstClockTime;
     pub fn rtp_jitter_buffer_set_delay(jbuf: *mut RTPJitterBuffer, delay: GstClockTime);
     pub fn rtp_jitter_buffer_set_clock_rate(jbuf: *mut RTPJitterBuffer, clock_rate: c_uint);
+    pub fn rtp_jitter_buffer_set_skew_window(
+        jbuf: *mut RTPJitterBuffer,
+        size: c_uint,
+        time: GstClockTime,
+    );
     #[allow(dead_code)]
     pub fn rtp_jitter_buffer_get_clock_rate(jbuf: *mut RTPJitterBuffer) -> c_uint;
     pub fn rtp_jitter_buffer_reset_skew(jbuf: *mut RTPJitterBuffer);
+    pub fn rtp_jitter_buffer_get_skew(jbuf: *mut RTPJitterBuffer) -> i64;
+    pub fn rtp_jitter_buffer_get_jitter(jbuf: *mut RTPJitterBuffer) -> GstClockTime;
+    pub fn rtp_jitter_buffer_get_snapshot(
+        jbuf: *mut RTPJitterBuffer,
+        snapshot: *mut RTPJitterBufferSnapshot,
+    ) -> gboolean;
+    pub fn rtp_jitter_buffer_set_snapshot(
+        jbuf: *mut RTPJitterBuffer,
+        snapshot: *const RTPJitterBufferSnapshot,
+    ) -> gboolean;
 
-    pub fn rtp_jitter_buffer_flush(jbuf: *mut RTPJitterBuffer, free_func: glib::ffi::GFunc);
+    pub fn rtp_jitter_buffer_alloc_item(jbuf: *mut RTPJitterBuffer) -> *mut RTPJitterBufferItem;
+    pub fn rtp_jitter_buffer_free_item(jbuf: *mut RTPJitterBuffer, item: *mut RTPJitterBufferItem);
+    pub fn rtp_jitter_buffer_get_pool_stats(
+        jbuf: *mut RTPJitterBuffer,
+        n_free: *mut c_uint,
+        high_water: *mut c_uint,
+    );
+
+    pub fn rtp_jitter_buffer_flush(
+        jbuf: *mut RTPJitterBuffer,
+        free_func: glib::ffi::GFunc,
+        user_data: gpointer,
+    );
     pub fn rtp_jitter_buffer_find_earliest(
         jbuf: *mut RTPJitterBuffer,
         pts: *mut GstClockTime,
@@ -92,11 +198,47 @@ extern "C" {
         head: *mut gboolean,
         percent: *mut c_int,
     ) -> gboolean;
+    pub fn rtp_jitter_buffer_insert_list(
+        jbuf: *mut RTPJitterBuffer,
+        items: *mut *mut RTPJitterBufferItem,
+        n_items: c_uint,
+        results: *mut RTPJitterBufferInsertResult,
+        head: *mut gboolean,
+        percent: *mut c_int,
+    ) -> c_uint;
     pub fn rtp_jitter_buffer_pop(
         jbuf: *mut RTPJitterBuffer,
         percent: *mut c_int,
     ) -> *mut RTPJitterBufferItem;
+    pub fn rtp_jitter_buffer_pop_ready(
+        jbuf: *mut RTPJitterBuffer,
+        max_pts: GstClockTime,
+        items: *mut *mut RTPJitterBufferItem,
+        max_items: c_uint,
+        percent: *mut c_int,
+    ) -> c_uint;
     pub fn rtp_jitter_buffer_peek(jbuf: *mut RTPJitterBuffer) -> *mut RTPJitterBufferItem;
+    pub fn rtp_jitter_buffer_can_fast_start(
+        jbuf: *mut RTPJitterBuffer,
+        num_packet: c_int,
+    ) -> gboolean;
+    pub fn rtp_jitter_buffer_num_contiguous(jbuf: *mut RTPJitterBuffer, seqnum: c_int) -> c_uint;
+    pub fn rtp_jitter_buffer_is_full(jbuf: *mut RTPJitterBuffer) -> gboolean;
+    pub fn rtp_jitter_buffer_get_bytes(jbuf: *mut RTPJitterBuffer) -> u64;
+    pub fn rtp_jitter_buffer_get_ts_diff(jbuf: *mut RTPJitterBuffer) -> c_uint;
+    #[cfg(feature = "tuning")]
+    pub fn rtp_jitter_buffer_get_tuning_stats(
+        jbuf: *mut RTPJitterBuffer,
+        stats: *mut RTPJitterBufferTuningStats,
+    );
+
+    pub fn gst_rtp_time_scale_init(scale: *mut RTPTimeScale, clock_rate: c_uint);
+    pub fn gst_rtp_time_scale_to_time(
+        scale: *const RTPTimeScale,
+        rtptime: c_ulonglong,
+    ) -> GstClockTime;
+    pub fn gst_rtp_time_scale_to_rtp(scale: *const RTPTimeScale, time: GstClockTime)
+        -> c_ulonglong;
 
     pub fn gst_rtp_packet_rate_ctx_reset(ctx: *mut RTPPacketRateCtx, clock_rate: c_int);
     pub fn gst_rtp_packet_rate_ctx_update(
@@ -108,9 +250,15 @@ extern "C" {
         ctx: *mut RTPPacketRateCtx,
         time_ms: c_int,
     ) -> c_uint;
-    #[allow(dead_code)]
     pub fn gst_rtp_packet_rate_ctx_get_max_misorder(
         ctx: *mut RTPPacketRateCtx,
         time_ms: c_int,
     ) -> c_uint;
+    pub fn gst_rtp_packet_rate_ctx_update_list(
+        ctx: *mut RTPPacketRateCtx,
+        entries: *mut RTPPacketRateEntry,
+        n_entries: c_uint,
+        dropout_ms: c_int,
+        misorder_ms: c_int,
+    ) -> c_uint;
 }
@@ -24,48 +24,98 @@ use futures::prelude::*;
 use gst::glib;
 use gst::prelude::*;
 use gst::subclass::prelude::*;
-use gst_rtp::RTPBuffer;
 
 use once_cell::sync::Lazy;
 
 use std::cmp::Ordering;
-use std::collections::{BTreeSet, VecDeque};
+use std::collections::{BTreeSet, HashMap, VecDeque};
 use std::mem;
 use std::sync::Arc;
 use std::sync::Mutex as StdMutex;
+use std::sync::MutexGuard as StdMutexGuard;
 use std::time::Duration;
+#[cfg(feature = "tuning")]
+use std::time::Instant;
 
 use crate::runtime::prelude::*;
-use crate::runtime::{self, Context, PadSink, PadSrc, Task};
+use crate::runtime::timer_wheel::TimerWheel;
+use crate::runtime::{Context, PadSink, PadSrc, Task};
 
-use super::jitterbuffer::{RTPJitterBuffer, RTPJitterBufferItem, RTPPacketRateCtx};
+#[cfg(feature = "tuning")]
+use super::ffi;
+use super::jitterbuffer::{
+    RTPJitterBuffer, RTPJitterBufferInsertResult, RTPJitterBufferItem, RTPJitterBufferMode,
+    RTPJitterBufferSnapshot, RTPPacketHeader, RTPPacketRateCtx,
+};
+use super::{DropPolicy, Mode};
 
 const DEFAULT_LATENCY: gst::ClockTime = gst::ClockTime::from_mseconds(200);
+const DEFAULT_ADAPTIVE_LATENCY: bool = false;
+const DEFAULT_MIN_LATENCY: gst::ClockTime = gst::ClockTime::from_mseconds(20);
 const DEFAULT_DO_LOST: bool = false;
+const DEFAULT_COALESCE_LOST: bool = false;
 const DEFAULT_MAX_DROPOUT_TIME: u32 = 60000;
 const DEFAULT_MAX_MISORDER_TIME: u32 = 2000;
+const DEFAULT_SKEW_WINDOW_SIZE: u32 = 512;
+const DEFAULT_SKEW_WINDOW_TIME: gst::ClockTime = gst::ClockTime::from_seconds(2);
 const DEFAULT_CONTEXT: &str = "";
 const DEFAULT_CONTEXT_WAIT: gst::ClockTime = gst::ClockTime::ZERO;
+const DEFAULT_TIMER_GRANULARITY: gst::ClockTime = gst::ClockTime::from_mseconds(1);
+const DEFAULT_FASTSTART_MIN_PACKETS: u32 = 0;
+const DEFAULT_MAX_SIZE_BYTES: u32 = 0;
+const DEFAULT_MAX_SIZE_TIME: gst::ClockTime = gst::ClockTime::ZERO;
+const DEFAULT_DROP_POLICY: DropPolicy = DropPolicy::DropOldest;
+const DEFAULT_MODE: Mode = Mode::Slave;
+
+// Maximum number of packets pushed downstream at once
+const POP_BATCH_SIZE: usize = 64;
+
+// The adaptive latency only decreases once the network conditions were observed over
+// a whole period, and by at most one step per period
+const ADAPTIVE_LATENCY_PERIOD: gst::ClockTime = gst::ClockTime::from_seconds(1);
+const ADAPTIVE_LATENCY_SHRINK_STEP: gst::ClockTime = gst::ClockTime::from_mseconds(20);
 
 #[derive(Debug, Clone)]
 struct Settings {
     latency: gst::ClockTime,
+    adaptive_latency: bool,
+    min_latency: gst::ClockTime,
     do_lost: bool,
+    coalesce_lost: bool,
     max_dropout_time: u32,
     max_misorder_time: u32,
+    skew_window_size: u32,
+    skew_window_time: gst::ClockTime,
     context: String,
     context_wait: gst::ClockTime,
+    timer_granularity: gst::ClockTime,
+    faststart_min_packets: u32,
+    max_size_bytes: u32,
+    max_size_time: gst::ClockTime,
+    drop_policy: DropPolicy,
+    mode: Mode,
 }
 
 impl Default for Settings {
     fn default() -> Self {
         Settings {
             latency: DEFAULT_LATENCY,
+            adaptive_latency: DEFAULT_ADAPTIVE_LATENCY,
+            min_latency: DEFAULT_MIN_LATENCY,
             do_lost: DEFAULT_DO_LOST,
+            coalesce_lost: DEFAULT_COALESCE_LOST,
             max_dropout_time: DEFAULT_MAX_DROPOUT_TIME,
             max_misorder_time: DEFAULT_MAX_MISORDER_TIME,
+            skew_window_size: DEFAULT_SKEW_WINDOW_SIZE,
+            skew_window_time: DEFAULT_SKEW_WINDOW_TIME,
             context: DEFAULT_CONTEXT.into(),
             context_wait: DEFAULT_CONTEXT_WAIT,
+            timer_granularity: DEFAULT_TIMER_GRANULARITY,
+            faststart_min_packets: DEFAULT_FASTSTART_MIN_PACKETS,
+            max_size_bytes: DEFAULT_MAX_SIZE_BYTES,
+            max_size_time: DEFAULT_MAX_SIZE_TIME,
+            drop_policy: DEFAULT_DROP_POLICY,
+            mode: DEFAULT_MODE,
         }
     }
 }
@@ -78,12 +128,7 @@ struct GapPacket {
 }
 
 impl GapPacket {
-    fn new(buffer: gst::Buffer) -> Self {
-        let rtp_buffer = RTPBuffer::from_buffer_readable(&buffer).unwrap();
-        let seq = rtp_buffer.seq();
-        let pt = rtp_buffer.payload_type();
-        drop(rtp_buffer);
-
+    fn new(buffer: gst::Buffer, seq: u16, pt: u8) -> Self {
         Self { buffer, seq, pt }
     }
 }
@@ -106,6 +151,138 @@ impl PartialEq for GapPacket {
     }
 }
 
+// Packets accepted by `SinkHandler::store()` which are inserted in the jitterbuffer
+// together, the state is locked once for the whole batch
+struct StoreBatch<'a> {
+    state: Option<StdMutexGuard<'a, State>>,
+    items: Vec<RTPJitterBufferItem>,
+    // Headers and (max dropout, max misorder) of the next packets, see `prepare_batch`
+    prepared: VecDeque<(RTPPacketHeader, (u32, u32))>,
+    max_misorder_time: u32,
+    max_dropout_time: u32,
+    limits: Limits,
+    // Lowest and highest latency if it is adaptive
+    latency_bounds: Option<(gst::ClockTime, gst::ClockTime)>,
+    #[cfg(feature = "tuning")]
+    locked_at: Option<Instant>,
+}
+
+// Bounds of the queued packets, zero for no bound
+#[derive(Clone, Copy)]
+struct Limits {
+    max_bytes: u64,
+    max_time: gst::ClockTime,
+    drop_policy: DropPolicy,
+}
+
+impl Limits {
+    fn is_unlimited(&self) -> bool {
+        self.max_bytes == 0 && self.max_time.is_zero()
+    }
+
+    fn exceeded_by(&self, bytes: u64, time: gst::ClockTime) -> bool {
+        (self.max_bytes > 0 && bytes > self.max_bytes)
+            || (!self.max_time.is_zero() && time > self.max_time)
+    }
+}
+
+// Network conditions observed by the adaptive latency during the current period
+#[derive(Debug, Default)]
+struct AdaptiveLatency {
+    period_start: Option<gst::ClockTime>,
+    // Highest seqnum received and how many seqnums behind it packets arrived at most
+    max_seqnum: Option<u16>,
+    max_reorder: u64,
+    // Range of the clock skew estimate
+    min_skew: i64,
+    max_skew: i64,
+}
+
+impl AdaptiveLatency {
+    fn start_period(&mut self, dts: gst::ClockTime, skew: i64) {
+        self.period_start = Some(dts);
+        self.max_reorder = 0;
+        self.min_skew = skew;
+        self.max_skew = skew;
+    }
+
+    fn observe(&mut self, seq: u16, skew: i64) {
+        match self.max_seqnum {
+            Some(max_seqnum) if gst_rtp::compare_seqnum(seq, max_seqnum) > 0 => {
+                let reorder = gst_rtp::compare_seqnum(seq, max_seqnum) as u64;
+                self.max_reorder = self.max_reorder.max(reorder);
+            }
+            _ => self.max_seqnum = Some(seq),
+        }
+
+        self.min_skew = self.min_skew.min(skew);
+        self.max_skew = self.max_skew.max(skew);
+    }
+
+    // Delay absorbing the conditions of the period: four times the interarrival jitter
+    // like for the usual playout delay estimations, plus the drift of the skew and the
+    // time it took for reordered packets to arrive
+    fn target(&self, jitter: gst::ClockTime, packet_spacing: gst::ClockTime) -> gst::ClockTime {
+        let skew_drift = gst::ClockTime::from_nseconds(self.max_skew.abs_diff(self.min_skew));
+
+        4 * jitter + skew_drift + self.max_reorder * packet_spacing
+    }
+}
+
+impl<'a> StoreBatch<'a> {
+    fn new(jb: &JitterBuffer) -> Self {
+        let settings = jb.settings.lock().unwrap();
+
+        StoreBatch {
+            state: None,
+            items: Vec::new(),
+            prepared: VecDeque::new(),
+            max_misorder_time: settings.max_misorder_time,
+            max_dropout_time: settings.max_dropout_time,
+            limits: Limits {
+                max_bytes: settings.max_size_bytes as u64,
+                max_time: settings.max_size_time,
+                drop_policy: settings.drop_policy,
+            },
+            latency_bounds: settings
+                .adaptive_latency
+                .then_some((settings.min_latency, settings.latency)),
+            #[cfg(feature = "tuning")]
+            locked_at: None,
+        }
+    }
+
+    fn lock(&mut self, jb: &'a JitterBuffer) -> &mut State {
+        #[cfg(feature = "tuning")]
+        if self.state.is_none() {
+            self.locked_at = Some(Instant::now());
+        }
+
+        self.state.get_or_insert_with(|| jb.state.lock().unwrap())
+    }
+
+    fn unlock(&mut self) {
+        assert!(self.items.is_empty());
+        #[cfg(feature = "tuning")]
+        self.record_lock_hold();
+        self.state = None;
+    }
+
+    #[cfg(feature = "tuning")]
+    fn record_lock_hold(&mut self) {
+        if let (Some(state), Some(locked_at)) = (self.state.as_mut(), self.locked_at.take()) {
+            state.stats.lock_hold.record(locked_at.elapsed());
+        }
+    }
+}
+
+#[cfg(feature = "tuning")]
+impl<'a> Drop for StoreBatch<'a> {
+    fn drop(&mut self) {
+        self.record_lock_hold();
+    }
+}
+
 struct SinkHandlerInner {
     packet_rate_ctx: RTPPacketRateCtx,
     ips_rtptime: Option<u32>,
@@ -153,6 +330,8 @@ impl SinkHandler {
 
         state.last_popped_seqnum = None;
         state.last_popped_pts = None;
+        state.faststart_packets = 0;
+        state.passthrough_packets = 0;
 
         inner.last_in_seqnum = None;
         inner.last_rtptime = None;
@@ -160,6 +339,8 @@ impl SinkHandler {
         state.earliest_pts = None;
         state.earliest_seqnum = None;
 
+        state.adaptive_latency = AdaptiveLatency::default();
+
         inner.ips_rtptime = None;
         inner.ips_pts = None;
 
@@ -251,6 +432,7 @@ impl SinkHandler {
         inner: &mut SinkHandlerInner,
         jb: &JitterBuffer,
         buffer: gst::Buffer,
+        seq: u16,
         pt: u8,
     ) -> bool {
         let gap_packets_length = inner.gap_packets.len();
@@ -263,7 +445,7 @@ impl SinkHandler {
             gap_packets_length
         );
 
-        inner.gap_packets.insert(GapPacket::new(buffer));
+        inner.gap_packets.insert(GapPacket::new(buffer, seq, pt));
 
         if gap_packets_length > 0 {
             let mut prev_gap_seq = std::u32::MAX;
@@ -304,29 +486,27 @@ impl SinkHandler {
         reset
     }
 
-    fn store(
+    fn store<'a>(
         &self,
         inner: &mut SinkHandlerInner,
         pad: &gst::Pad,
-        jb: &JitterBuffer,
+        jb: &'a JitterBuffer,
+        batch: &mut StoreBatch<'a>,
         buffer: gst::Buffer,
     ) -> Result<gst::FlowSuccess, gst::FlowError> {
-        let mut state = jb.state.lock().unwrap();
-
-        let (max_misorder_time, max_dropout_time) = {
-            let settings = jb.settings.lock().unwrap();
-            (settings.max_misorder_time, settings.max_dropout_time)
-        };
+        let (max_misorder_time, max_dropout_time, latency_bounds) = (
+            batch.max_misorder_time,
+            batch.max_dropout_time,
+            batch.latency_bounds,
+        );
 
-        let (seq, rtptime, pt) = {
-            let rtp_buffer =
-                RTPBuffer::from_buffer_readable(&buffer).map_err(|_| gst::FlowError::Error)?;
-            (
-                rtp_buffer.seq(),
-                rtp_buffer.timestamp(),
-                rtp_buffer.payload_type(),
-            )
+        // The only time the packet is mapped, everything after works from the parsed header
+        let prepared = batch.prepared.pop_front();
+        let header = match prepared {
+            Some((header, _)) => header,
+            None => RTPPacketHeader::parse(&buffer).ok_or(gst::FlowError::Error)?,
         };
+        let (seq, rtptime, pt) = (header.seqnum, header.rtptime, header.pt);
 
         let mut pts = buffer.pts();
         let mut dts = buffer.dts();
@@ -342,6 +522,7 @@ impl SinkHandler {
         );
 
         let element = jb.obj();
+        let state = batch.lock(jb);
 
         if dts.is_none() {
             dts = pts;
@@ -371,31 +552,41 @@ impl SinkHandler {
 
             if let Some(caps) = pad.current_caps() {
                 /* Ignore errors at this point, as we want to emit request-pt-map */
-                let _ = self.parse_caps(inner, &mut state, jb, &caps, pt);
-            }
-        }
-
-        let mut state = {
-            if state.clock_rate.is_none() {
-                drop(state);
-                let caps = element
-                    .emit_by_name::<Option<gst::Caps>>("request-pt-map", &[&(pt as u32)])
-                    .ok_or_else(|| {
-                        gst::error!(CAT, obj: pad, "Signal 'request-pt-map' retuned None");
-                        gst::FlowError::Error
-                    })?;
-                let mut state = jb.state.lock().unwrap();
-                self.parse_caps(inner, &mut state, jb, &caps, pt)?;
-                state
-            } else {
-                state
+                let _ = self.parse_caps(inner, state, jb, &caps, pt);
             }
-        };
+        }
+
+        if state.clock_rate.is_none() {
+            // The signal is emitted without holding the state lock
+            self.insert_batch(inner, jb, batch);
+            batch.unlock();
+
+            let caps = element
+                .emit_by_name::<Option<gst::Caps>>("request-pt-map", &[&(pt as u32)])
+                .ok_or_else(|| {
+                    gst::error!(CAT, obj: pad, "Signal 'request-pt-map' retuned None");
+                    gst::FlowError::Error
+                })?;
+            self.parse_caps(inner, batch.lock(jb), jb, &caps, pt)?;
+        }
+
+        let state = batch.lock(jb);
 
-        inner.packet_rate_ctx.update(seq, rtptime);
+        if state.ssrc != Some(header.ssrc) {
+            state.ssrc = Some(header.ssrc);
+            self.apply_snapshot(inner, state, jb, header.ssrc);
+        }
 
-        let max_dropout = inner.packet_rate_ctx.max_dropout(max_dropout_time as i32);
-        let max_misorder = inner.packet_rate_ctx.max_misorder(max_misorder_time as i32);
+        let (max_dropout, max_misorder) = match prepared {
+            Some((_, thresholds)) => thresholds,
+            None => {
+                inner.packet_rate_ctx.update(seq, rtptime);
+                (
+                    inner.packet_rate_ctx.max_dropout(max_dropout_time as i32),
+                    inner.packet_rate_ctx.max_misorder(max_misorder_time as i32),
+                )
+            }
+        };
 
         pts = state
             .jbuf
@@ -414,12 +605,12 @@ impl SinkHandler {
         if let Some(last_in_seqnum) = inner.last_in_seqnum {
             let gap = gst_rtp::compare_seqnum(last_in_seqnum, seq);
             if gap == 1 {
-                self.calculate_packet_spacing(inner, &mut state, rtptime, pts);
+                self.calculate_packet_spacing(inner, state, rtptime, pts);
             } else {
                 if (gap != -1 && gap < -(max_misorder as i32)) || (gap >= max_dropout as i32) {
-                    let reset = self.handle_big_gap_buffer(inner, jb, buffer, pt);
+                    let reset = self.handle_big_gap_buffer(inner, jb, buffer, seq, pt);
                     if reset {
-                        // Handle reset in `enqueue_item` to avoid recursion
+                        // Handle reset in `enqueue_items` to avoid recursion
                         return Err(gst::FlowError::CustomError);
                     } else {
                         return Ok(gst::FlowSuccess::Ok);
@@ -432,6 +623,10 @@ impl SinkHandler {
             inner.gap_packets.clear();
         }
 
+        if let (Some(bounds), Some(dts), false) = (latency_bounds, dts, estimated_dts) {
+            self.adapt_latency(state, jb, seq, dts, bounds);
+        }
+
         if let Some(last_popped_seqnum) = state.last_popped_seqnum {
             let gap = gst_rtp::compare_seqnum(last_popped_seqnum, seq);
 
@@ -445,65 +640,403 @@ impl SinkHandler {
         inner.last_in_seqnum = Some(seq);
 
         let jb_item = if estimated_dts {
-            RTPJitterBufferItem::new(buffer, gst::ClockTime::NONE, pts, Some(seq), rtptime)
+            RTPJitterBufferItem::from_packet(
+                &state.jbuf,
+                buffer,
+                gst::ClockTime::NONE,
+                pts,
+                &header,
+            )
         } else {
-            RTPJitterBufferItem::new(buffer, dts, pts, Some(seq), rtptime)
+            RTPJitterBufferItem::from_packet(&state.jbuf, buffer, dts, pts, &header)
         };
 
-        let (success, _, _) = state.jbuf.insert(jb_item);
+        batch.items.push(jb_item);
 
-        if !success {
-            /* duplicate */
-            return Ok(gst::FlowSuccess::Ok);
+        Ok(gst::FlowSuccess::Ok)
+    }
+
+    // Continues the timing of a new stream from the snapshot imported for its SSRC
+    fn apply_snapshot(
+        &self,
+        inner: &mut SinkHandlerInner,
+        state: &mut State,
+        jb: &JitterBuffer,
+        ssrc: u32,
+    ) {
+        let snapshot = match jb.snapshots.lock().unwrap().remove(&ssrc) {
+            Some(snapshot) => snapshot,
+            None => return,
+        };
+
+        // Snapshots refer to clock times, the jitterbuffer works with running times
+        let mut jbuf_snapshot = snapshot.jbuf;
+        match jb
+            .obj()
+            .base_time()
+            .and_then(|base_time| jbuf_snapshot.base_time.checked_sub(base_time))
+        {
+            Some(base_time) => jbuf_snapshot.base_time = base_time,
+            None => {
+                gst::warning!(CAT, imp: jb, "Snapshot for SSRC {:#010x} is too old", ssrc);
+                return;
+            }
         }
 
-        if Some(rtptime) == inner.last_rtptime {
-            state.equidistant -= 2;
-        } else {
-            state.equidistant += 1;
+        if !state.jbuf.set_snapshot(&jbuf_snapshot) {
+            gst::warning!(CAT, imp: jb, "Ignoring invalid snapshot for SSRC {:#010x}", ssrc);
+            return;
         }
 
-        state.equidistant = state.equidistant.clamp(-7, 7);
+        if let Some(rate) = snapshot.packet_rate {
+            inner.packet_rate_ctx.set_rate(rate);
+        }
+        state.packet_spacing = snapshot.packet_spacing;
 
-        inner.last_rtptime = Some(rtptime);
+        gst::info!(
+            CAT,
+            imp: jb,
+            "Continuing SSRC {:#010x} from snapshot, skew {}",
+            ssrc,
+            jbuf_snapshot.skew
+        );
+    }
 
-        let must_update = match (state.earliest_pts, pts) {
-            (None, _) => true,
-            (Some(earliest_pts), Some(pts)) if pts < earliest_pts => true,
-            (Some(earliest_pts), Some(pts)) if pts == earliest_pts => state
-                .earliest_seqnum
-                .map_or(false, |earliest_seqnum| seq > earliest_seqnum),
-            _ => false,
+    // Grows the latency as soon as the observed network conditions require it and
+    // shrinks it progressively once they have been better for a whole period
+    fn adapt_latency(
+        &self,
+        state: &mut State,
+        jb: &JitterBuffer,
+        seq: u16,
+        dts: gst::ClockTime,
+        (min_latency, max_latency): (gst::ClockTime, gst::ClockTime),
+    ) {
+        let skew = state.jbuf.skew();
+        let adaptive = &mut state.adaptive_latency;
+
+        let period_start = match adaptive.period_start {
+            Some(period_start) => period_start,
+            None => {
+                adaptive.start_period(dts, skew);
+                dts
+            }
+        };
+        adaptive.observe(seq, skew);
+
+        let target = adaptive.target(state.jbuf.jitter(), state.packet_spacing);
+        let period_ended = dts.saturating_sub(period_start) >= ADAPTIVE_LATENCY_PERIOD;
+
+        let mut latency = if target > state.latency {
+            // Some headroom to not grow again with the next slightly later packet
+            target * 5 / 4
+        } else if period_ended {
+            state
+                .latency
+                .saturating_sub(ADAPTIVE_LATENCY_SHRINK_STEP)
+                .max(target)
+        } else {
+            state.latency
         };
 
-        if must_update {
-            state.earliest_pts = pts;
-            state.earliest_seqnum = Some(seq);
+        if period_ended {
+            adaptive.start_period(dts, skew);
         }
 
-        gst::log!(CAT, obj: pad, "Stored buffer");
+        // Whole milliseconds like the latency property, the highest bound prevails
+        latency = gst::ClockTime::from_mseconds((latency.nseconds() + 999_999) / 1_000_000);
+        latency = latency.max(min_latency).min(max_latency);
 
-        Ok(gst::FlowSuccess::Ok)
+        if latency != state.latency {
+            gst::debug!(
+                CAT,
+                imp: jb,
+                "Latency {} -> {}, jitter {}, skew {}",
+                state.latency,
+                latency,
+                state.jbuf.jitter(),
+                skew
+            );
+
+            state.latency = latency;
+            state.latency_changed = true;
+            state.jbuf.set_delay(latency);
+        }
     }
 
-    fn enqueue_item(
+    // Parses the leading packets of a list which belong to the current payload type and
+    // SSRC, and accounts for all of them in the packet rate at once. The other packets
+    // may change the clock rate or the estimated rate, `store` handles them one by one.
+    fn prepare_batch<'a>(
+        &self,
+        inner: &mut SinkHandlerInner,
+        jb: &'a JitterBuffer,
+        batch: &mut StoreBatch<'a>,
+        buffers: &VecDeque<gst::Buffer>,
+    ) {
+        let state = batch.lock(jb);
+        if state.clock_rate.is_none() {
+            return;
+        }
+        let ssrc = state.ssrc;
+
+        let mut headers = Vec::with_capacity(buffers.len());
+        for buffer in buffers {
+            match RTPPacketHeader::parse(buffer) {
+                Some(header) if Some(header.pt) == inner.last_pt && Some(header.ssrc) == ssrc => {
+                    headers.push(header)
+                }
+                _ => break,
+            }
+        }
+
+        let thresholds = inner.packet_rate_ctx.update_list(
+            headers.iter().map(|header| (header.seqnum, header.rtptime)),
+            batch.max_dropout_time as i32,
+            batch.max_misorder_time as i32,
+        );
+        batch
+            .prepared
+            .extend(headers.iter().copied().zip(thresholds));
+    }
+
+    // Inserts the packets accepted so far, the batch must be locked if it holds any
+    fn insert_batch(
+        &self,
+        inner: &mut SinkHandlerInner,
+        jb: &JitterBuffer,
+        batch: &mut StoreBatch,
+    ) {
+        if batch.items.is_empty() {
+            return;
+        }
+
+        let state = batch.state.as_mut().expect("batch not locked");
+        let limits = batch.limits;
+
+        // Make room by dropping the oldest packets
+        if state.jbuf.is_full() {
+            self.drop_oldest(state, jb, limits);
+        }
+
+        if limits.drop_policy == DropPolicy::DropNewest && !limits.is_unlimited() {
+            self.drop_newest(state, jb, &mut batch.items, limits);
+        }
+
+        if state.awaiting_keyframe {
+            self.drop_until_keyframe(state, jb, &mut batch.items);
+        }
+
+        let packets = batch
+            .items
+            .iter()
+            .map(|item| (item.seqnum().unwrap(), item.rtptime(), item.pts()))
+            .collect::<Vec<_>>();
+
+        let (results, _, _) = state.jbuf.insert_list(mem::take(&mut batch.items));
+
+        for ((seq, rtptime, pts), result) in packets.into_iter().zip(results) {
+            match result {
+                RTPJitterBufferInsertResult::Inserted => (),
+                RTPJitterBufferInsertResult::Duplicate => {
+                    gst::debug!(CAT, imp: jb, "Dropping duplicate {}", seq);
+                    continue;
+                }
+                RTPJitterBufferInsertResult::OutOfRange => {
+                    // More packets are missing than the jitterbuffer can wait for
+                    state.stats.num_out_of_range += 1;
+                    gst::warning!(CAT, imp: jb, "Dropping {} too far from the queued packets", seq);
+                    continue;
+                }
+            }
+
+            if Some(rtptime) == inner.last_rtptime {
+                state.equidistant -= 2;
+            } else {
+                state.equidistant += 1;
+            }
+
+            state.equidistant = state.equidistant.clamp(-7, 7);
+
+            inner.last_rtptime = Some(rtptime);
+
+            let must_update = match (state.earliest_pts, pts) {
+                (None, _) => true,
+                (Some(earliest_pts), Some(pts)) if pts < earliest_pts => true,
+                (Some(earliest_pts), Some(pts)) if pts == earliest_pts => state
+                    .earliest_seqnum
+                    .map_or(false, |earliest_seqnum| seq > earliest_seqnum),
+                _ => false,
+            };
+
+            if must_update {
+                state.earliest_pts = pts;
+                state.earliest_seqnum = Some(seq);
+            }
+
+            gst::log!(CAT, imp: jb, "Stored buffer #{}", seq);
+        }
+
+        if limits.drop_policy != DropPolicy::DropNewest && !limits.is_unlimited() {
+            self.drop_oldest(state, jb, limits);
+        }
+    }
+
+    // Duration covered by the RTP timestamps of the queued packets
+    fn queued_time(state: &State, ts_diff: u32) -> gst::ClockTime {
+        state.clock_rate.map_or(gst::ClockTime::ZERO, |clock_rate| {
+            gst::ClockTime::from_nseconds(
+                ts_diff as u64 * gst::ClockTime::SECOND.nseconds() / clock_rate as u64,
+            )
+        })
+    }
+
+    // Drops the packets of a batch that would exceed the limits once queued. The
+    // gaps they leave are reported as lost when the packets after them are pushed
+    fn drop_newest(
+        &self,
+        state: &mut State,
+        jb: &JitterBuffer,
+        items: &mut Vec<RTPJitterBufferItem>,
+        limits: Limits,
+    ) {
+        let mut bytes = state.jbuf.bytes();
+        let mut ts_diff = state.jbuf.ts_diff();
+        let mut first_rtptime = state.jbuf.peek_packet().map(|(rtptime, _)| rtptime);
+        let n_items = items.len();
+
+        items.retain(|item| {
+            let first = first_rtptime.unwrap_or_else(|| item.rtptime());
+            // Packets older than the first queued one don't make the queue longer
+            let item_ts_diff = (item.rtptime().wrapping_sub(first) as i32).max(0) as u32;
+            let item_bytes = bytes + item.size() as u64;
+            let item_ts_diff = ts_diff.max(item_ts_diff);
+
+            if limits.exceeded_by(item_bytes, Self::queued_time(state, item_ts_diff)) {
+                gst::debug!(CAT, imp: jb, "Queue limits reached, dropping {:?}", item.seqnum());
+                return false;
+            }
+
+            bytes = item_bytes;
+            ts_diff = item_ts_diff;
+            first_rtptime = Some(first);
+            true
+        });
+
+        state.stats.num_dropped += (n_items - items.len()) as u64;
+    }
+
+    // Drops the oldest packets until the queue is not full and within the limits
+    // again and, for `DropUntilKeyframe`, starts with a keyframe. Like for packets
+    // missing from the stream, lost events are pushed for them before the next packet
+    fn drop_oldest(&self, state: &mut State, jb: &JitterBuffer, limits: Limits) {
+        let mut n_dropped = 0u64;
+
+        loop {
+            let full = state.jbuf.is_full();
+            let queued_time = Self::queued_time(state, state.jbuf.ts_diff());
+            let over_limits = full
+                || (limits.drop_policy != DropPolicy::DropNewest
+                    && limits.exceeded_by(state.jbuf.bytes(), queued_time));
+            let before_keyframe = limits.drop_policy == DropPolicy::DropUntilKeyframe
+                && n_dropped > 0
+                && state.jbuf.peek_packet().map_or(false, |(_, flags)| {
+                    flags.contains(gst::BufferFlags::DELTA_UNIT)
+                });
+
+            if !over_limits && !before_keyframe {
+                break;
+            }
+
+            let item = match state.jbuf.pop() {
+                (Some(item), _) => item,
+                _ => break,
+            };
+
+            if full {
+                gst::warning!(
+                    CAT,
+                    imp: jb,
+                    "Queue full, dropping old packet {:?}",
+                    item.seqnum()
+                );
+            } else {
+                gst::debug!(CAT, imp: jb, "Queue limits reached, dropping {:?}", item.seqnum());
+            }
+
+            // Nothing was pushed yet, count the lost packets from this one on
+            if state.last_popped_seqnum.is_none() {
+                if let (Some(seq), Some(pts)) = (item.seqnum(), item.pts()) {
+                    state.last_popped_seqnum = Some(seq.wrapping_sub(1));
+                    state.last_popped_pts = Some(pts.saturating_sub(state.packet_spacing));
+                }
+            }
+
+            n_dropped += 1;
+        }
+
+        if n_dropped > 0 {
+            state.stats.num_dropped += n_dropped;
+
+            // The keyframe of the delta units to come was dropped with the queue
+            if limits.drop_policy == DropPolicy::DropUntilKeyframe
+                && state.jbuf.peek_packet().is_none()
+            {
+                gst::debug!(CAT, imp: jb, "Queue emptied, waiting for the next keyframe");
+                state.awaiting_keyframe = true;
+            }
+
+            let (earliest_pts, earliest_seqnum) = state.jbuf.find_earliest();
+            state.earliest_pts = earliest_pts;
+            state.earliest_seqnum = earliest_seqnum;
+        }
+    }
+
+    // Drops the delta units of a batch up to its first keyframe, once `drop_oldest`
+    // emptied the queue for `DropUntilKeyframe`. Their gaps are reported as lost too
+    fn drop_until_keyframe(
+        &self,
+        state: &mut State,
+        jb: &JitterBuffer,
+        items: &mut Vec<RTPJitterBufferItem>,
+    ) {
+        let n_delta_units = items
+            .iter()
+            .position(|item| !item.flags().contains(gst::BufferFlags::DELTA_UNIT))
+            .unwrap_or(items.len());
+
+        for item in items.drain(..n_delta_units) {
+            gst::debug!(CAT, imp: jb, "Waiting for a keyframe, dropping {:?}", item.seqnum());
+        }
+        state.stats.num_dropped += n_delta_units as u64;
+
+        if let Some(item) = items.first() {
+            gst::debug!(CAT, imp: jb, "Resuming at keyframe {:?}", item.seqnum());
+            state.awaiting_keyframe = false;
+        }
+    }
+
+    fn enqueue_items(
         &self,
         pad: gst::Pad,
         jb: &JitterBuffer,
-        buffer: Option<gst::Buffer>,
+        mut buffers: VecDeque<gst::Buffer>,
     ) -> Result<gst::FlowSuccess, gst::FlowError> {
         let mut inner = self.0.lock().unwrap();
+        let mut batch = StoreBatch::new(jb);
 
-        let mut buffers = VecDeque::new();
-        if let Some(buf) = buffer {
-            buffers.push_back(buf);
+        if buffers.len() > 1 {
+            self.prepare_batch(&mut inner, jb, &mut batch, &buffers);
         }
 
-        // This is to avoid recursion with `store`, `reset` and `enqueue_item`
+        // This is to avoid recursion with `store`, `reset` and `enqueue_items`
         while let Some(buf) = buffers.pop_front() {
-            if let Err(err) = self.store(&mut inner, &pad, jb, buf) {
+            if let Err(err) = self.store(&mut inner, &pad, jb, &mut batch, buf) {
+                self.insert_batch(&mut inner, jb, &mut batch);
+
                 match err {
                     gst::FlowError::CustomError => {
+                        batch.unlock();
                         for gap_packet in self.reset(&mut inner, jb) {
                             buffers.push_back(gap_packet.buffer);
                         }
@@ -513,17 +1046,36 @@ impl SinkHandler {
             }
         }
 
-        let mut state = jb.state.lock().unwrap();
+        self.insert_batch(&mut inner, jb, &mut batch);
+        let state = batch.lock(jb);
 
-        let (latency, context_wait) = {
+        let (context_wait, faststart_min_packets) = {
             let settings = jb.settings.lock().unwrap();
-            (settings.latency, settings.context_wait)
+            (settings.context_wait, settings.faststart_min_packets)
         };
 
+        // Start pushing without waiting for the latency once enough consecutive
+        // packets were received at the beginning of the stream
+        if faststart_min_packets > 0
+            && state.last_popped_seqnum.is_none()
+            && state.faststart_packets == 0
+            && state.jbuf.can_fast_start(faststart_min_packets)
+        {
+            gst::debug!(
+                CAT,
+                obj: pad,
+                "Found {} consecutive packets, start now",
+                faststart_min_packets
+            );
+            state.faststart_packets = faststart_min_packets;
+        }
+
+        state.update_passthrough_packets();
+
         // Reschedule if needed
-        let (_, next_wakeup) =
-            jb.src_pad_handler
-                .next_wakeup(&jb.obj(), &state, latency, context_wait);
+        let (_, next_wakeup) = jb
+            .src_pad_handler
+            .next_wakeup(&jb.obj(), state, context_wait);
         if let Some((next_wakeup, _)) = next_wakeup {
             if let Some((previous_next_wakeup, ref abort_handle)) = state.wait_handle {
                 if previous_next_wakeup.is_none()
@@ -541,7 +1093,18 @@ impl SinkHandler {
                 }
             }
         }
-        state.last_res
+
+        let res = state.last_res;
+        let latency_changed = mem::take(&mut state.latency_changed);
+        drop(batch);
+
+        if latency_changed {
+            let _ = jb
+                .obj()
+                .post_message(gst::message::Latency::builder().src(&*jb.obj()).build());
+        }
+
+        res
     }
 }
 
@@ -556,7 +1119,20 @@ impl PadSinkHandler for SinkHandler {
     ) -> BoxFuture<'static, Result<gst::FlowSuccess, gst::FlowError>> {
         async move {
             gst::debug!(CAT, obj: pad, "Handling {:?}", buffer);
-            self.enqueue_item(pad, elem.imp(), Some(buffer))
+            self.enqueue_items(pad, elem.imp(), VecDeque::from([buffer]))
+        }
+        .boxed()
+    }
+
+    fn sink_chain_list(
+        self,
+        pad: gst::Pad,
+        elem: super::JitterBuffer,
+        list: gst::BufferList,
+    ) -> BoxFuture<'static, Result<gst::FlowSuccess, gst::FlowError>> {
+        async move {
+            gst::debug!(CAT, obj: pad, "Handling {:?}", list);
+            self.enqueue_items(pad, elem.imp(), list.iter_owned().collect())
         }
         .boxed()
     }
@@ -650,11 +1226,12 @@ impl SrcHandler {
         pts: impl Into<Option<gst::ClockTime>>,
         discont: &mut bool,
     ) -> Vec<gst::Event> {
-        let (latency, do_lost) = {
+        let (do_lost, coalesce_lost) = {
             let jb = element.imp();
             let settings = jb.settings.lock().unwrap();
-            (settings.latency, settings.do_lost)
+            (settings.do_lost, settings.coalesce_lost)
         };
+        let latency = state.latency;
 
         let mut events = vec![];
 
@@ -683,6 +1260,32 @@ impl SrcHandler {
 
             *discont = true;
 
+            if coalesce_lost {
+                // A single event covering the whole gap, which is also accounted for at once
+                let duration = if state.equidistant > 0 {
+                    gap * spacing
+                } else {
+                    (gap - 1) * spacing
+                };
+
+                if do_lost {
+                    let s = gst::Structure::builder("GstRTPPacketLost")
+                        .field("seqnum", lost_seqnum as u32)
+                        .field("count", gap as u32)
+                        .field("timestamp", last_popped_pts + spacing)
+                        .field("duration", duration.nseconds())
+                        .field("retry", 0)
+                        .build();
+
+                    events.push(gst::event::CustomDownstream::new(s));
+                }
+
+                state.last_popped_pts = Some(last_popped_pts + gap * spacing);
+                state.stats.num_lost += gap;
+
+                return events;
+            }
+
             if state.equidistant > 0 && gap > 1 && gap * spacing > latency {
                 let n_packets = gap - latency.nseconds() / spacing.nseconds();
 
@@ -733,88 +1336,153 @@ impl SrcHandler {
         events
     }
 
+    // Pops up to `max_items` packets with a PTS up to `max_pts` (all of them if `None`) and
+    // pushes them downstream as buffer lists, split where lost events have to be pushed in
+    // between
     async fn pop_and_push(
         &self,
         element: &super::JitterBuffer,
+        max_pts: Option<gst::ClockTime>,
+        max_items: usize,
     ) -> Result<gst::FlowSuccess, gst::FlowError> {
         let jb = element.imp();
 
-        let (lost_events, buffer, seq) = {
+        let chunks = {
             let mut state = jb.state.lock().unwrap();
+            #[cfg(feature = "tuning")]
+            let locked_at = Instant::now();
+
+            let (jb_items, _) = state.jbuf.pop_ready(max_pts, max_items.min(POP_BATCH_SIZE));
+            state.faststart_packets = state
+                .faststart_packets
+                .saturating_sub(jb_items.len() as u32);
+            state.passthrough_packets = state
+                .passthrough_packets
+                .saturating_sub(jb_items.len() as u32);
+
+            if jb_items.is_empty() {
+                #[cfg(feature = "tuning")]
+                state.stats.lock_hold.record(locked_at.elapsed());
+
+                if state.eos {
+                    return Err(gst::FlowError::Eos);
+                } else {
+                    return Ok(gst::FlowSuccess::Ok);
+                }
+            }
 
-            let mut discont = false;
-            let (jb_item, _) = state.jbuf.pop();
+            let mut chunks: Vec<(Vec<gst::Event>, Vec<gst::Buffer>)> = vec![];
 
-            let jb_item = match jb_item {
-                None => {
-                    if state.eos {
-                        return Err(gst::FlowError::Eos);
-                    } else {
-                        return Ok(gst::FlowSuccess::Ok);
-                    }
-                }
-                Some(item) => item,
-            };
+            for jb_item in jb_items {
+                let mut discont = false;
 
-            let dts = jb_item.dts();
-            let pts = jb_item.pts();
-            let seq = jb_item.seqnum();
-            let mut buffer = jb_item.into_buffer();
+                let dts = jb_item.dts();
+                let pts = jb_item.pts();
+                let seq = jb_item.seqnum();
+                let mut buffer = jb_item.into_buffer();
 
-            let lost_events = {
-                let buffer = buffer.make_mut();
+                let lost_events = {
+                    let buffer = buffer.make_mut();
 
-                buffer.set_dts(state.segment.to_running_time(dts));
-                buffer.set_pts(state.segment.to_running_time(pts));
+                    buffer.set_dts(state.segment.to_running_time(dts));
+                    buffer.set_pts(state.segment.to_running_time(pts));
 
-                if state.last_popped_pts.is_some() && buffer.pts() < state.last_popped_pts {
-                    buffer.set_pts(state.last_popped_pts)
-                }
+                    if state.last_popped_pts.is_some() && buffer.pts() < state.last_popped_pts {
+                        buffer.set_pts(state.last_popped_pts)
+                    }
 
-                let lost_events = if let Some(seq) = seq {
-                    self.generate_lost_events(&mut state, element, seq, pts, &mut discont)
-                } else {
-                    vec![]
+                    let lost_events = if let Some(seq) = seq {
+                        self.generate_lost_events(&mut state, element, seq, pts, &mut discont)
+                    } else {
+                        vec![]
+                    };
+
+                    if state.discont {
+                        discont = true;
+                        state.discont = false;
+                    }
+
+                    if discont {
+                        buffer.set_flags(gst::BufferFlags::DISCONT);
+                    }
+
+                    lost_events
                 };
 
-                if state.discont {
-                    discont = true;
-                    state.discont = false;
+                state.last_popped_pts = buffer.pts();
+                if state.last_popped_pts.is_some() {
+                    state.position = state.last_popped_pts;
                 }
+                state.last_popped_seqnum = seq;
 
-                if discont {
-                    buffer.set_flags(gst::BufferFlags::DISCONT);
-                }
+                state.stats.num_pushed += 1;
 
-                lost_events
-            };
+                gst::log!(CAT, obj: element, "Popped {:?} with seq {:?}", buffer, seq);
 
-            state.last_popped_pts = buffer.pts();
-            if state.last_popped_pts.is_some() {
-                state.position = state.last_popped_pts;
+                match chunks.last_mut() {
+                    Some((_, buffers)) if lost_events.is_empty() => buffers.push(buffer),
+                    _ => chunks.push((lost_events, vec![buffer])),
+                }
             }
-            state.last_popped_seqnum = seq;
 
-            state.stats.num_pushed += 1;
+            #[cfg(feature = "tuning")]
+            state.stats.lock_hold.record(locked_at.elapsed());
 
-            (lost_events, buffer, seq)
+            chunks
         };
 
-        for event in lost_events {
-            gst::debug!(CAT, obj: jb.src_pad.gst_pad(), "Pushing lost event {:?}", event);
-            let _ = jb.src_pad.push_event(event).await;
+        let mut res = Ok(gst::FlowSuccess::Ok);
+
+        for (lost_events, mut buffers) in chunks {
+            for event in lost_events {
+                gst::debug!(CAT, obj: jb.src_pad.gst_pad(), "Pushing lost event {:?}", event);
+                let _ = jb.src_pad.push_event(event).await;
+            }
+
+            res = if buffers.len() == 1 {
+                let buffer = buffers.pop().unwrap();
+                gst::debug!(CAT, obj: jb.src_pad.gst_pad(), "Pushing {:?}", buffer);
+                jb.src_pad.push(buffer).await
+            } else {
+                let mut list = gst::BufferList::new_sized(buffers.len());
+                {
+                    let list = list.get_mut().unwrap();
+                    for buffer in buffers {
+                        list.add(buffer);
+                    }
+                }
+
+                gst::debug!(CAT, obj: jb.src_pad.gst_pad(), "Pushing {:?}", list);
+                jb.src_pad.push_list(list).await
+            };
+
+            if res.is_err() {
+                break;
+            }
         }
 
-        gst::debug!(CAT, obj: jb.src_pad.gst_pad(), "Pushing {:?} with seq {:?}", buffer, seq);
+        res
+    }
 
-        jb.src_pad.push(buffer).await
+    // Highest PTS that is due at `now` according to `next_wakeup()`, `None` if all
+    // packets can be pushed
+    fn max_ready_pts(
+        &self,
+        state: &State,
+        now: Option<gst::ClockTime>,
+        context_wait: gst::ClockTime,
+    ) -> Option<gst::ClockTime> {
+        if state.eos {
+            return None;
+        }
+
+        now.map(|now| (now + state.packet_spacing + context_wait / 2).saturating_sub(state.latency))
     }
 
     fn next_wakeup(
         &self,
         element: &super::JitterBuffer,
         state: &State,
-        latency: gst::ClockTime,
         context_wait: gst::ClockTime,
     ) -> (
         Option<gst::ClockTime>,
@@ -830,7 +1498,7 @@ impl SrcHandler {
             state.eos,
             state.earliest_pts.display(),
             state.packet_spacing,
-            latency
+            state.latency
         );
 
         if state.eos {
@@ -838,12 +1506,22 @@ impl SrcHandler {
             return (now, Some((now, Duration::ZERO)));
         }
 
+        if state.faststart_packets > 0 {
+            gst::debug!(CAT, obj: element, "Fast start, not waiting");
+            return (now, Some((now, Duration::ZERO)));
+        }
+
+        if state.passthrough_packets > 0 {
+            gst::debug!(CAT, obj: element, "In-order packets, not waiting");
+            return (now, Some((now, Duration::ZERO)));
+        }
+
         if state.earliest_pts.is_none() {
             return (now, None);
         }
 
         let next_wakeup = state.earliest_pts.map(|earliest_pts| {
-            (earliest_pts + latency)
+            (earliest_pts + state.latency)
                 .saturating_sub(state.packet_spacing)
                 .saturating_sub(context_wait / 2)
         });
@@ -916,9 +1594,9 @@ impl PadSrcHandler for SrcHandler {
                 let ret = jb.sink_pad.gst_pad().peer_query(&mut peer_query);
 
                 if ret {
-                    let settings = jb.settings.lock().unwrap();
+                    let state = jb.state.lock().unwrap();
                     let (_, mut min_latency, _) = peer_query.result();
-                    min_latency += settings.latency;
+                    min_latency += state.latency;
                     let max_latency = gst::ClockTime::NONE;
 
                     q.set(true, min_latency, max_latency);
@@ -946,6 +1624,105 @@ struct Stats {
     num_pushed: u64,
     num_lost: u64,
     num_late: u64,
+    num_dropped: u64,
+    num_out_of_range: u64,
+    #[cfg(feature = "tuning")]
+    lock_hold: LockHoldStats,
+}
+
+// How long the state is locked for on the streaming paths, with the same power of two
+// buckets as the histograms of the C core, in microseconds
+#[cfg(feature = "tuning")]
+#[derive(Debug, Default)]
+struct LockHoldStats {
+    histogram: [u64; ffi::RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS],
+    max: Duration,
+}
+
+#[cfg(feature = "tuning")]
+impl LockHoldStats {
+    fn record(&mut self, held: Duration) {
+        let us = held.as_micros() as u64;
+        let bucket = (u64::BITS - us.leading_zeros()) as usize;
+
+        self.histogram[bucket.min(ffi::RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS - 1)] += 1;
+        self.max = self.max.max(held);
+    }
+}
+
+#[cfg(feature = "tuning")]
+fn histogram_to_array(histogram: &[u64]) -> gst::Array {
+    gst::Array::from_values(histogram.iter().map(|count| count.to_send_value()))
+}
+
+const SNAPSHOT_STRUCTURE_NAME: &str = "application/x-rtp-jitterbuffer-snapshot";
+
+// Timing state of a stream, exported with the `export-snapshot` signal so that another
+// jitterbuffer can take over the stream without estimating its skew again
+#[derive(Debug, Clone)]
+struct TimingSnapshot {
+    // With a base time in clock time, which is shared by both jitterbuffers
+    jbuf: RTPJitterBufferSnapshot,
+    packet_spacing: gst::ClockTime,
+    packet_rate: Option<u32>,
+}
+
+impl TimingSnapshot {
+    fn to_structure(&self, ssrc: u32) -> gst::Structure {
+        let window = self.jbuf.window.iter().map(|delta| delta.to_send_value());
+
+        let s = gst::Structure::builder(SNAPSHOT_STRUCTURE_NAME)
+            .field("ssrc", ssrc)
+            .field("clock-rate", self.jbuf.clock_rate)
+            .field("base-time", self.jbuf.base_time.nseconds())
+            .field("base-rtptime", self.jbuf.base_rtptime.nseconds())
+            .field("base-extrtp", self.jbuf.base_extrtp)
+            .field("ext-rtptime", self.jbuf.ext_rtptime)
+            .field("skew", self.jbuf.skew)
+            .field("jitter", self.jbuf.jitter.nseconds())
+            .field("window", gst::Array::from_values(window))
+            .field("packet-spacing", self.packet_spacing.nseconds());
+
+        match self.packet_rate {
+            Some(packet_rate) => s.field("packet-rate", packet_rate).build(),
+            None => s.build(),
+        }
+    }
+
+    // Returns the SSRC of the snapshot along with it
+    fn from_structure(s: &gst::StructureRef) -> Option<(u32, Self)> {
+        if s.name() != SNAPSHOT_STRUCTURE_NAME {
+            return None;
+        }
+
+        let time = |field| s.get::<u64>(field).ok().map(gst::ClockTime::from_nseconds);
+        let window = s
+            .get::<gst::Array>("window")
+            .ok()?
+            .iter()
+            .map(|delta| delta.get::<i64>().ok())
+            .collect::<Option<Vec<_>>>()?;
+
+        let jbuf = RTPJitterBufferSnapshot {
+            clock_rate: s.get::<u32>("clock-rate").ok()?,
+            base_time: time("base-time")?,
+            base_rtptime: time("base-rtptime")?,
+            base_extrtp: s.get::<u64>("base-extrtp").ok()?,
+            ext_rtptime: s.get::<u64>("ext-rtptime").ok()?,
+            skew: s.get::<i64>("skew").ok()?,
+            jitter: time("jitter")?,
+            window,
+        };
+
+        Some((
+            s.get::<u32>("ssrc").ok()?,
+            TimingSnapshot {
+                jbuf,
+                packet_spacing: time("packet-spacing")?,
+                packet_rate: s.get::<u32>("packet-rate").ok(),
+            },
+        ))
+    }
 }
 
 // Shared state between element, sink and source pad
@@ -957,10 +1734,17 @@ struct State {
 
     segment: gst::FormattedSegment<gst::ClockTime>,
     clock_rate: Option<u32>,
+    ssrc: Option<u32>,
 
     packet_spacing: gst::ClockTime,
     equidistant: i32,
 
+    // Effective latency, only differs from the property with adaptive-latency
+    latency: gst::ClockTime,
+    adaptive_latency: AdaptiveLatency,
+    // The latency changed but the message was not posted yet
+    latency_changed: bool,
+
     discont: bool,
     eos: bool,
 
@@ -972,6 +1756,14 @@ struct State {
     earliest_pts: Option<gst::ClockTime>,
     earliest_seqnum: Option<u16>,
 
+    // Consecutive packets at the head of the queue to push without waiting
+    faststart_packets: u32,
+    // In-order packets at the head of the queue in pass-through mode
+    passthrough_packets: u32,
+    // drop-until-keyframe emptied the queue, the delta units are dropped up to the
+    // next keyframe. Like the rest of the state, it is reset on flush and stop
+    awaiting_keyframe: bool,
+
     wait_handle: Option<(Option<gst::ClockTime>, AbortHandle)>,
 }
 
@@ -985,10 +1777,15 @@ impl Default for State {
 
             segment: gst::FormattedSegment::<gst::ClockTime>::new(),
             clock_rate: None,
+            ssrc: None,
 
             packet_spacing: gst::ClockTime::ZERO,
             equidistant: 0,
 
+            latency: DEFAULT_LATENCY,
+            adaptive_latency: AdaptiveLatency::default(),
+            latency_changed: false,
+
             discont: true,
             eos: false,
 
@@ -1000,15 +1797,35 @@ impl Default for State {
             earliest_pts: None,
             earliest_seqnum: None,
 
+            faststart_packets: 0,
+            passthrough_packets: 0,
+            awaiting_keyframe: false,
+
             wait_handle: None,
         }
     }
 }
 
+impl State {
+    // In pass-through mode, packets following the last pushed one without any gap are
+    // pushed right away, the others wait for their deadline as in the other modes
+    fn update_passthrough_packets(&mut self) {
+        self.passthrough_packets = if self.jbuf.mode() == RTPJitterBufferMode::Passthrough {
+            let next_seqnum = self.last_popped_seqnum.map(|seq| seq.wrapping_add(1));
+            self.jbuf.num_contiguous(next_seqnum)
+        } else {
+            0
+        };
+    }
+}
+
 struct JitterBufferTask {
     element: super::JitterBuffer,
     src_pad_handler: SrcHandler,
     sink_pad_handler: SinkHandler,
+    // Shared with the other jitterbuffers of the context so that a single
+    // timer wakes up all the ones which are due
+    timer_wheel: TimerWheel,
 }
 
 impl JitterBufferTask {
@@ -1016,11 +1833,13 @@ impl JitterBufferTask {
         element: &super::JitterBuffer,
         src_pad_handler: &SrcHandler,
         sink_pad_handler: &SinkHandler,
+        timer_wheel: TimerWheel,
     ) -> Self {
         JitterBufferTask {
             element: element.clone(),
             src_pad_handler: src_pad_handler.clone(),
             sink_pad_handler: sink_pad_handler.clone(),
+            timer_wheel,
         }
     }
 }
@@ -1037,10 +1856,16 @@ impl TaskImpl for JitterBufferTask {
 
             let jb = self.element.imp();
 
-            let latency = jb.settings.lock().unwrap().latency;
-            let state = State::default();
+            let settings = jb.settings.lock().unwrap().clone();
+            let mut state = State::default();
 
-            state.jbuf.set_delay(latency);
+            // The adaptive latency starts from the highest one
+            state.latency = settings.latency;
+            state.jbuf.set_mode(settings.mode.into());
+            state.jbuf.set_delay(settings.latency);
+            state
+                .jbuf
+                .set_skew_window(settings.skew_window_size, settings.skew_window_time);
             *jb.state.lock().unwrap() = state;
 
             gst::log!(CAT, obj: self.element, "Task started");
@@ -1054,36 +1879,29 @@ impl TaskImpl for JitterBufferTask {
     // in https://gitlab.freedesktop.org/gstreamer/gst-plugins-rs/-/merge_requests/756.
     // It should be possible to remove the loop below as try_next /  handle_item
     // are executed in a loop by the Task state machine.
-    // It should also be possible to store latency and context_wait as
-    // fields of JitterBufferTask so as to avoid locking the settings.
-    // If latency can change during processing, a command based mechanism
-    // could be implemented. See the command implemention for ts-udpsink as
-    // an example.
+    // It should also be possible to store context_wait as a field of
+    // JitterBufferTask so as to avoid locking the settings. The latency
+    // can change during processing and is read from the state.
     fn try_next(&mut self) -> BoxFuture<'_, Result<(), gst::FlowError>> {
         async move {
             let jb = self.element.imp();
-            let (latency, context_wait) = {
-                let settings = jb.settings.lock().unwrap();
-                (settings.latency, settings.context_wait)
-            };
+            let context_wait = jb.settings.lock().unwrap().context_wait;
 
             loop {
                 let delay_fut = {
                     let mut state = jb.state.lock().unwrap();
-                    let (_, next_wakeup) = self.src_pad_handler.next_wakeup(
-                        &self.element,
-                        &state,
-                        latency,
-                        context_wait,
-                    );
+                    let (_, next_wakeup) =
+                        self.src_pad_handler
+                            .next_wakeup(&self.element, &state, context_wait);
 
                     let (delay_fut, abort_handle) = match next_wakeup {
                         Some((_, delay)) if delay.is_zero() => (None, None),
                         _ => {
+                            let timer_wheel = self.timer_wheel.clone();
                             let (delay_fut, abort_handle) = abortable(async move {
                                 match next_wakeup {
                                     Some((_, delay)) => {
-                                        runtime::timer::delay_for_at_least(delay).await;
+                                        timer_wheel.delay_for_at_least(delay).await;
                                     }
                                     None => {
                                         future::pending::<()>().await;
@@ -1110,16 +1928,13 @@ impl TaskImpl for JitterBufferTask {
                     }
                 }
 
-                let (head_pts, head_seq) = {
+                let (max_pts, max_items) = {
                     let state = jb.state.lock().unwrap();
                     //
                     // Check earliest PTS as we have just taken the lock
-                    let (now, next_wakeup) = self.src_pad_handler.next_wakeup(
-                        &self.element,
-                        &state,
-                        latency,
-                        context_wait,
-                    );
+                    let (now, next_wakeup) =
+                        self.src_pad_handler
+                            .next_wakeup(&self.element, &state, context_wait);
 
                     gst::debug!(
                         CAT,
@@ -1138,33 +1953,42 @@ impl TaskImpl for JitterBufferTask {
                         return Ok(());
                     }
 
-                    let (head_pts, head_seq) = state.jbuf.peek();
-
-                    (head_pts, head_seq)
+                    if state.faststart_packets > 0 {
+                        // Only the consecutive packets at the head of the queue
+                        (None, state.faststart_packets as usize)
+                    } else if state.passthrough_packets > 0 {
+                        (None, state.passthrough_packets as usize)
+                    } else {
+                        (
+                            self.src_pad_handler
+                                .max_ready_pts(&state, now, context_wait),
+                            POP_BATCH_SIZE,
+                        )
+                    }
                 };
 
-                let res = self.src_pad_handler.pop_and_push(&self.element).await;
+                let res = self
+                    .src_pad_handler
+                    .pop_and_push(&self.element, max_pts, max_items)
+                    .await;
 
                 {
                     let mut state = jb.state.lock().unwrap();
 
                     state.last_res = res;
 
-                    if head_pts == state.earliest_pts && head_seq == state.earliest_seqnum {
-                        let (earliest_pts, earliest_seqnum) = state.jbuf.find_earliest();
-                        state.earliest_pts = earliest_pts;
-                        state.earliest_seqnum = earliest_seqnum;
-                    }
+                    let (earliest_pts, earliest_seqnum) = state.jbuf.find_earliest();
+                    state.earliest_pts = earliest_pts;
+                    state.earliest_seqnum = earliest_seqnum;
+                    // Resume pass-through once the packets after a gap got pushed
+                    state.update_passthrough_packets();
 
                     if res.is_ok() {
                         // Return and reschedule if the next packet would be in the future
                         // Check earliest PTS as we have just taken the lock
-                        let (now, next_wakeup) = self.src_pad_handler.next_wakeup(
-                            &self.element,
-                            &state,
-                            latency,
-                            context_wait,
-                        );
+                        let (now, next_wakeup) =
+                            self.src_pad_handler
+                                .next_wakeup(&self.element, &state, context_wait);
                         if let Some((Some(next_wakeup), _)) = next_wakeup {
                             if now.map_or(false, |now| next_wakeup > now) {
                                 // Reschedule and wait a bit longer in the next iteration
@@ -1230,6 +2054,8 @@ pub struct JitterBuffer {
     task: Task,
     state: StdMutex<State>,
     settings: StdMutex<Settings>,
+    // Imported with the `import-snapshot` signal, by SSRC and until the stream starts
+    snapshots: StdMutex<HashMap<u32, TimingSnapshot>>,
 }
 
 static CAT: Lazy<gst::DebugCategory> = Lazy::new(|| {
@@ -1249,17 +2075,61 @@ impl JitterBuffer {
         state.jbuf.reset_skew();
     }
 
+    fn export_snapshot(&self) -> Option<gst::Structure> {
+        // Locked in the same order as on the streaming thread
+        let inner = self.sink_pad_handler.0.lock().unwrap();
+        let state = self.state.lock().unwrap();
+
+        let ssrc = state.ssrc?;
+        let mut jbuf = state.jbuf.snapshot()?;
+        jbuf.base_time += self.obj().base_time()?;
+
+        let snapshot = TimingSnapshot {
+            jbuf,
+            packet_spacing: state.packet_spacing,
+            packet_rate: inner.packet_rate_ctx.rate(),
+        };
+
+        gst::debug!(CAT, imp: self, "Exporting snapshot for SSRC {:#010x}", ssrc);
+
+        Some(snapshot.to_structure(ssrc))
+    }
+
+    fn import_snapshot(&self, s: &gst::StructureRef) -> bool {
+        let (ssrc, snapshot) = match TimingSnapshot::from_structure(s) {
+            Some(snapshot) => snapshot,
+            None => {
+                gst::warning!(CAT, imp: self, "Invalid snapshot {}", s);
+                return false;
+            }
+        };
+
+        gst::debug!(CAT, imp: self, "Imported snapshot for SSRC {:#010x}", ssrc);
+        self.snapshots.lock().unwrap().insert(ssrc, snapshot);
+
+        true
+    }
+
     fn prepare(&self) -> Result<(), gst::ErrorMessage> {
         gst::debug!(CAT, imp: self, "Preparing");
 
-        let context = {
+        let (context, timer_granularity) = {
             let settings = self.settings.lock().unwrap();
-            Context::acquire(&settings.context, settings.context_wait.into()).unwrap()
+            (
+                Context::acquire(&settings.context, settings.context_wait.into()).unwrap(),
+                settings.timer_granularity,
+            )
         };
+        let timer_wheel = TimerWheel::acquire(&context, timer_granularity.into());
 
         self.task
             .prepare(
-                JitterBufferTask::new(&self.obj(), &self.src_pad_handler, &self.sink_pad_handler),
+                JitterBufferTask::new(
+                    &self.obj(),
+                    &self.src_pad_handler,
+                    &self.sink_pad_handler,
+                    timer_wheel,
+                ),
                 context,
             )
             .block_on()?;
@@ -1314,6 +2184,7 @@ impl ObjectSubclass for JitterBuffer {
             task: Task::default(),
             state: StdMutex::new(State::default()),
             settings: StdMutex::new(Settings::default()),
+            snapshots: StdMutex::new(HashMap::new()),
         }
     }
 }
@@ -1333,16 +2204,47 @@ impl ObjectImpl for JitterBuffer {
                     .maximum(1000)
                     .default_value(DEFAULT_CONTEXT_WAIT.mseconds() as u32)
                     .build(),
+                glib::ParamSpecUInt::builder("timer-granularity")
+                    .nick("Timer granularity")
+                    .blurb(
+                        "Granularity (milliseconds) of the wakeups shared by the jitterbuffers \
+                        of the context, set by the first one",
+                    )
+                    .minimum(1)
+                    .maximum(1000)
+                    .default_value(DEFAULT_TIMER_GRANULARITY.mseconds() as u32)
+                    .build(),
                 glib::ParamSpecUInt::builder("latency")
                     .nick("Buffer latency in ms")
-                    .blurb("Amount of ms to buffer")
+                    .blurb("Amount of ms to buffer, the highest latency with adaptive-latency")
                     .default_value(DEFAULT_LATENCY.mseconds() as u32)
                     .build(),
+                glib::ParamSpecBoolean::builder("adaptive-latency")
+                    .nick("Adaptive latency")
+                    .blurb(
+                        "Adapt the latency between min-latency and latency to the jitter, \
+                         clock skew and reordering of the packets",
+                    )
+                    .default_value(DEFAULT_ADAPTIVE_LATENCY)
+                    .build(),
+                glib::ParamSpecUInt::builder("min-latency")
+                    .nick("Minimum latency in ms")
+                    .blurb("Lowest amount of ms to buffer with adaptive-latency")
+                    .default_value(DEFAULT_MIN_LATENCY.mseconds() as u32)
+                    .build(),
                 glib::ParamSpecBoolean::builder("do-lost")
                     .nick("Do Lost")
                     .blurb("Send an event downstream when a packet is lost")
                     .default_value(DEFAULT_DO_LOST)
                     .build(),
+                glib::ParamSpecBoolean::builder("coalesce-lost")
+                    .nick("Coalesce Lost")
+                    .blurb(
+                        "Send a single event with the number of lost packets for each gap \
+                         instead of one event per lost packet",
+                    )
+                    .default_value(DEFAULT_COALESCE_LOST)
+                    .build(),
                 glib::ParamSpecUInt::builder("max-dropout-time")
                     .nick("Max dropout time")
                     .blurb("The maximum time (milliseconds) of missing packets tolerated.")
@@ -1353,6 +2255,47 @@ impl ObjectImpl for JitterBuffer {
                     .blurb("The maximum time (milliseconds) of misordered packets tolerated.")
                     .default_value(DEFAULT_MAX_MISORDER_TIME)
                     .build(),
+                glib::ParamSpecUInt::builder("skew-window-size")
+                    .nick("Skew window size")
+                    .blurb("Maximum number of packets used to estimate the clock skew")
+                    .minimum(1)
+                    .maximum(DEFAULT_SKEW_WINDOW_SIZE)
+                    .default_value(DEFAULT_SKEW_WINDOW_SIZE)
+                    .build(),
+                glib::ParamSpecUInt::builder("skew-window-time")
+                    .nick("Skew window time")
+                    .blurb("Maximum time (milliseconds) used to estimate the clock skew")
+                    .minimum(1)
+                    .default_value(DEFAULT_SKEW_WINDOW_TIME.mseconds() as u32)
+                    .build(),
+                glib::ParamSpecUInt::builder("faststart-min-packets")
+                    .nick("Faststart minimum packets")
+                    .blurb(
+                        "The number of consecutive packets needed to start (set to 0 to disable)",
+                    )
+                    .default_value(DEFAULT_FASTSTART_MIN_PACKETS)
+                    .build(),
+                glib::ParamSpecUInt::builder("max-size-bytes")
+                    .nick("Max size bytes")
+                    .blurb("Maximum number of bytes of queued packets (0 = unlimited)")
+                    .default_value(DEFAULT_MAX_SIZE_BYTES)
+                    .build(),
+                glib::ParamSpecUInt::builder("max-size-time")
+                    .nick("Max size time")
+                    .blurb("Maximum amount of ms of queued packets (0 = unlimited)")
+                    .default_value(DEFAULT_MAX_SIZE_TIME.mseconds() as u32)
+                    .build(),
+                glib::ParamSpecEnum::builder_with_default("drop-policy", DEFAULT_DROP_POLICY)
+                    .nick("Drop policy")
+                    .blurb(
+                        "Packets to drop when a size limit is reached, drop-until-keyframe \
+                         requires upstream to flag non-keyframe packets as DELTA_UNIT",
+                    )
+                    .build(),
+                glib::ParamSpecEnum::builder_with_default("mode", DEFAULT_MODE)
+                    .nick("Mode")
+                    .blurb("Buffering mode, passthrough only holds out of order packets")
+                    .build(),
                 glib::ParamSpecBoxed::builder::<gst::Structure>("stats")
                     .nick("Statistics")
                     .blurb("Various statistics")
@@ -1380,6 +2323,24 @@ impl ObjectImpl for JitterBuffer {
                     .param_types([u32::static_type()])
                     .return_type::<gst::Caps>()
                     .build(),
+                glib::subclass::Signal::builder("export-snapshot")
+                    .return_type::<gst::Structure>()
+                    .action()
+                    .class_handler(|_, args| {
+                        let element = args[0].get::<super::JitterBuffer>().expect("signal arg");
+                        Some(element.imp().export_snapshot().to_value())
+                    })
+                    .build(),
+                glib::subclass::Signal::builder("import-snapshot")
+                    .param_types([gst::Structure::static_type()])
+                    .return_type::<bool>()
+                    .action()
+                    .class_handler(|_, args| {
+                        let element = args[0].get::<super::JitterBuffer>().expect("signal arg");
+                        let snapshot = args[1].get::<gst::Structure>().expect("signal arg");
+                        Some(element.imp().import_snapshot(&snapshot).to_value())
+                    })
+                    .build(),
             ]
         });
 
@@ -1397,17 +2358,54 @@ impl ObjectImpl for JitterBuffer {
                     settings.latency
                 };
 
-                let state = self.state.lock().unwrap();
-                state.jbuf.set_delay(latency);
+                {
+                    let mut state = self.state.lock().unwrap();
+                    state.latency = latency;
+                    state.jbuf.set_delay(latency);
+                }
 
                 let _ = self
                     .obj()
                     .post_message(gst::message::Latency::builder().src(&*self.obj()).build());
             }
+            "adaptive-latency" => {
+                let (adaptive_latency, latency) = {
+                    let mut settings = self.settings.lock().unwrap();
+                    settings.adaptive_latency = value.get().expect("type checked upstream");
+                    (settings.adaptive_latency, settings.latency)
+                };
+
+                // The adaptive latency starts over from the highest one
+                let changed = {
+                    let mut state = self.state.lock().unwrap();
+                    state.adaptive_latency = AdaptiveLatency::default();
+                    let changed = state.latency != latency;
+                    state.latency = latency;
+                    state.jbuf.set_delay(latency);
+                    changed
+                };
+
+                if changed {
+                    gst::debug!(CAT, imp: self, "Adaptive latency {}", adaptive_latency);
+                    let _ = self
+                        .obj()
+                        .post_message(gst::message::Latency::builder().src(&*self.obj()).build());
+                }
+            }
+            "min-latency" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.min_latency = gst::ClockTime::from_mseconds(
+                    value.get::<u32>().expect("type checked upstream").into(),
+                );
+            }
             "do-lost" => {
                 let mut settings = self.settings.lock().unwrap();
                 settings.do_lost = value.get().expect("type checked upstream");
             }
+            "coalesce-lost" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.coalesce_lost = value.get().expect("type checked upstream");
+            }
             "max-dropout-time" => {
                 let mut settings = self.settings.lock().unwrap();
                 settings.max_dropout_time = value.get().expect("type checked upstream");
@@ -1416,6 +2414,55 @@ impl ObjectImpl for JitterBuffer {
                 let mut settings = self.settings.lock().unwrap();
                 settings.max_misorder_time = value.get().expect("type checked upstream");
             }
+            "faststart-min-packets" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.faststart_min_packets = value.get().expect("type checked upstream");
+            }
+            "max-size-bytes" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.max_size_bytes = value.get().expect("type checked upstream");
+            }
+            "max-size-time" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.max_size_time = gst::ClockTime::from_mseconds(
+                    value.get::<u32>().expect("type checked upstream").into(),
+                );
+            }
+            "drop-policy" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.drop_policy = value.get().expect("type checked upstream");
+            }
+            "mode" => {
+                let mode = {
+                    let mut settings = self.settings.lock().unwrap();
+                    settings.mode = value.get().expect("type checked upstream");
+                    settings.mode
+                };
+
+                let mut state = self.state.lock().unwrap();
+                state.jbuf.set_mode(mode.into());
+                state.update_passthrough_packets();
+                // Let the task push the packets that no longer need to wait
+                if let Some((_, abort_handle)) = state.wait_handle.take() {
+                    abort_handle.abort();
+                }
+            }
+            "skew-window-size" | "skew-window-time" => {
+                let (size, time) = {
+                    let mut settings = self.settings.lock().unwrap();
+                    if pspec.name() == "skew-window-size" {
+                        settings.skew_window_size = value.get().expect("type checked upstream");
+                    } else {
+                        settings.skew_window_time = gst::ClockTime::from_mseconds(
+                            value.get::<u32>().expect("type checked upstream").into(),
+                        );
+                    }
+                    (settings.skew_window_size, settings.skew_window_time)
+                };
+
+                let state = self.state.lock().unwrap();
+                state.jbuf.set_skew_window(size, time);
+            }
             "context" => {
                 let mut settings = self.settings.lock().unwrap();
                 settings.context = value
@@ -1429,6 +2476,12 @@ impl ObjectImpl for JitterBuffer {
                     value.get::<u32>().expect("type checked upstream").into(),
                 );
             }
+            "timer-granularity" => {
+                let mut settings = self.settings.lock().unwrap();
+                settings.timer_granularity = gst::ClockTime::from_mseconds(
+                    value.get::<u32>().expect("type checked upstream").into(),
+                );
+            }
             _ => unimplemented!(),
         }
     }
@@ -1439,10 +2492,22 @@ impl ObjectImpl for JitterBuffer {
                 let settings = self.settings.lock().unwrap();
                 (settings.latency.mseconds() as u32).to_value()
             }
+            "adaptive-latency" => {
+                let settings = self.settings.lock().unwrap();
+                settings.adaptive_latency.to_value()
+            }
+            "min-latency" => {
+                let settings = self.settings.lock().unwrap();
+                (settings.min_latency.mseconds() as u32).to_value()
+            }
             "do-lost" => {
                 let settings = self.settings.lock().unwrap();
                 settings.do_lost.to_value()
             }
+            "coalesce-lost" => {
+                let settings = self.settings.lock().unwrap();
+                settings.coalesce_lost.to_value()
+            }
             "max-dropout-time" => {
                 let settings = self.settings.lock().unwrap();
                 settings.max_dropout_time.to_value()
@@ -1451,14 +2516,68 @@ impl ObjectImpl for JitterBuffer {
                 let settings = self.settings.lock().unwrap();
                 settings.max_misorder_time.to_value()
             }
+            "faststart-min-packets" => {
+                let settings = self.settings.lock().unwrap();
+                settings.faststart_min_packets.to_value()
+            }
+            "max-size-bytes" => {
+                let settings = self.settings.lock().unwrap();
+                settings.max_size_bytes.to_value()
+            }
+            "max-size-time" => {
+                let settings = self.settings.lock().unwrap();
+                (settings.max_size_time.mseconds() as u32).to_value()
+            }
+            "drop-policy" => {
+                let settings = self.settings.lock().unwrap();
+                settings.drop_policy.to_value()
+            }
+            "mode" => {
+                let settings = self.settings.lock().unwrap();
+                settings.mode.to_value()
+            }
+            "skew-window-size" => {
+                let settings = self.settings.lock().unwrap();
+                settings.skew_window_size.to_value()
+            }
+            "skew-window-time" => {
+                let settings = self.settings.lock().unwrap();
+                (settings.skew_window_time.mseconds() as u32).to_value()
+            }
             "stats" => {
                 let state = self.state.lock().unwrap();
+                let (_, pool_high_water) = state.jbuf.pool_stats();
                 let s = gst::Structure::builder("application/x-rtp-jitterbuffer-stats")
                     .field("num-pushed", state.stats.num_pushed)
                     .field("num-lost", state.stats.num_lost)
                     .field("num-late", state.stats.num_late)
-                    .build();
-                s.to_value()
+                    .field("num-dropped", state.stats.num_dropped)
+                    .field("num-out-of-range", state.stats.num_out_of_range)
+                    .field("item-pool-high-water", pool_high_water)
+                    .field("latency", state.latency.nseconds())
+                    .field("jitter", state.jbuf.jitter().nseconds());
+
+                #[cfg(feature = "tuning")]
+                let s = {
+                    let tuning = state.jbuf.tuning_stats();
+                    s.field("insert-walk", histogram_to_array(&tuning.insert_walk))
+                        .field(
+                            "reorder-distance",
+                            histogram_to_array(&tuning.reorder_distance),
+                        )
+                        .field("queue-depth", histogram_to_array(&tuning.queue_depth))
+                        .field("num-resyncs", tuning.num_resyncs)
+                        .field("num-skew-resets", tuning.num_skew_resets)
+                        .field("skew", tuning.skew)
+                        .field("window-min", tuning.window_min)
+                        .field(
+                            "lock-hold-us",
+                            histogram_to_array(&state.stats.lock_hold.histogram),
+                        )
+                        .field("lock-hold-max", state.stats.lock_hold.max.as_nanos() as u64)
+                };
+
+                s.build().to_value()
             }
             "context" => {
                 let settings = self.settings.lock().unwrap();
@@ -1468,6 +2587,10 @@ impl ObjectImpl for JitterBuffer {
                 let settings = self.settings.lock().unwrap();
                 (settings.context_wait.mseconds() as u32).to_value()
             }
+            "timer-granularity" => {
+                let settings = self.settings.lock().unwrap();
+                (settings.timer_granularity.mseconds() as u32).to_value()
+            }
             _ => unimplemented!(),
         }
     }
@@ -1487,6 +2610,10 @@ impl GstObjectImpl for JitterBuffer {}
 impl ElementImpl for JitterBuffer {
     fn metadata() -> Option<&'static gst::subclass::ElementMetadata> {
         static ELEMENT_METADATA: Lazy<gst::subclass::ElementMetadata> = Lazy::new(|| {
+            #[cfg(feature = "doc")]
+            DropPolicy::static_type().mark_as_plugin_api(gst::PluginAPIFlags::empty());
+            #[cfg(feature = "doc")]
+            Mode::static_type().mark_as_plugin_api(gst::PluginAPIFlags::empty());
             gst::subclass::ElementMetadata::new(
                 "Thread-sharing jitterbuffer",
                 "Generic",
@@ -36,7 +36,10 @@ glib::wrapper! {
     }
 }
 
-// SAFETY: We ensure that we never get another reference to the jitterbuffer
+// SAFETY: The jitterbuffer is only used by one thread at a time, through the
+// state of the element which is behind a lock. The items also hold references
+// to it, but only to allocate from and free into its item pool, which has its
+// own lock.
 unsafe impl Send for RTPJitterBuffer {}
 
 impl IntoGlib for RTPJitterBufferMode {
@@ -48,6 +51,7 @@ impl IntoGlib for RTPJitterBufferMode {
             RTPJitterBufferMode::Slave => ffi::RTP_JITTER_BUFFER_MODE_SLAVE,
             RTPJitterBufferMode::Buffer => ffi::RTP_JITTER_BUFFER_MODE_BUFFER,
             RTPJitterBufferMode::Synced => ffi::RTP_JITTER_BUFFER_MODE_SYNCED,
+            RTPJitterBufferMode::Passthrough => ffi::RTP_JITTER_BUFFER_MODE_PASSTHROUGH,
             RTPJitterBufferMode::__Unknown(value) => value,
         }
     }
@@ -60,44 +64,124 @@ impl FromGlib<ffi::RTPJitterBufferMode> for RTPJitterBufferMode {
             1 => RTPJitterBufferMode::Slave,
             2 => RTPJitterBufferMode::Buffer,
             4 => RTPJitterBufferMode::Synced,
+            5 => RTPJitterBufferMode::Passthrough,
             value => RTPJitterBufferMode::__Unknown(value),
         }
     }
 }
 
-pub struct RTPJitterBufferItem(Option<ptr::NonNull<ffi::RTPJitterBufferItem>>);
+impl FromGlib<ffi::RTPJitterBufferInsertResult> for RTPJitterBufferInsertResult {
+    unsafe fn from_glib(value: ffi::RTPJitterBufferInsertResult) -> Self {
+        match value {
+            ffi::RTP_JITTER_BUFFER_INSERT_OK => RTPJitterBufferInsertResult::Inserted,
+            ffi::RTP_JITTER_BUFFER_INSERT_DUPLICATE => RTPJitterBufferInsertResult::Duplicate,
+            ffi::RTP_JITTER_BUFFER_INSERT_OUT_OF_RANGE => RTPJitterBufferInsertResult::OutOfRange,
+            value => unreachable!("Invalid insert result {}", value),
+        }
+    }
+}
 
+// The RTP header fields of a packet, parsed with a single map of the buffer when
+// the packet is received
+#[derive(Debug, Default, Clone, Copy, PartialEq, Eq)]
+pub struct RTPPacketHeader {
+    pub seqnum: u16,
+    pub rtptime: u32,
+    pub ssrc: u32,
+    pub pt: u8,
+    pub size: u32,
+}
+
+impl RTPPacketHeader {
+    pub fn parse(buffer: &gst::Buffer) -> Option<RTPPacketHeader> {
+        let rtp_buffer = gst_rtp::RTPBuffer::from_buffer_readable(buffer).ok()?;
+
+        Some(RTPPacketHeader {
+            seqnum: rtp_buffer.seq(),
+            rtptime: rtp_buffer.timestamp(),
+            ssrc: rtp_buffer.ssrc(),
+            pt: rtp_buffer.payload_type(),
+            size: buffer.size() as u32,
+        })
+    }
+}
+
+// The item is allocated from and given back to the item pool of the
+// jitterbuffer it holds.
+pub struct RTPJitterBufferItem(
+    Option<ptr::NonNull<ffi::RTPJitterBufferItem>>,
+    RTPJitterBuffer,
+);
+
+// SAFETY: The item owns its packet, and only uses its jitterbuffer to give
+// itself back to the item pool, which can be done from any thread.
 unsafe impl Send for RTPJitterBufferItem {}
 
 impl RTPJitterBufferItem {
     pub fn new(
+        jbuf: &RTPJitterBuffer,
         buffer: gst::Buffer,
         dts: impl Into<Option<gst::ClockTime>>,
         pts: impl Into<Option<gst::ClockTime>>,
         seqnum: Option<u16>,
         rtptime: u32,
+    ) -> RTPJitterBufferItem {
+        let size = buffer.size() as u32;
+
+        Self::with_fields(
+            jbuf,
+            ffi::RTPJitterBufferItem {
+                data: buffer.into_glib_ptr() as *mut _,
+                next: ptr::null_mut(),
+                prev: ptr::null_mut(),
+                r#type: 0,
+                dts: dts.into().into_glib(),
+                pts: pts.into().into_glib(),
+                seqnum: seqnum.map(|s| s as u32).unwrap_or(std::u32::MAX),
+                count: 1,
+                rtptime,
+                heap_index: 0,
+                size,
+            },
+        )
+    }
+
+    // Creates the item of a packet from its already parsed header
+    pub fn from_packet(
+        jbuf: &RTPJitterBuffer,
+        buffer: gst::Buffer,
+        dts: impl Into<Option<gst::ClockTime>>,
+        pts: impl Into<Option<gst::ClockTime>>,
+        header: &RTPPacketHeader,
+    ) -> RTPJitterBufferItem {
+        Self::with_fields(
+            jbuf,
+            ffi::RTPJitterBufferItem {
+                data: buffer.into_glib_ptr() as *mut _,
+                next: ptr::null_mut(),
+                prev: ptr::null_mut(),
+                r#type: 0,
+                dts: dts.into().into_glib(),
+                pts: pts.into().into_glib(),
+                seqnum: header.seqnum as u32,
+                count: 1,
+                rtptime: header.rtptime,
+                heap_index: 0,
+                size: header.size,
+            },
+        )
+    }
+
+    fn with_fields(
+        jbuf: &RTPJitterBuffer,
+        fields: ffi::RTPJitterBufferItem,
     ) -> RTPJitterBufferItem {
         unsafe {
-            let ptr = ptr::NonNull::new(glib::ffi::g_slice_alloc0(mem::size_of::<
-                ffi::RTPJitterBufferItem,
-            >()) as *mut ffi::RTPJitterBufferItem)
-            .expect("Allocation failed");
-            ptr::write(
-                ptr.as_ptr(),
-                ffi::RTPJitterBufferItem {
-                    data: buffer.into_glib_ptr() as *mut _,
-                    next: ptr::null_mut(),
-                    prev: ptr::null_mut(),
-                    r#type: 0,
-                    dts: dts.into().into_glib(),
-                    pts: pts.into().into_glib(),
-                    seqnum: seqnum.map(|s| s as u32).unwrap_or(std::u32::MAX),
-                    count: 1,
-                    rtptime,
-                },
-            );
+            let ptr = ptr::NonNull::new(ffi::rtp_jitter_buffer_alloc_item(jbuf.to_glib_none().0))
+                .expect("Allocation failed");
+            ptr::write(ptr.as_ptr(), fields);
 
-            RTPJitterBufferItem(Some(ptr))
+            RTPJitterBufferItem(Some(ptr), jbuf.clone())
         }
     }
 
@@ -105,10 +189,7 @@ impl RTPJitterBufferItem {
         unsafe {
             let item = self.0.take().expect("Invalid wrapper");
             let buf = item.as_ref().data as *mut gst::ffi::GstBuffer;
-            glib::ffi::g_slice_free1(
-                mem::size_of::<ffi::RTPJitterBufferItem>(),
-                item.as_ptr() as *mut _,
-            );
+            ffi::rtp_jitter_buffer_free_item(self.1.to_glib_none().0, item.as_ptr());
             from_glib_full(buf)
         }
     }
@@ -146,13 +227,27 @@ impl RTPJitterBufferItem {
         }
     }
 
-    #[allow(dead_code)]
     pub fn rtptime(&self) -> u32 {
         unsafe {
             let item = self.0.as_ref().expect("Invalid wrapper");
             item.as_ref().rtptime
         }
     }
+
+    pub fn size(&self) -> usize {
+        unsafe {
+            let item = self.0.as_ref().expect("Invalid wrapper");
+            item.as_ref().size as usize
+        }
+    }
+
+    // The flags of the packet, the item must hold one
+    pub fn flags(&self) -> gst::BufferFlags {
+        unsafe {
+            let item = self.0.as_ref().expect("Invalid wrapper");
+            gst::BufferRef::from_ptr(item.as_ref().data as *const gst::ffi::GstBuffer).flags()
+        }
+    }
 }
 
 impl Drop for RTPJitterBufferItem {
@@ -163,16 +258,37 @@ impl Drop for RTPJitterBufferItem {
                     gst::ffi::gst_mini_object_unref(item.as_ref().data as *mut _);
                 }
 
-                glib::ffi::g_slice_free1(
-                    mem::size_of::<ffi::RTPJitterBufferItem>(),
-                    item.as_ptr() as *mut _,
-                );
+                ffi::rtp_jitter_buffer_free_item(self.1.to_glib_none().0, item.as_ptr());
             }
         }
     }
 }
 
-pub struct RTPPacketRateCtx(Box<ffi::RTPPacketRateCtx>);
+pub struct RTPTimeScale(ffi::RTPTimeScale);
+
+impl RTPTimeScale {
+    pub fn new(clock_rate: u32) -> RTPTimeScale {
+        unsafe {
+            let mut scale = mem::MaybeUninit::zeroed();
+            ffi::gst_rtp_time_scale_init(scale.as_mut_ptr(), clock_rate);
+            RTPTimeScale(scale.assume_init())
+        }
+    }
+
+    pub fn to_time(&self, rtptime: u64) -> u64 {
+        unsafe { ffi::gst_rtp_time_scale_to_time(&self.0, rtptime) }
+    }
+
+    pub fn to_rtp(&self, time: u64) -> u64 {
+        unsafe { ffi::gst_rtp_time_scale_to_rtp(&self.0, time) }
+    }
+}
+
+pub struct RTPPacketRateCtx {
+    ctx: Box<ffi::RTPPacketRateCtx>,
+    // Reused by `update_list()`
+    entries: Vec<ffi::RTPPacketRateEntry>,
+}
 
 unsafe impl Send for RTPPacketRateCtx {}
 
@@ -181,25 +297,88 @@ impl RTPPacketRateCtx {
         unsafe {
             let mut ptr = std::mem::MaybeUninit::uninit();
             ffi::gst_rtp_packet_rate_ctx_reset(ptr.as_mut_ptr(), -1);
-            RTPPacketRateCtx(Box::new(ptr.assume_init()))
+            RTPPacketRateCtx {
+                ctx: Box::new(ptr.assume_init()),
+                entries: Vec::new(),
+            }
         }
     }
 
     pub fn reset(&mut self, clock_rate: i32) {
-        unsafe { ffi::gst_rtp_packet_rate_ctx_reset(&mut *self.0, clock_rate) }
+        unsafe { ffi::gst_rtp_packet_rate_ctx_reset(&mut *self.ctx, clock_rate) }
     }
 
     pub fn update(&mut self, seqnum: u16, ts: u32) -> u32 {
-        unsafe { ffi::gst_rtp_packet_rate_ctx_update(&mut *self.0, seqnum, ts) }
+        unsafe { ffi::gst_rtp_packet_rate_ctx_update(&mut *self.ctx, seqnum, ts) }
+    }
+
+    // Accounts for the `(seqnum, rtptime)` of `packets` in a single call and returns
+    // the `(max_dropout, max_misorder)` once each of them is accounted for, as calling
+    // `update()`, `max_dropout()` and `max_misorder()` for every packet would
+    pub fn update_list(
+        &mut self,
+        packets: impl IntoIterator<Item = (u16, u32)>,
+        dropout_ms: i32,
+        misorder_ms: i32,
+    ) -> impl ExactSizeIterator<Item = (u32, u32)> + '_ {
+        self.entries.clear();
+        self.entries.extend(
+            packets
+                .into_iter()
+                .map(|(seqnum, ts)| ffi::RTPPacketRateEntry {
+                    seqnum,
+                    ts,
+                    ..Default::default()
+                }),
+        );
+
+        unsafe {
+            ffi::gst_rtp_packet_rate_ctx_update_list(
+                &mut *self.ctx,
+                self.entries.as_mut_ptr(),
+                self.entries.len() as u32,
+                dropout_ms,
+                misorder_ms,
+            );
+        }
+
+        self.entries
+            .iter()
+            .map(|entry| (entry.max_dropout, entry.max_misorder))
     }
 
     pub fn max_dropout(&mut self, time_ms: i32) -> u32 {
-        unsafe { ffi::gst_rtp_packet_rate_ctx_get_max_dropout(&mut *self.0, time_ms) }
+        unsafe { ffi::gst_rtp_packet_rate_ctx_get_max_dropout(&mut *self.ctx, time_ms) }
     }
 
     pub fn max_misorder(&mut self, time_ms: i32) -> u32 {
-        unsafe { ffi::gst_rtp_packet_rate_ctx_get_max_misorder(&mut *self.0, time_ms) }
+        unsafe { ffi::gst_rtp_packet_rate_ctx_get_max_misorder(&mut *self.ctx, time_ms) }
     }
+
+    // Average packet rate, `None` until estimated
+    pub fn rate(&self) -> Option<u32> {
+        Some(self.ctx.avg_packet_rate).filter(|&rate| rate != u32::MAX)
+    }
+
+    // Continues from a previously estimated rate, after a `reset()`
+    pub fn set_rate(&mut self, rate: u32) {
+        self.ctx.avg_packet_rate = rate;
+    }
+}
+
+// Timing state of a converged `RTPJitterBuffer`, see `RTPJitterBuffer::snapshot()`
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct RTPJitterBufferSnapshot {
+    pub clock_rate: u32,
+    // Running time of the base of the timing and its RTP time
+    pub base_time: gst::ClockTime,
+    pub base_rtptime: gst::ClockTime,
+    pub base_extrtp: u64,
+    pub ext_rtptime: u64,
+    pub skew: i64,
+    pub jitter: gst::ClockTime,
+    // Skew window samples, oldest first
+    pub window: Vec<i64>,
 }
 
 impl Default for RTPPacketRateCtx {
@@ -214,9 +393,20 @@ pub enum RTPJitterBufferMode {
     Slave,
     Buffer,
     Synced,
+    // Like `Slave`, the element only holds packets back on gaps and reordering
+    Passthrough,
     __Unknown(i32),
 }
 
+// Why a packet was or wasn't inserted in the jitterbuffer
+#[derive(Debug, Eq, PartialEq, Clone, Copy)]
+pub enum RTPJitterBufferInsertResult {
+    Inserted,
+    Duplicate,
+    // Too far from the queued packets to be ordered with them
+    OutOfRange,
+}
+
 impl RTPJitterBuffer {
     pub fn new() -> RTPJitterBuffer {
         unsafe { from_glib_full(ffi::rtp_jitter_buffer_new()) }
@@ -248,6 +438,12 @@ impl RTPJitterBuffer {
         unsafe { ffi::rtp_jitter_buffer_set_clock_rate(self.to_glib_none().0, clock_rate) }
     }
 
+    pub fn set_skew_window(&self, size: u32, time: gst::ClockTime) {
+        unsafe {
+            ffi::rtp_jitter_buffer_set_skew_window(self.to_glib_none().0, size, time.into_glib())
+        }
+    }
+
     #[allow(dead_code)]
     pub fn clock_rate(&self) -> u32 {
         unsafe { ffi::rtp_jitter_buffer_get_clock_rate(self.to_glib_none().0) }
@@ -275,6 +471,7 @@ impl RTPJitterBuffer {
         }
     }
 
+    #[allow(dead_code)]
     pub fn insert(&self, mut item: RTPJitterBufferItem) -> (bool, bool, i32) {
         unsafe {
             let mut head = mem::MaybeUninit::uninit();
@@ -293,6 +490,50 @@ impl RTPJitterBuffer {
         }
     }
 
+    // Returns for each item whether it was inserted or why not, the refused ones are dropped
+    pub fn insert_list(
+        &self,
+        mut items: Vec<RTPJitterBufferItem>,
+    ) -> (Vec<RTPJitterBufferInsertResult>, bool, i32) {
+        unsafe {
+            let mut head = mem::MaybeUninit::uninit();
+            let mut percent = mem::MaybeUninit::uninit();
+            let mut ptrs = items
+                .iter_mut()
+                .map(|item| item.0.take().expect("Invalid wrapper").as_ptr())
+                .collect::<Vec<_>>();
+            let mut results = vec![ffi::RTP_JITTER_BUFFER_INSERT_OK; ptrs.len()];
+
+            ffi::rtp_jitter_buffer_insert_list(
+                self.to_glib_none().0,
+                ptrs.as_mut_ptr(),
+                ptrs.len() as u32,
+                results.as_mut_ptr(),
+                head.as_mut_ptr(),
+                percent.as_mut_ptr(),
+            );
+
+            let results = items
+                .iter_mut()
+                .zip(ptrs)
+                .zip(results)
+                .map(|((item, ptr), result)| {
+                    let result = RTPJitterBufferInsertResult::from_glib(result);
+                    if result != RTPJitterBufferInsertResult::Inserted {
+                        item.0 = ptr::NonNull::new(ptr);
+                    }
+                    result
+                })
+                .collect();
+
+            (
+                results,
+                from_glib(head.assume_init()),
+                percent.assume_init(),
+            )
+        }
+    }
+
     pub fn find_earliest(&self) -> (Option<gst::ClockTime>, Option<u16>) {
         unsafe {
             let mut pts = mem::MaybeUninit::uninit();
@@ -325,13 +566,62 @@ impl RTPJitterBuffer {
                 if item.is_null() {
                     None
                 } else {
-                    Some(RTPJitterBufferItem(Some(ptr::NonNull::new_unchecked(item))))
+                    Some(RTPJitterBufferItem(
+                        Some(ptr::NonNull::new_unchecked(item)),
+                        self.clone(),
+                    ))
                 },
                 percent.assume_init(),
             )
         }
     }
 
+    // Pops up to `max_items` items while the earliest queued pts is at most `max_pts`,
+    // all of them if `max_pts` is `None`
+    pub fn pop_ready(
+        &self,
+        max_pts: impl Into<Option<gst::ClockTime>>,
+        max_items: usize,
+    ) -> (Vec<RTPJitterBufferItem>, i32) {
+        unsafe {
+            let mut percent = mem::MaybeUninit::uninit();
+            let mut items = Vec::with_capacity(max_items);
+
+            let n_items = ffi::rtp_jitter_buffer_pop_ready(
+                self.to_glib_none().0,
+                max_pts.into().into_glib(),
+                items.as_mut_ptr(),
+                max_items as u32,
+                percent.as_mut_ptr(),
+            );
+            items.set_len(n_items as usize);
+
+            (
+                items
+                    .into_iter()
+                    .map(|item| {
+                        RTPJitterBufferItem(Some(ptr::NonNull::new_unchecked(item)), self.clone())
+                    })
+                    .collect(),
+                percent.assume_init(),
+            )
+        }
+    }
+
+    // Returns the RTP timestamp and the buffer flags of the first queued packet
+    pub fn peek_packet(&self) -> Option<(u32, gst::BufferFlags)> {
+        unsafe {
+            let item = ffi::rtp_jitter_buffer_peek(self.to_glib_none().0);
+            if item.is_null() {
+                None
+            } else {
+                let buffer = gst::BufferRef::from_ptr((*item).data as *const gst::ffi::GstBuffer);
+                Some(((*item).rtptime, buffer.flags()))
+            }
+        }
+    }
+
+    #[allow(dead_code)]
     pub fn peek(&self) -> (Option<gst::ClockTime>, Option<u16>) {
         unsafe {
             let item = ffi::rtp_jitter_buffer_peek(self.to_glib_none().0);
@@ -350,19 +640,151 @@ impl RTPJitterBuffer {
     }
 
     pub fn flush(&self) {
-        unsafe extern "C" fn free_item(item: glib::ffi::gpointer, _: glib::ffi::gpointer) {
-            let _ =
-                RTPJitterBufferItem(Some(ptr::NonNull::new(item as *mut _).expect("NULL item")));
+        unsafe extern "C" fn free_item(item: glib::ffi::gpointer, jbuf: glib::ffi::gpointer) {
+            let item = item as *mut ffi::RTPJitterBufferItem;
+            if !(*item).data.is_null() {
+                gst::ffi::gst_mini_object_unref((*item).data as *mut _);
+            }
+
+            ffi::rtp_jitter_buffer_free_item(jbuf as *mut _, item);
+        }
+
+        unsafe {
+            let jbuf: *mut ffi::RTPJitterBuffer = self.to_glib_none().0;
+            ffi::rtp_jitter_buffer_flush(jbuf, Some(free_item), jbuf as glib::ffi::gpointer);
         }
+    }
 
+    // Returns the number of unused items in the item pool and the maximum
+    // number of items that were in use at once.
+    pub fn pool_stats(&self) -> (u32, u32) {
         unsafe {
-            ffi::rtp_jitter_buffer_flush(self.to_glib_none().0, Some(free_item));
+            let mut n_free = mem::MaybeUninit::uninit();
+            let mut high_water = mem::MaybeUninit::uninit();
+
+            ffi::rtp_jitter_buffer_get_pool_stats(
+                self.to_glib_none().0,
+                n_free.as_mut_ptr(),
+                high_water.as_mut_ptr(),
+            );
+
+            (n_free.assume_init(), high_water.assume_init())
         }
     }
 
     pub fn reset_skew(&self) {
         unsafe { ffi::rtp_jitter_buffer_reset_skew(self.to_glib_none().0) }
     }
+
+    // Current estimate of the clock skew, in nanoseconds
+    pub fn skew(&self) -> i64 {
+        unsafe { ffi::rtp_jitter_buffer_get_skew(self.to_glib_none().0) }
+    }
+
+    // Timing state to continue from in another jitterbuffer for the same stream,
+    // `None` until the skew window is filled
+    pub fn snapshot(&self) -> Option<RTPJitterBufferSnapshot> {
+        unsafe {
+            let mut snapshot = mem::MaybeUninit::<ffi::RTPJitterBufferSnapshot>::uninit();
+            if from_glib(ffi::rtp_jitter_buffer_get_snapshot(
+                self.to_glib_none().0,
+                snapshot.as_mut_ptr(),
+            )) {
+                let snapshot = snapshot.assume_init();
+                Some(RTPJitterBufferSnapshot {
+                    clock_rate: snapshot.clock_rate,
+                    base_time: gst::ClockTime::from_nseconds(snapshot.base_time),
+                    base_rtptime: gst::ClockTime::from_nseconds(snapshot.base_rtptime),
+                    base_extrtp: snapshot.base_extrtp,
+                    ext_rtptime: snapshot.ext_rtptime,
+                    skew: snapshot.skew,
+                    jitter: gst::ClockTime::from_nseconds(snapshot.jitter >> 4),
+                    window: snapshot.window[..snapshot.window_size as usize].to_vec(),
+                })
+            } else {
+                None
+            }
+        }
+    }
+
+    // Returns `false` if the snapshot is invalid or for another clock rate
+    pub fn set_snapshot(&self, snapshot: &RTPJitterBufferSnapshot) -> bool {
+        if snapshot.window.len() > ffi::RTP_JITTER_BUFFER_MAX_WINDOW {
+            return false;
+        }
+
+        let mut window = [0; ffi::RTP_JITTER_BUFFER_MAX_WINDOW];
+        window[..snapshot.window.len()].copy_from_slice(&snapshot.window);
+        let snapshot = ffi::RTPJitterBufferSnapshot {
+            clock_rate: snapshot.clock_rate,
+            base_time: snapshot.base_time.into_glib(),
+            base_rtptime: snapshot.base_rtptime.into_glib(),
+            base_extrtp: snapshot.base_extrtp,
+            ext_rtptime: snapshot.ext_rtptime,
+            skew: snapshot.skew,
+            jitter: snapshot.jitter.nseconds() << 4,
+            window_size: snapshot.window.len() as u32,
+            window,
+        };
+
+        unsafe {
+            from_glib(ffi::rtp_jitter_buffer_set_snapshot(
+                self.to_glib_none().0,
+                &snapshot,
+            ))
+        }
+    }
+
+    // RFC 3550 interarrival jitter of the packets passed to calculate_pts()
+    pub fn jitter(&self) -> gst::ClockTime {
+        unsafe {
+            gst::ClockTime::from_nseconds(ffi::rtp_jitter_buffer_get_jitter(self.to_glib_none().0))
+        }
+    }
+
+    // Size of the queued buffers
+    pub fn bytes(&self) -> u64 {
+        unsafe { ffi::rtp_jitter_buffer_get_bytes(self.to_glib_none().0) }
+    }
+
+    // Difference between the RTP timestamps of the first and the last queued packet
+    pub fn ts_diff(&self) -> u32 {
+        unsafe { ffi::rtp_jitter_buffer_get_ts_diff(self.to_glib_none().0) }
+    }
+
+    // Whether the first `num_packets` queued packets have consecutive seqnums
+    pub fn can_fast_start(&self, num_packets: u32) -> bool {
+        unsafe {
+            from_glib(ffi::rtp_jitter_buffer_can_fast_start(
+                self.to_glib_none().0,
+                num_packets as i32,
+            ))
+        }
+    }
+
+    // Number of packets with consecutive seqnums at the head of the queue if
+    // it starts with `seqnum`, whatever the first one is if `None`
+    pub fn num_contiguous(&self, seqnum: Option<u16>) -> u32 {
+        unsafe {
+            ffi::rtp_jitter_buffer_num_contiguous(
+                self.to_glib_none().0,
+                seqnum.map_or(-1, |seqnum| seqnum as i32),
+            )
+        }
+    }
+
+    pub fn is_full(&self) -> bool {
+        unsafe { from_glib(ffi::rtp_jitter_buffer_is_full(self.to_glib_none().0)) }
+    }
+
+    #[cfg(feature = "tuning")]
+    pub fn tuning_stats(&self) -> ffi::RTPJitterBufferTuningStats {
+        unsafe {
+            let mut stats = mem::MaybeUninit::uninit();
+            ffi::rtp_jitter_buffer_get_tuning_stats(self.to_glib_none().0, stats.as_mut_ptr());
+            stats.assume_init()
+        }
+    }
 }
 
 impl Default for RTPJitterBuffer {
@@ -370,3 +792,202 @@ impl Default for RTPJitterBuffer {
         RTPJitterBuffer::new()
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    use rand::{rngs::StdRng, Rng, SeedableRng};
+
+    #[test]
+    fn time_scale_matches_uint64_scale() {
+        let scale =
+            |val: u64, num: u64, denom: u64| val.mul_div_floor(num, denom).unwrap_or(u64::MAX);
+        let mut rng = StdRng::seed_from_u64(0);
+
+        // The fast paths, other common rates, and rates that need the 65 bit multiplier
+        // or overflow the scaled values
+        for clock_rate in [
+            90000u32,
+            48000,
+            44100,
+            16000,
+            8000,
+            1,
+            3,
+            7,
+            1000,
+            11025,
+            22050,
+            32000,
+            96000,
+            65536,
+            1_000_000_000,
+            1_000_000_007,
+            i32::MAX as u32,
+        ] {
+            let time_scale = RTPTimeScale::new(clock_rate);
+            let second = gst::ClockTime::SECOND.nseconds();
+
+            // Around the largest values that convert without saturating
+            let edges = [
+                u64::MAX.mul_div_floor(clock_rate as u64, second),
+                u64::MAX.mul_div_floor(second, clock_rate as u64),
+            ];
+            let values = (0..4 * clock_rate.min(100_000) as u64)
+                .chain((0..100_000).map(|_| rng.gen::<u64>() >> rng.gen_range(0..64)))
+                .chain((0..1000).map(|i| u64::MAX - i))
+                .chain(
+                    edges
+                        .into_iter()
+                        .flatten()
+                        .flat_map(|edge| edge.saturating_sub(500)..edge.saturating_add(500)),
+                );
+
+            for val in values {
+                assert_eq!(
+                    time_scale.to_time(val),
+                    scale(val, second, clock_rate as u64),
+                    "{val} at {clock_rate} Hz"
+                );
+                assert_eq!(
+                    time_scale.to_rtp(val),
+                    scale(val, clock_rate as u64, second),
+                    "{val} ns at {clock_rate} Hz"
+                );
+            }
+        }
+    }
+
+    #[test]
+    fn item_caches_rtp_header() {
+        use gst_rtp::prelude::*;
+
+        gst::init().unwrap();
+
+        let mut buffer = gst::Buffer::new_rtp_with_sizes(160, 0, 2).unwrap();
+        {
+            let buffer = buffer.get_mut().unwrap();
+            let mut rtp_buffer = gst_rtp::RTPBuffer::from_buffer_writable(buffer).unwrap();
+            rtp_buffer.set_seq(42);
+            rtp_buffer.set_timestamp(1234);
+            rtp_buffer.set_ssrc(0xdead_beef);
+            rtp_buffer.set_payload_type(96);
+        }
+
+        let header = RTPPacketHeader::parse(&buffer).unwrap();
+        assert_eq!(
+            header,
+            RTPPacketHeader {
+                seqnum: 42,
+                rtptime: 1234,
+                ssrc: 0xdead_beef,
+                pt: 96,
+                size: 180,
+            }
+        );
+
+        let jb = RTPJitterBuffer::new();
+        let item = RTPJitterBufferItem::from_packet(
+            &jb,
+            buffer,
+            gst::ClockTime::NONE,
+            gst::ClockTime::NONE,
+            &header,
+        );
+        assert_eq!(item.seqnum(), Some(42));
+        assert_eq!(item.rtptime(), 1234);
+        assert_eq!(item.size(), 180);
+
+        jb.insert(item);
+        assert_eq!(jb.bytes(), 180);
+    }
+
+    #[test]
+    fn insert_list_reports_refused_packets() {
+        use gst_rtp::prelude::*;
+
+        gst::init().unwrap();
+
+        let jb = RTPJitterBuffer::new();
+        let new_item = |seqnum: u16| {
+            let mut buffer = gst::Buffer::new_rtp_with_sizes(160, 0, 0).unwrap();
+            {
+                let buffer = buffer.get_mut().unwrap();
+                let mut rtp_buffer = gst_rtp::RTPBuffer::from_buffer_writable(buffer).unwrap();
+                rtp_buffer.set_seq(seqnum);
+            }
+            let header = RTPPacketHeader::parse(&buffer).unwrap();
+            RTPJitterBufferItem::from_packet(
+                &jb,
+                buffer,
+                gst::ClockTime::NONE,
+                gst::ClockTime::NONE,
+                &header,
+            )
+        };
+
+        // 60000 would make the queued packets span more seqnums than the ring can hold
+        let items = vec![new_item(0), new_item(30000), new_item(0), new_item(60000)];
+        let (results, _, _) = jb.insert_list(items);
+        assert_eq!(
+            results,
+            [
+                RTPJitterBufferInsertResult::Inserted,
+                RTPJitterBufferInsertResult::Inserted,
+                RTPJitterBufferInsertResult::Duplicate,
+                RTPJitterBufferInsertResult::OutOfRange,
+            ]
+        );
+        assert_eq!(jb.bytes(), 2 * 172);
+    }
+
+    #[test]
+    fn snapshot_continues_skew_estimation() {
+        gst::init().unwrap();
+
+        let new_jb = || {
+            let jb = RTPJitterBuffer::new();
+            jb.set_delay(gst::ClockTime::from_mseconds(200));
+            jb.set_clock_rate(8000);
+            jb
+        };
+        let mut rng = StdRng::seed_from_u64(0);
+        // 20ms packets from a sender clock 100ppm slower, with up to 4ms of jitter
+        let mut packets = (0..300u64).map(|idx| {
+            let dts =
+                gst::ClockTime::from_nseconds(idx * 20_002_000 + rng.gen_range(0..4) * 1_000_000);
+            (dts, (idx * 160) as u32)
+        });
+
+        let jb = new_jb();
+        for (dts, rtptime) in packets.by_ref().take(10) {
+            jb.calculate_pts(dts, false, rtptime, gst::ClockTime::ZERO, 0, false);
+        }
+        // Not converged yet
+        assert_eq!(jb.snapshot(), None);
+
+        for (dts, rtptime) in packets.by_ref().take(140) {
+            jb.calculate_pts(dts, false, rtptime, gst::ClockTime::ZERO, 0, false);
+        }
+        let snapshot = jb.snapshot().unwrap();
+        assert_eq!(snapshot.clock_rate, 8000);
+        assert!(!snapshot.window.is_empty());
+
+        let other_rate = RTPJitterBuffer::new();
+        other_rate.set_clock_rate(90000);
+        assert!(!other_rate.set_snapshot(&snapshot));
+
+        // Continues exactly like the jitterbuffer the snapshot comes from
+        let warm = new_jb();
+        assert!(warm.set_snapshot(&snapshot));
+        assert_eq!(warm.skew(), jb.skew());
+        for (dts, rtptime) in packets {
+            assert_eq!(
+                warm.calculate_pts(dts, false, rtptime, gst::ClockTime::ZERO, 0, false),
+                jb.calculate_pts(dts, false, rtptime, gst::ClockTime::ZERO, 0, false)
+            );
+        }
+        assert_eq!(warm.skew(), jb.skew());
+    }
+}
@@ -25,6 +25,53 @@ mod imp;
 #[allow(clippy::module_inception)]
 pub mod jitterbuffer;
 
+#[derive(Debug, Eq, PartialEq, Clone, Copy, glib::Enum)]
+#[repr(u32)]
+#[enum_type(name = "GstTsJitterBufferDropPolicy")]
+pub enum DropPolicy {
+    #[enum_value(
+        name = "DropOldest: Drop the oldest queued packets.",
+        nick = "drop-oldest"
+    )]
+    DropOldest,
+    #[enum_value(name = "DropNewest: Drop the incoming packets.", nick = "drop-newest")]
+    DropNewest,
+    // RTP packets carry no keyframe information: keyframes are the packets
+    // upstream did not flag as DELTA_UNIT, e.g. a depayloader-aware element
+    #[enum_value(
+        name = "DropUntilKeyframe: Drop the oldest queued packets up to the next keyframe \
+                (a packet without the DELTA_UNIT flag).",
+        nick = "drop-until-keyframe"
+    )]
+    DropUntilKeyframe,
+}
+
+#[derive(Debug, Eq, PartialEq, Clone, Copy, glib::Enum)]
+#[repr(u32)]
+#[enum_type(name = "GstTsJitterBufferMode")]
+pub enum Mode {
+    #[enum_value(
+        name = "Slave: Slave receiver to sender clock and hold packets for the latency.",
+        nick = "slave"
+    )]
+    Slave,
+    #[enum_value(
+        name = "Passthrough: Slave receiver to sender clock and push in-order packets \
+                immediately, only hold packets on gaps and reordering.",
+        nick = "passthrough"
+    )]
+    Passthrough,
+}
+
+impl From<Mode> for jitterbuffer::RTPJitterBufferMode {
+    fn from(mode: Mode) -> Self {
+        match mode {
+            Mode::Slave => jitterbuffer::RTPJitterBufferMode::Slave,
+            Mode::Passthrough => jitterbuffer::RTPJitterBufferMode::Passthrough,
+        }
+    }
+}
+
 glib::wrapper! {
     pub struct JitterBuffer(ObjectSubclass<imp::JitterBuffer>) @extends gst::Element, gst::Object;
 }
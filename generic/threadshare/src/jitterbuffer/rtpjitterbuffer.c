@@ -30,6 +30,54 @@ GST_DEBUG_CATEGORY_STATIC (rtp_jitter_buffer_debug);
 #define MAX_WINDOW	RTP_JITTER_BUFFER_MAX_WINDOW
 #define MAX_TIME	(2 * GST_SECOND)
 
+/* slot of the n-th entry in the window minimum deque */
+#define WINDOW_MIN_SLOT(jbuf,n) (((jbuf)->window_min_head + (n)) % MAX_WINDOW)
+
+/* Size bounds of the seqnum indexed ring. The ring grows when the queued
+ * seqnums don't fit anymore but can't cover more than half of the seqnum
+ * space as seqnums further apart can't be ordered. */
+#define RING_MIN_SIZE	512
+#define RING_MAX_SIZE	32768
+
+/* Number of items allocated upfront and maximum number of unused items kept
+ * around for reuse */
+#define POOL_PREALLOC	32
+#define POOL_MAX_FREE	1024
+
+/* Initial number of entries in the pts heap */
+#define HEAP_MIN_SIZE	64
+
+#define RING_ITEM(jbuf,seqnum) ((jbuf)->ring[(guint16) (seqnum) & (jbuf)->ring_mask])
+
+/* Tuning counters, they compile to nothing unless RTP_JITTER_BUFFER_TUNING is
+ * defined */
+#ifdef RTP_JITTER_BUFFER_TUNING
+#define TUNING_COUNT(jbuf,counter) ((jbuf)->tuning.counter++)
+#define TUNING_HISTOGRAM_ADD(jbuf,histogram,value) \
+    histogram_add ((jbuf)->tuning.histogram, value)
+
+static inline void
+histogram_add (guint64 * histogram, guint value)
+{
+  guint bucket = value == 0 ? 0 : g_bit_storage (value);
+
+  histogram[MIN (bucket, RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS - 1)]++;
+}
+#else
+#define TUNING_COUNT(jbuf,counter) G_STMT_START { } G_STMT_END
+#define TUNING_HISTOGRAM_ADD(jbuf,histogram,value) G_STMT_START { } G_STMT_END
+#endif
+
+/* Entry of the pts heap. The pts is kept next to the item to not have to
+ * dereference it when comparing, the stamp makes the most recently inserted
+ * item win among the ones with the same pts. */
+struct _RTPJitterBufferHeapEntry
+{
+  GstClockTime pts;
+  guint stamp;
+  RTPJitterBufferItem *item;
+};
+
 /* signals and args */
 enum
 {
@@ -44,6 +92,8 @@ enum
 /* GObject vmethods */
 static void rtp_jitter_buffer_finalize (GObject * object);
 
+static void level_reset (RTPJitterBuffer * jbuf);
+
 GType
 rtp_jitter_buffer_mode_get_type (void)
 {
@@ -55,6 +105,9 @@ rtp_jitter_buffer_mode_get_type (void)
         "buffer"},
     {RTP_JITTER_BUFFER_MODE_SYNCED, "Synchronized sender and receiver clocks",
         "synced"},
+    {RTP_JITTER_BUFFER_MODE_PASSTHROUGH,
+        "Slave receiver to sender clock, only hold back out of order packets",
+        "passthrough"},
     {0, NULL, NULL},
   };
 
@@ -85,10 +138,30 @@ rtp_jitter_buffer_class_init (RTPJitterBufferClass * klass)
 static void
 rtp_jitter_buffer_init (RTPJitterBuffer * jbuf)
 {
+  guint i;
+
   g_mutex_init (&jbuf->clock_lock);
+  g_mutex_init (&jbuf->pool_lock);
+
+  for (i = 0; i < POOL_PREALLOC; i++) {
+    RTPJitterBufferItem *item = g_slice_new0 (RTPJitterBufferItem);
+
+    item->next = (GList *) jbuf->pool;
+    jbuf->pool = item;
+  }
+  jbuf->pool_free = POOL_PREALLOC;
 
   jbuf->packets = g_queue_new ();
+  jbuf->ring = g_new0 (RTPJitterBufferItem *, RING_MIN_SIZE);
+  jbuf->ring_mask = RING_MIN_SIZE - 1;
+  jbuf->heap = g_new (RTPJitterBufferHeapEntry, HEAP_MIN_SIZE);
+  jbuf->heap_size = HEAP_MIN_SIZE;
   jbuf->mode = RTP_JITTER_BUFFER_MODE_SLAVE;
+  jbuf->window_max_size = MAX_WINDOW;
+  jbuf->window_max_time = MAX_TIME;
+  gst_rtp_time_scale_init (&jbuf->time_scale, jbuf->clock_rate);
+
+  level_reset (jbuf);
 
   rtp_jitter_buffer_reset_skew (jbuf);
 }
@@ -113,6 +186,11 @@ rtp_jitter_buffer_finalize (GObject * object)
   if (jbuf->pipeline_clock)
     gst_object_unref (jbuf->pipeline_clock);
 
+  if (jbuf->snapshot_media_clock)
+    gst_object_unref (jbuf->snapshot_media_clock);
+  if (jbuf->snapshot_pipeline_clock)
+    gst_object_unref (jbuf->snapshot_pipeline_clock);
+
   /* Free any remaining items manually here. We can't let g_queue_free() take
    * care of this because the items are not actually GList but
    * RTPJitterBufferItem, and g_slice_free() explodes if the allocation is not
@@ -124,8 +202,16 @@ rtp_jitter_buffer_finalize (GObject * object)
     g_slice_free (RTPJitterBufferItem, item);
   }
   g_queue_free (jbuf->packets);
+  g_free (jbuf->ring);
+  g_free (jbuf->heap);
+
+  while ((item = jbuf->pool)) {
+    jbuf->pool = (RTPJitterBufferItem *) item->next;
+    g_slice_free (RTPJitterBufferItem, item);
+  }
 
   g_mutex_clear (&jbuf->clock_lock);
+  g_mutex_clear (&jbuf->pool_lock);
 
   G_OBJECT_CLASS (rtp_jitter_buffer_parent_class)->finalize (object);
 }
@@ -209,6 +295,35 @@ rtp_jitter_buffer_set_clock_rate (RTPJitterBuffer * jbuf, guint32 clock_rate)
     GST_DEBUG ("Clock rate changed from %" G_GUINT32_FORMAT " to %"
         G_GUINT32_FORMAT, jbuf->clock_rate, clock_rate);
     jbuf->clock_rate = clock_rate;
+    gst_rtp_time_scale_init (&jbuf->time_scale, clock_rate);
+    rtp_jitter_buffer_reset_skew (jbuf);
+  }
+}
+
+/**
+ * rtp_jitter_buffer_set_skew_window:
+ * @jbuf: an #RTPJitterBuffer
+ * @size: the maximum number of data points in the skew window, at most
+ *   %RTP_JITTER_BUFFER_MAX_WINDOW
+ * @time: the maximum duration of the skew window
+ *
+ * Configure the window used to estimate the clock skew. The window is filled
+ * until it covers @time of sender time or @size data points, whichever comes
+ * first. A shorter window follows the skew faster at the cost of accuracy.
+ * Changing the window resets the skew calculations.
+ */
+void
+rtp_jitter_buffer_set_skew_window (RTPJitterBuffer * jbuf, guint size,
+    GstClockTime time)
+{
+  g_return_if_fail (size > 0 && size <= MAX_WINDOW);
+  g_return_if_fail (time > 0 && GST_CLOCK_TIME_IS_VALID (time));
+
+  if (jbuf->window_max_size != size || jbuf->window_max_time != time) {
+    GST_DEBUG ("skew window changed to %u points, %" GST_TIME_FORMAT, size,
+        GST_TIME_ARGS (time));
+    jbuf->window_max_size = size;
+    jbuf->window_max_time = time;
     rtp_jitter_buffer_reset_skew (jbuf);
   }
 }
@@ -283,6 +398,7 @@ rtp_jitter_buffer_set_media_clock (RTPJitterBuffer * jbuf, GstClock * clock,
 
     gst_clock_set_master (jbuf->media_clock, jbuf->pipeline_clock);
   }
+  g_atomic_int_inc (&jbuf->clock_generation);
   g_mutex_unlock (&jbuf->clock_lock);
 }
 
@@ -315,6 +431,7 @@ rtp_jitter_buffer_set_pipeline_clock (RTPJitterBuffer * jbuf, GstClock * clock)
 
     gst_clock_set_master (jbuf->media_clock, jbuf->pipeline_clock);
   }
+  g_atomic_int_inc (&jbuf->clock_generation);
   g_mutex_unlock (&jbuf->clock_lock);
 }
 
@@ -328,7 +445,42 @@ void
 rtp_jitter_buffer_set_rfc7273_sync (RTPJitterBuffer * jbuf,
     gboolean rfc7273_sync)
 {
+  g_mutex_lock (&jbuf->clock_lock);
   jbuf->rfc7273_sync = rfc7273_sync;
+  g_atomic_int_inc (&jbuf->clock_generation);
+  g_mutex_unlock (&jbuf->clock_lock);
+}
+
+/* Update the clock snapshot used by rtp_jitter_buffer_calculate_pts() if the
+ * clocks changed since it was taken. The clocks are only set up once in
+ * practice, so this is a single atomic read for almost every packet instead of
+ * taking clock_lock and a reference on each clock. */
+static void
+update_clock_snapshot (RTPJitterBuffer * jbuf)
+{
+  GstClock *media_clock, *pipeline_clock;
+
+  if (G_LIKELY (g_atomic_int_get (&jbuf->clock_generation) ==
+          jbuf->snapshot_generation))
+    return;
+
+  media_clock = jbuf->snapshot_media_clock;
+  pipeline_clock = jbuf->snapshot_pipeline_clock;
+
+  g_mutex_lock (&jbuf->clock_lock);
+  jbuf->snapshot_media_clock =
+      jbuf->media_clock ? gst_object_ref (jbuf->media_clock) : NULL;
+  jbuf->snapshot_pipeline_clock =
+      jbuf->pipeline_clock ? gst_object_ref (jbuf->pipeline_clock) : NULL;
+  jbuf->snapshot_media_clock_offset = jbuf->media_clock_offset;
+  jbuf->snapshot_rfc7273_sync = jbuf->rfc7273_sync;
+  jbuf->snapshot_generation = jbuf->clock_generation;
+  g_mutex_unlock (&jbuf->clock_lock);
+
+  if (media_clock)
+    gst_object_unref (media_clock);
+  if (pipeline_clock)
+    gst_object_unref (pipeline_clock);
 }
 
 /**
@@ -349,14 +501,159 @@ rtp_jitter_buffer_reset_skew (RTPJitterBuffer * jbuf)
   jbuf->window_pos = 0;
   jbuf->window_filling = TRUE;
   jbuf->window_min = 0;
+  jbuf->window_min_head = 0;
+  jbuf->window_min_len = 0;
   jbuf->skew = 0;
   jbuf->prev_send_diff = -1;
   jbuf->prev_out_time = -1;
   jbuf->need_resync = TRUE;
+  jbuf->have_transit = FALSE;
+
+  TUNING_COUNT (jbuf, num_skew_resets);
 
   GST_DEBUG ("reset skew correction");
 }
 
+/**
+ * rtp_jitter_buffer_get_skew:
+ * @jbuf: an #RTPJitterBuffer
+ *
+ * Get the current estimate of the skew between the sender and the receiver
+ * clocks, 0 when no skew is calculated in the current mode.
+ *
+ * Returns: the skew in nanoseconds.
+ */
+gint64
+rtp_jitter_buffer_get_skew (RTPJitterBuffer * jbuf)
+{
+  g_return_val_if_fail (jbuf != NULL, 0);
+
+  return jbuf->skew;
+}
+
+/**
+ * rtp_jitter_buffer_get_jitter:
+ * @jbuf: an #RTPJitterBuffer
+ *
+ * Get the interarrival jitter of the packets as defined in RFC 3550 section
+ * 6.4.1, computed from their arrival times and RTP timestamps.
+ *
+ * Returns: the jitter.
+ */
+GstClockTime
+rtp_jitter_buffer_get_jitter (RTPJitterBuffer * jbuf)
+{
+  g_return_val_if_fail (jbuf != NULL, 0);
+
+  return jbuf->jitter >> 4;
+}
+
+/* Update the interarrival jitter with a packet received at @dts, like
+ * update_receiver_stats() of rtpsource.c but in nanoseconds instead of RTP
+ * units so that it is not truncated for low clock rates */
+static void
+update_jitter (RTPJitterBuffer * jbuf, GstClockTime dts,
+    GstClockTime gstrtptime)
+{
+  gint64 transit, diff;
+
+  transit = (gint64) dts - (gint64) gstrtptime;
+
+  if (G_LIKELY (jbuf->have_transit)) {
+    diff = ABS (transit - jbuf->transit);
+    /* a jump of the RTP timestamps, like the ones that make calculate_skew()
+     * resync, is not jitter: only take the new transit time as reference */
+    if (G_LIKELY (diff <= GST_SECOND))
+      jbuf->jitter += diff - ((jbuf->jitter + 8) >> 4);
+  } else {
+    jbuf->have_transit = TRUE;
+  }
+  jbuf->transit = transit;
+}
+
+/**
+ * rtp_jitter_buffer_alloc_item:
+ * @jbuf: an #RTPJitterBuffer
+ *
+ * Get a zeroed item from the item pool of @jbuf, the global allocator is only
+ * used when the pool is empty. Unlike the other functions operating on @jbuf,
+ * this can be called from any thread as the pool has its own lock.
+ *
+ * Returns: a new #RTPJitterBufferItem. Use rtp_jitter_buffer_free_item()
+ * after usage.
+ */
+RTPJitterBufferItem *
+rtp_jitter_buffer_alloc_item (RTPJitterBuffer * jbuf)
+{
+  RTPJitterBufferItem *item;
+
+  g_mutex_lock (&jbuf->pool_lock);
+  item = jbuf->pool;
+  if (G_LIKELY (item)) {
+    jbuf->pool = (RTPJitterBufferItem *) item->next;
+    jbuf->pool_free--;
+  }
+
+  jbuf->pool_used++;
+  if (G_UNLIKELY (jbuf->pool_used > jbuf->pool_high_water))
+    jbuf->pool_high_water = jbuf->pool_used;
+  g_mutex_unlock (&jbuf->pool_lock);
+
+  if (G_LIKELY (item))
+    memset (item, 0, sizeof (RTPJitterBufferItem));
+  else
+    item = g_slice_new0 (RTPJitterBufferItem);
+
+  return item;
+}
+
+/**
+ * rtp_jitter_buffer_free_item:
+ * @jbuf: an #RTPJitterBuffer
+ * @item: an #RTPJitterBufferItem obtained with rtp_jitter_buffer_alloc_item()
+ *
+ * Give @item back to the item pool of @jbuf. The data of @item is not
+ * touched and must have been released by the caller. Like
+ * rtp_jitter_buffer_alloc_item(), this can be called from any thread.
+ */
+void
+rtp_jitter_buffer_free_item (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  g_mutex_lock (&jbuf->pool_lock);
+  jbuf->pool_used--;
+
+  if (G_UNLIKELY (jbuf->pool_free >= POOL_MAX_FREE)) {
+    g_mutex_unlock (&jbuf->pool_lock);
+    g_slice_free (RTPJitterBufferItem, item);
+    return;
+  }
+
+  item->next = (GList *) jbuf->pool;
+  jbuf->pool = item;
+  jbuf->pool_free++;
+  g_mutex_unlock (&jbuf->pool_lock);
+}
+
+/**
+ * rtp_jitter_buffer_get_pool_stats:
+ * @jbuf: an #RTPJitterBuffer
+ * @n_free: result number of unused items in the pool
+ * @high_water: result maximum number of items that were in use at once
+ *
+ * Get the item pool statistics of @jbuf.
+ */
+void
+rtp_jitter_buffer_get_pool_stats (RTPJitterBuffer * jbuf, guint * n_free,
+    guint * high_water)
+{
+  g_mutex_lock (&jbuf->pool_lock);
+  if (n_free)
+    *n_free = jbuf->pool_free;
+  if (high_water)
+    *high_water = jbuf->pool_high_water;
+  g_mutex_unlock (&jbuf->pool_lock);
+}
+
 /**
  * rtp_jitter_buffer_disable_buffering:
  * @jbuf: an #RTPJitterBuffer
@@ -384,57 +681,226 @@ rtp_jitter_buffer_resync (RTPJitterBuffer * jbuf, GstClockTime time,
     jbuf->window_filling = TRUE;
     jbuf->window_pos = 0;
     jbuf->window_min = 0;
+    jbuf->window_min_head = 0;
+    jbuf->window_min_len = 0;
     jbuf->window_size = 0;
     jbuf->skew = 0;
   }
   jbuf->need_resync = FALSE;
-}
 
-static guint64
-get_buffer_level (RTPJitterBuffer * jbuf)
-{
-  RTPJitterBufferItem *high_buf = NULL, *low_buf = NULL;
-  guint64 level;
-
-  /* first buffer with timestamp */
-  high_buf = (RTPJitterBufferItem *) g_queue_peek_tail_link (jbuf->packets);
-  while (high_buf) {
-    if (high_buf->dts != GST_CLOCK_TIME_NONE
-        || high_buf->pts != GST_CLOCK_TIME_NONE)
-      break;
-
-    high_buf = (RTPJitterBufferItem *) g_list_previous (high_buf);
-  }
+  TUNING_COUNT (jbuf, num_resyncs);
+}
 
-  low_buf = (RTPJitterBufferItem *) g_queue_peek_head_link (jbuf->packets);
-  while (low_buf) {
-    if (low_buf->dts != GST_CLOCK_TIME_NONE
-        || low_buf->pts != GST_CLOCK_TIME_NONE)
-      break;
+#define ITEM_HAS_TS(item) ((item)->dts != GST_CLOCK_TIME_NONE \
+    || (item)->pts != GST_CLOCK_TIME_NONE)
+#define ITEM_TS(item) ((item)->dts != GST_CLOCK_TIME_NONE ? (item)->dts : (item)->pts)
 
-    low_buf = (RTPJitterBufferItem *) g_list_next (low_buf);
-  }
+static void
+level_calculate (RTPJitterBuffer * jbuf)
+{
+  RTPJitterBufferItem *high_buf = jbuf->level_high, *low_buf = jbuf->level_low;
 
   if (!high_buf || !low_buf || high_buf == low_buf) {
-    level = 0;
+    jbuf->level = 0;
   } else {
     guint64 high_ts, low_ts;
 
-    high_ts =
-        high_buf->dts != GST_CLOCK_TIME_NONE ? high_buf->dts : high_buf->pts;
-    low_ts = low_buf->dts != GST_CLOCK_TIME_NONE ? low_buf->dts : low_buf->pts;
+    high_ts = ITEM_TS (high_buf);
+    low_ts = ITEM_TS (low_buf);
 
     if (high_ts > low_ts)
-      level = high_ts - low_ts;
+      jbuf->level = high_ts - low_ts;
     else
-      level = 0;
+      jbuf->level = 0;
 
     GST_LOG_OBJECT (jbuf,
         "low %" GST_TIME_FORMAT " high %" GST_TIME_FORMAT " level %"
         G_GUINT64_FORMAT, GST_TIME_ARGS (low_ts), GST_TIME_ARGS (high_ts),
-        level);
+        jbuf->level);
   }
-  return level;
+}
+
+static void
+level_reset (RTPJitterBuffer * jbuf)
+{
+  jbuf->level_low = NULL;
+  jbuf->level_high = NULL;
+  jbuf->level_low_seqnum = G_MAXUINT;
+  jbuf->level_high_seqnum = G_MAXUINT;
+  jbuf->level = 0;
+}
+
+/* Track the first and last item with a timestamp after @item was inserted.
+ *
+ * Packets are sorted by seqnum and events are appended, so a packet ends up
+ * after every item that follows the packets with a lower seqnum. A new packet
+ * is thus in front of an item when its seqnum is lower than the one of the
+ * nearest packet at or before that item. */
+static void
+level_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  guint seqnum;
+
+  if (!ITEM_HAS_TS (item))
+    return;
+
+  if (item->seqnum != G_MAXUINT)
+    seqnum = item->seqnum;
+  else if (jbuf->ring_packets > 0)
+    seqnum = (guint16) (jbuf->ring_base + jbuf->ring_span - 1);
+  else
+    seqnum = G_MAXUINT;
+
+  if (jbuf->level_low == NULL) {
+    jbuf->level_low = jbuf->level_high = item;
+    jbuf->level_low_seqnum = jbuf->level_high_seqnum = seqnum;
+  } else {
+    if (item->seqnum != G_MAXUINT && jbuf->level_low_seqnum != G_MAXUINT
+        && gst_rtp_buffer_compare_seqnum (jbuf->level_low_seqnum,
+            item->seqnum) < 0) {
+      jbuf->level_low = item;
+      jbuf->level_low_seqnum = seqnum;
+    }
+    if (item->seqnum == G_MAXUINT || jbuf->level_high_seqnum == G_MAXUINT
+        || gst_rtp_buffer_compare_seqnum (jbuf->level_high_seqnum,
+            item->seqnum) > 0) {
+      jbuf->level_high = item;
+      jbuf->level_high_seqnum = seqnum;
+    }
+  }
+
+  level_calculate (jbuf);
+}
+
+/* Track the first and last item with a timestamp after the head @item was
+ * popped, @next is the link that followed it. Only the items in front of the
+ * next timestamped item are skipped, and those are popped next. */
+static void
+level_remove_head (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
+    GList * next)
+{
+  if (item->seqnum != G_MAXUINT) {
+    if (jbuf->level_low_seqnum == item->seqnum)
+      jbuf->level_low_seqnum = G_MAXUINT;
+    if (jbuf->level_high_seqnum == item->seqnum)
+      jbuf->level_high_seqnum = G_MAXUINT;
+  }
+
+  if (item != jbuf->level_low)
+    return;
+
+  if (item == jbuf->level_high) {
+    level_reset (jbuf);
+    return;
+  }
+
+  for (; next; next = next->next) {
+    RTPJitterBufferItem *qitem = (RTPJitterBufferItem *) next;
+
+    if (qitem->seqnum != G_MAXUINT)
+      jbuf->level_low_seqnum = qitem->seqnum;
+
+    if (ITEM_HAS_TS (qitem))
+      break;
+  }
+  jbuf->level_low = (RTPJitterBufferItem *) next;
+
+  level_calculate (jbuf);
+}
+
+static inline gboolean
+heap_before (const RTPJitterBufferHeapEntry * a,
+    const RTPJitterBufferHeapEntry * b)
+{
+  if (a->pts != b->pts)
+    return a->pts < b->pts;
+
+  return (gint) (a->stamp - b->stamp) > 0;
+}
+
+static inline void
+heap_set (RTPJitterBuffer * jbuf, guint idx,
+    const RTPJitterBufferHeapEntry * entry)
+{
+  jbuf->heap[idx] = *entry;
+  entry->item->heap_index = idx;
+}
+
+static void
+heap_sift_up (RTPJitterBuffer * jbuf, guint idx)
+{
+  RTPJitterBufferHeapEntry entry = jbuf->heap[idx];
+
+  while (idx > 0) {
+    guint parent = (idx - 1) / 2;
+
+    if (!heap_before (&entry, &jbuf->heap[parent]))
+      break;
+    heap_set (jbuf, idx, &jbuf->heap[parent]);
+    idx = parent;
+  }
+  heap_set (jbuf, idx, &entry);
+}
+
+static void
+heap_sift_down (RTPJitterBuffer * jbuf, guint idx)
+{
+  RTPJitterBufferHeapEntry entry = jbuf->heap[idx];
+
+  for (;;) {
+    guint child = 2 * idx + 1;
+
+    if (child >= jbuf->heap_len)
+      break;
+    if (child + 1 < jbuf->heap_len
+        && heap_before (&jbuf->heap[child + 1], &jbuf->heap[child]))
+      child++;
+    if (!heap_before (&jbuf->heap[child], &entry))
+      break;
+    heap_set (jbuf, idx, &jbuf->heap[child]);
+    idx = child;
+  }
+  heap_set (jbuf, idx, &entry);
+}
+
+static void
+heap_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  RTPJitterBufferHeapEntry *entry;
+
+  if (G_UNLIKELY (jbuf->heap_len == jbuf->heap_size)) {
+    jbuf->heap_size *= 2;
+    jbuf->heap =
+        g_renew (RTPJitterBufferHeapEntry, jbuf->heap, jbuf->heap_size);
+  }
+
+  entry = &jbuf->heap[jbuf->heap_len++];
+  entry->pts = item->pts;
+  entry->stamp = jbuf->heap_stamp++;
+  entry->item = item;
+  heap_sift_up (jbuf, jbuf->heap_len - 1);
+}
+
+static void
+heap_remove (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item)
+{
+  guint idx = item->heap_index;
+
+  /* move the last entry into the hole and restore the heap order from there */
+  if (idx == --jbuf->heap_len)
+    return;
+  heap_set (jbuf, idx, &jbuf->heap[jbuf->heap_len]);
+
+  if (idx > 0 && heap_before (&jbuf->heap[idx], &jbuf->heap[(idx - 1) / 2]))
+    heap_sift_up (jbuf, idx);
+  else
+    heap_sift_down (jbuf, idx);
+}
+
+static guint64
+get_buffer_level (RTPJitterBuffer * jbuf)
+{
+  return jbuf->level;
 }
 
 static void
@@ -535,22 +1001,49 @@ update_buffer_level (RTPJitterBuffer * jbuf, gint * percent)
  * of the drift estimation. Finding the correct parameters turns out to be a
  * compromise between accuracy and inertia.
  *
- * We use a 2 second window or up to 512 data points, which is statistically big
- * enough to catch spikes (FIXME, detect spikes).
+ * By default we use a 2 second window or up to 512 data points, which is
+ * statistically big enough to catch spikes (FIXME, detect spikes). Both limits
+ * can be lowered with rtp_jitter_buffer_set_skew_window().
  * We also use a rather large weighting factor (125) to smoothly adapt. During
  * startup, when filling the window, we use a parabolic weighting factor, the
  * more the window is filled, the faster we move to the detected possible skew.
  *
+ * The minimum of the window is maintained with a monotonic deque: it holds the
+ * positions of the samples that can still become the minimum, every one of
+ * them newer and bigger than the one before, so that the front is the minimum.
+ * A new sample removes all bigger ones from the back, the front is dropped when
+ * the sample it refers to leaves the window. This makes every update amortized
+ * O(1) instead of rescanning the window when the minimum expires.
+ *
  * Returns: @time adjusted with the clock skew.
  */
+static void
+window_push (RTPJitterBuffer * jbuf, guint pos, gint64 delta)
+{
+  /* samples bigger than or equal to the new one can't become the minimum
+   * anymore as they leave the window before it */
+  while (jbuf->window_min_len > 0) {
+    guint back = jbuf->window_min_pos[WINDOW_MIN_SLOT (jbuf,
+            jbuf->window_min_len - 1)];
+
+    if (jbuf->window[back] < delta)
+      break;
+    jbuf->window_min_len--;
+  }
+  jbuf->window[pos] = delta;
+  jbuf->window_min_pos[WINDOW_MIN_SLOT (jbuf, jbuf->window_min_len)] = pos;
+  jbuf->window_min_len++;
+
+  jbuf->window_min = jbuf->window[jbuf->window_min_pos[jbuf->window_min_head]];
+}
+
 static GstClockTime
 calculate_skew (RTPJitterBuffer * jbuf, guint64 ext_rtptime,
     GstClockTime gstrtptime, GstClockTime time, gint gap, gboolean is_rtx)
 {
   guint64 send_diff, recv_diff;
   gint64 delta;
-  gint64 old;
-  guint pos, i;
+  guint pos;
   GstClockTime out_time;
   guint64 slope;
 
@@ -603,12 +1096,11 @@ calculate_skew (RTPJitterBuffer * jbuf, guint64 ext_rtptime,
   if (G_UNLIKELY (jbuf->window_filling)) {
     /* we are filling the window */
     GST_DEBUG ("filling %d, delta %" G_GINT64_FORMAT, pos, delta);
-    jbuf->window[pos++] = delta;
     /* calc the min delta we observed */
-    if (G_UNLIKELY (pos == 1 || delta < jbuf->window_min))
-      jbuf->window_min = delta;
+    window_push (jbuf, pos++, delta);
 
-    if (G_UNLIKELY (send_diff >= MAX_TIME || pos >= MAX_WINDOW)) {
+    if (G_UNLIKELY (send_diff >= jbuf->window_max_time
+            || pos >= jbuf->window_max_size)) {
       jbuf->window_size = pos;
 
       /* window filled */
@@ -622,8 +1114,8 @@ calculate_skew (RTPJitterBuffer * jbuf, guint64 ext_rtptime,
 
       /* figure out how much we filled the window, this depends on the amount of
        * time we have or the max number of points we keep. */
-      perc_time = send_diff * 100 / MAX_TIME;
-      perc_window = pos * 100 / MAX_WINDOW;
+      perc_time = send_diff * 100 / jbuf->window_max_time;
+      perc_window = pos * 100 / jbuf->window_max_size;
       perc = MAX (perc_time, perc_window);
 
       /* make a parabolic function, the closer we get to the MAX, the more value
@@ -637,30 +1129,14 @@ calculate_skew (RTPJitterBuffer * jbuf, guint64 ext_rtptime,
       jbuf->window_size = pos + 1;
     }
   } else {
-    /* pick old value and store new value. We keep the previous value in order
-     * to quickly check if the min of the window changed */
-    old = jbuf->window[pos];
-    jbuf->window[pos++] = delta;
-
-    if (G_UNLIKELY (delta <= jbuf->window_min)) {
-      /* if the new value we inserted is smaller or equal to the current min,
-       * it becomes the new min */
-      jbuf->window_min = delta;
-    } else if (G_UNLIKELY (old == jbuf->window_min)) {
-      gint64 min = G_MAXINT64;
-
-      /* if we removed the old min, we have to find a new min */
-      for (i = 0; i < jbuf->window_size; i++) {
-        /* we found another value equal to the old min, we can stop searching now */
-        if (jbuf->window[i] == old) {
-          min = old;
-          break;
-        }
-        if (jbuf->window[i] < min)
-          min = jbuf->window[i];
-      }
-      jbuf->window_min = min;
+    /* the new value replaces the oldest one, if that was the min it leaves
+     * the deque */
+    if (jbuf->window_min_pos[jbuf->window_min_head] == pos) {
+      jbuf->window_min_head = WINDOW_MIN_SLOT (jbuf, 1);
+      jbuf->window_min_len--;
     }
+    window_push (jbuf, pos++, delta);
+
     /* average the min values */
     jbuf->skew = (jbuf->window_min + (124 * jbuf->skew)) / 125;
     GST_DEBUG ("delta %" G_GINT64_FORMAT ", new min: %" G_GINT64_FORMAT,
@@ -691,6 +1167,115 @@ no_skew:
   return out_time;
 }
 
+/* Make sure the ring can index @span seqnums from ring_base, moving the
+ * queued packets to a bigger ring if needed. */
+static gboolean
+ring_reserve (RTPJitterBuffer * jbuf, guint span)
+{
+  RTPJitterBufferItem **ring;
+  guint size, i;
+
+  size = jbuf->ring_mask + 1;
+  if (G_LIKELY (span <= size))
+    return TRUE;
+
+  if (span > RING_MAX_SIZE)
+    return FALSE;
+
+  while (size < span)
+    size <<= 1;
+
+  GST_DEBUG ("growing ring to %u for span %u", size, span);
+
+  ring = g_new0 (RTPJitterBufferItem *, size);
+  for (i = 0; i < jbuf->ring_span; i++) {
+    guint16 seqnum = jbuf->ring_base + i;
+
+    ring[seqnum & (size - 1)] = RING_ITEM (jbuf, seqnum);
+  }
+  g_free (jbuf->ring);
+  jbuf->ring = ring;
+  jbuf->ring_mask = size - 1;
+
+  return TRUE;
+}
+
+/* Find the link to insert a packet after when its seqnum is strictly between
+ * the first and the last queued packet. The packet goes right after its
+ * predecessor and the events that follow it, which is right before its
+ * successor. Both are looked for at the same time as late packets usually
+ * fill small holes. */
+static GList *
+ring_find_prev (RTPJitterBuffer * jbuf, guint offset)
+{
+  guint16 seqnum = jbuf->ring_base + offset;
+  RTPJitterBufferItem *item;
+  GList *list;
+  guint i;
+
+  for (i = 1;; i++) {
+    if (offset + i < jbuf->ring_span && (item = RING_ITEM (jbuf, seqnum + i))) {
+      TUNING_HISTOGRAM_ADD (jbuf, insert_walk, i);
+      return ((GList *) item)->prev;
+    }
+
+    if (i <= offset && (item = RING_ITEM (jbuf, seqnum - i)))
+      break;
+  }
+
+  list = (GList *) item;
+  while (((RTPJitterBufferItem *) list->next)->seqnum == G_MAXUINT) {
+    list = list->next;
+    i++;
+  }
+  TUNING_HISTOGRAM_ADD (jbuf, insert_walk, i);
+
+  return list;
+}
+
+/* Extend the run of queued seqnums from ring_base. A slot is only looked at
+ * again once the run got shorter than it, which only happens by popping, so
+ * this is constant time per packet overall. */
+static void
+ring_extend_contiguous (RTPJitterBuffer * jbuf)
+{
+  while (jbuf->ring_contiguous < jbuf->ring_span
+      && RING_ITEM (jbuf, jbuf->ring_base + jbuf->ring_contiguous))
+    jbuf->ring_contiguous++;
+}
+
+/* Unindex the first packet after it was removed from the queue, @next is the
+ * link that followed it. */
+static void
+ring_remove_first (RTPJitterBuffer * jbuf, GList * next)
+{
+  guint16 seqnum;
+
+  RING_ITEM (jbuf, jbuf->ring_base) = NULL;
+
+  if (--jbuf->ring_packets == 0) {
+    jbuf->ring_span = 0;
+    jbuf->ring_contiguous = 0;
+    return;
+  }
+
+  /* the next packet in the queue is the new first one */
+  while (((RTPJitterBufferItem *) next)->seqnum == G_MAXUINT)
+    next = next->next;
+
+  seqnum = ((RTPJitterBufferItem *) next)->seqnum;
+  jbuf->ring_span -= gst_rtp_buffer_compare_seqnum (jbuf->ring_base, seqnum);
+  jbuf->ring_base = seqnum;
+
+  /* the run went on with the next seqnum or a new one starts after the gap */
+  if (jbuf->ring_contiguous > 1) {
+    jbuf->ring_contiguous--;
+  } else {
+    jbuf->ring_contiguous = 0;
+    ring_extend_contiguous (jbuf);
+  }
+}
+
 static void
 queue_do_insert (RTPJitterBuffer * jbuf, GList * list, GList * item)
 {
@@ -722,7 +1307,13 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
   GstClockTime gstrtptime, pts;
   GstClock *media_clock, *pipeline_clock;
   guint64 media_clock_offset;
-  gboolean rfc7273_mode;
+  gboolean rfc7273_sync, rfc7273_mode;
+  RTPJitterBufferMode mode;
+
+  /* passthrough only changes how long packets are held, the timestamps are
+   * calculated like in slave mode */
+  mode = jbuf->mode == RTP_JITTER_BUFFER_MODE_PASSTHROUGH ?
+      RTP_JITTER_BUFFER_MODE_SLAVE : jbuf->mode;
 
   /* rtp time jumps are checked for during skew calculation, but bypassed
    * in other mode, so mind those here and reset jb if needed.
@@ -730,7 +1321,7 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
    * where we expect this might happen due to async thread effects
    * (in seek and state change cycles), but not so much for TCP input */
   if (GST_CLOCK_TIME_IS_VALID (dts) && !estimated_dts &&
-      jbuf->mode != RTP_JITTER_BUFFER_MODE_SLAVE &&
+      mode != RTP_JITTER_BUFFER_MODE_SLAVE &&
       jbuf->base_time != GST_CLOCK_TIME_NONE
       && jbuf->last_rtptime != GST_CLOCK_TIME_NONE) {
     GstClockTime ext_rtptime = jbuf->ext_rtptime;
@@ -745,8 +1336,6 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
         rtp_jitter_buffer_reset_skew (jbuf);
       } else {
         GST_WARNING ("rtp delta too big: ignore rtx packet");
-        media_clock = NULL;
-        pipeline_clock = NULL;
         pts = GST_CLOCK_TIME_NONE;
         goto done;
       }
@@ -763,15 +1352,18 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
   /* keep track of the last extended rtptime */
   jbuf->last_rtptime = ext_rtptime;
 
-  g_mutex_lock (&jbuf->clock_lock);
-  media_clock = jbuf->media_clock ? gst_object_ref (jbuf->media_clock) : NULL;
-  pipeline_clock =
-      jbuf->pipeline_clock ? gst_object_ref (jbuf->pipeline_clock) : NULL;
-  media_clock_offset = jbuf->media_clock_offset;
-  g_mutex_unlock (&jbuf->clock_lock);
+  update_clock_snapshot (jbuf);
+  media_clock = jbuf->snapshot_media_clock;
+  pipeline_clock = jbuf->snapshot_pipeline_clock;
+  media_clock_offset = jbuf->snapshot_media_clock_offset;
+  rfc7273_sync = jbuf->snapshot_rfc7273_sync;
+
+  gstrtptime = gst_rtp_time_scale_to_time (&jbuf->time_scale, ext_rtptime);
 
-  gstrtptime =
-      gst_util_uint64_scale_int (ext_rtptime, GST_SECOND, jbuf->clock_rate);
+  /* retransmissions and estimated arrival times carry no information about
+   * the network jitter */
+  if (GST_CLOCK_TIME_IS_VALID (dts) && !estimated_dts && !is_rtx)
+    update_jitter (jbuf, dts, gstrtptime);
 
   if (G_LIKELY (jbuf->base_rtptime != GST_CLOCK_TIME_NONE)) {
     /* check elapsed time in RTP units */
@@ -790,7 +1382,7 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
     }
   }
 
-  switch (jbuf->mode) {
+  switch (mode) {
     case RTP_JITTER_BUFFER_MODE_NONE:
     case RTP_JITTER_BUFFER_MODE_BUFFER:
       /* send 0 as the first timestamp and -1 for the other ones. This will
@@ -834,8 +1426,8 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
   rfc7273_mode = media_clock && pipeline_clock
       && gst_clock_is_synced (media_clock);
 
-  if (rfc7273_mode && jbuf->mode == RTP_JITTER_BUFFER_MODE_SLAVE
-      && (media_clock_offset == GST_CLOCK_TIME_NONE || !jbuf->rfc7273_sync)) {
+  if (rfc7273_mode && mode == RTP_JITTER_BUFFER_MODE_SLAVE
+      && (media_clock_offset == GST_CLOCK_TIME_NONE || !rfc7273_sync)) {
     GstClockTime internal, external;
     GstClockTime rate_num, rate_denom;
     GstClockTime nsrtptimediff, rtpntptime, rtpsystime;
@@ -882,9 +1474,9 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
 
     GST_DEBUG ("RFC7273 clock time %" GST_TIME_FORMAT ", out %" GST_TIME_FORMAT,
         GST_TIME_ARGS (rtpsystime), GST_TIME_ARGS (pts));
-  } else if (rfc7273_mode && (jbuf->mode == RTP_JITTER_BUFFER_MODE_SLAVE
-          || jbuf->mode == RTP_JITTER_BUFFER_MODE_SYNCED)
-      && media_clock_offset != GST_CLOCK_TIME_NONE && jbuf->rfc7273_sync) {
+  } else if (rfc7273_mode && (mode == RTP_JITTER_BUFFER_MODE_SLAVE
+          || mode == RTP_JITTER_BUFFER_MODE_SYNCED)
+      && media_clock_offset != GST_CLOCK_TIME_NONE && rfc7273_sync) {
     GstClockTime ntptime, rtptime_tmp;
     GstClockTime ntprtptime, rtpsystime;
     GstClockTime internal, external;
@@ -902,7 +1494,7 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
 
     ntptime = gst_clock_get_internal_time (media_clock);
 
-    ntprtptime = gst_util_uint64_scale (ntptime, jbuf->clock_rate, GST_SECOND);
+    ntprtptime = gst_rtp_time_scale_to_rtp (&jbuf->time_scale, ntptime);
     ntprtptime += media_clock_offset;
     ntprtptime &= 0xffffffff;
 
@@ -982,11 +1574,6 @@ rtp_jitter_buffer_calculate_pts (RTPJitterBuffer * jbuf, GstClockTime dts,
   jbuf->prev_send_diff = gstrtptime - jbuf->base_rtptime;
 
 done:
-  if (media_clock)
-    gst_object_unref (media_clock);
-  if (pipeline_clock)
-    gst_object_unref (pipeline_clock);
-
   return pts;
 }
 
@@ -1006,17 +1593,21 @@ done:
  * will be available with the next call to rtp_jitter_buffer_pop() and
  * rtp_jitter_buffer_peek().
  *
- * Returns: %FALSE if a packet with the same number already existed.
+ * Packets are looked up by seqnum so that neither the position nor a
+ * duplicate needs a walk over the queue. Packets can't be ordered when they
+ * are too far away from the queued packets for the ring, they are refused.
+ *
+ * Returns: #RTP_JITTER_BUFFER_INSERT_DUPLICATE if a packet with the same
+ * number already existed, #RTP_JITTER_BUFFER_INSERT_OUT_OF_RANGE if the
+ * seqnum is too far from the queued packets.
  */
-gboolean
-rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
-    gboolean * head, gint * percent)
+static RTPJitterBufferInsertResult
+queue_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
+    gboolean * head)
 {
-  GList *list, *event = NULL;
+  GList *list;
   guint16 seqnum;
-
-  g_return_val_if_fail (jbuf != NULL, FALSE);
-  g_return_val_if_fail (item != NULL, FALSE);
+  gint offset;
 
   list = jbuf->packets->tail;
 
@@ -1026,59 +1617,66 @@ rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
 
   seqnum = item->seqnum;
 
-  /* loop the list to skip strictly larger seqnum buffers */
-  for (; list; list = g_list_previous (list)) {
-    guint16 qseq;
-    gint gap;
-    RTPJitterBufferItem *qitem = (RTPJitterBufferItem *) list;
-
-    if (qitem->seqnum == G_MAXUINT) {
-      /* keep a pointer to the first consecutive event if not already
-       * set. we will insert the packet after the event if we can't find
-       * a packet with lower sequence number before the event. */
-      if (event == NULL)
-        event = list;
-      continue;
-    }
+  /* the first packet goes after all queued events */
+  if (G_UNLIKELY (jbuf->ring_packets == 0)) {
+    jbuf->ring_base = seqnum;
+    jbuf->ring_span = 1;
+    goto store;
+  }
+
+  offset = gst_rtp_buffer_compare_seqnum (jbuf->ring_base, seqnum);
+
+  if (G_UNLIKELY (offset < 0)) {
+    /* new first packet, it goes after the events at the head of the queue */
+    if (!ring_reserve (jbuf, jbuf->ring_span - offset))
+      goto out_of_range;
+
+    list = ((GList *) RING_ITEM (jbuf, jbuf->ring_base))->prev;
+    jbuf->ring_base = seqnum;
+    jbuf->ring_span -= offset;
+    /* the run only goes on if the packet is right before the old first one */
+    jbuf->ring_contiguous = offset == -1 ? jbuf->ring_contiguous + 1 : 0;
 
-    qseq = qitem->seqnum;
+    TUNING_HISTOGRAM_ADD (jbuf, insert_walk, 0);
+    TUNING_HISTOGRAM_ADD (jbuf, reorder_distance, jbuf->ring_span - 1);
+  } else if (G_LIKELY ((guint) offset >= jbuf->ring_span)) {
+    /* new last packet, it goes after all queued events */
+    if (!ring_reserve (jbuf, offset + 1))
+      goto out_of_range;
 
-    /* compare the new seqnum to the one in the buffer */
-    gap = gst_rtp_buffer_compare_seqnum (seqnum, qseq);
+    jbuf->ring_span = offset + 1;
 
+    TUNING_HISTOGRAM_ADD (jbuf, insert_walk, 0);
+    TUNING_HISTOGRAM_ADD (jbuf, reorder_distance, 0);
+  } else {
     /* we hit a packet with the same seqnum, notify a duplicate */
-    if (G_UNLIKELY (gap == 0))
+    if (G_UNLIKELY (RING_ITEM (jbuf, seqnum) != NULL))
       goto duplicate;
 
-    /* seqnum > qseq, we can stop looking */
-    if (G_LIKELY (gap < 0))
-      break;
+    list = ring_find_prev (jbuf, offset);
 
-    /* if we've found a packet with greater sequence number, cleanup the
-     * event pointer as the packet will be inserted before the event */
-    event = NULL;
+    TUNING_HISTOGRAM_ADD (jbuf, reorder_distance, jbuf->ring_span - 1 - offset);
   }
 
-  /* if event is set it means that packets before the event had smaller
-   * sequence number, so we will insert our packet after the event */
-  if (event)
-    list = event;
+store:
+  RING_ITEM (jbuf, seqnum) = item;
+  jbuf->ring_packets++;
+  ring_extend_contiguous (jbuf);
 
 append:
   queue_do_insert (jbuf, list, (GList *) item);
+  jbuf->packets_bytes += item->size;
+  level_insert (jbuf, item);
+  heap_insert (jbuf, item);
 
-  /* buffering mode, update buffer stats */
-  if (jbuf->mode == RTP_JITTER_BUFFER_MODE_BUFFER)
-    update_buffer_level (jbuf, percent);
-  else if (percent)
-    *percent = -1;
+  TUNING_HISTOGRAM_ADD (jbuf, queue_depth, jbuf->packets->length);
 
   /* head was changed when we did not find a previous packet, we set the return
    * flag when requested. */
   if (G_LIKELY (head))
     *head = (list == NULL);
 
-  return TRUE;
+  return RTP_JITTER_BUFFER_INSERT_OK;
 
   /* ERRORS */
 duplicate:
@@ -1086,28 +1684,95 @@ duplicate:
     GST_DEBUG ("duplicate packet %d found", (gint) seqnum);
     if (G_LIKELY (head))
       *head = FALSE;
-    return FALSE;
+    return RTP_JITTER_BUFFER_INSERT_DUPLICATE;
+  }
+out_of_range:
+  {
+    GST_WARNING ("packet %d too far from queued packet %d", (gint) seqnum,
+        (gint) jbuf->ring_base);
+    if (G_LIKELY (head))
+      *head = FALSE;
+    return RTP_JITTER_BUFFER_INSERT_OUT_OF_RANGE;
   }
 }
 
+gboolean
+rtp_jitter_buffer_insert (RTPJitterBuffer * jbuf, RTPJitterBufferItem * item,
+    gboolean * head, gint * percent)
+{
+  g_return_val_if_fail (jbuf != NULL, FALSE);
+  g_return_val_if_fail (item != NULL, FALSE);
+
+  if (queue_insert (jbuf, item, head) != RTP_JITTER_BUFFER_INSERT_OK)
+    return FALSE;
+
+  /* buffering mode, update buffer stats */
+  if (jbuf->mode == RTP_JITTER_BUFFER_MODE_BUFFER)
+    update_buffer_level (jbuf, percent);
+  else if (percent)
+    *percent = -1;
+
+  return TRUE;
+}
+
 /**
- * rtp_jitter_buffer_pop:
+ * rtp_jitter_buffer_insert_list:
  * @jbuf: an #RTPJitterBuffer
- * @percent: the buffering percent
+ * @items: (array length=n_items): the items to insert
+ * @n_items: the number of items in @items
+ * @results: (out caller-allocates) (array length=n_items) (nullable): set
+ *   for each item to whether it was inserted, or why it was refused
+ * @head: TRUE when the head element changed.
+ * @percent: the buffering percent after insertion
  *
- * Pops the oldest buffer from the packet queue of @jbuf. The popped buffer will
- * have its timestamp adjusted with the incoming running_time and the detected
- * clock skew.
+ * Inserts all @items like rtp_jitter_buffer_insert() in order, but updates
+ * the buffering state only once at the end. Ownership is taken of the
+ * items for which @results is #RTP_JITTER_BUFFER_INSERT_OK, the others
+ * remain owned by the caller.
  *
- * Returns: a #GstBuffer or %NULL when there was no packet in the queue.
+ * Returns: the number of inserted items.
  */
-RTPJitterBufferItem *
-rtp_jitter_buffer_pop (RTPJitterBuffer * jbuf, gint * percent)
+guint
+rtp_jitter_buffer_insert_list (RTPJitterBuffer * jbuf,
+    RTPJitterBufferItem ** items, guint n_items,
+    RTPJitterBufferInsertResult * results, gboolean * head, gint * percent)
 {
-  GList *item = NULL;
-  GQueue *queue;
+  gboolean item_head;
+  guint i, n_inserted = 0;
 
-  g_return_val_if_fail (jbuf != NULL, NULL);
+  g_return_val_if_fail (jbuf != NULL, 0);
+  g_return_val_if_fail (items != NULL || n_items == 0, 0);
+
+  if (head)
+    *head = FALSE;
+
+  for (i = 0; i < n_items; i++) {
+    RTPJitterBufferInsertResult ret =
+        queue_insert (jbuf, items[i], &item_head);
+
+    if (results)
+      results[i] = ret;
+    if (ret == RTP_JITTER_BUFFER_INSERT_OK) {
+      n_inserted++;
+      if (head && item_head)
+        *head = TRUE;
+    }
+  }
+
+  /* buffering mode, update buffer stats */
+  if (jbuf->mode == RTP_JITTER_BUFFER_MODE_BUFFER)
+    update_buffer_level (jbuf, percent);
+  else if (percent)
+    *percent = -1;
+
+  return n_inserted;
+}
+
+static RTPJitterBufferItem *
+queue_pop_head (RTPJitterBuffer * jbuf)
+{
+  GList *item;
+  GQueue *queue;
 
   queue = jbuf->packets;
 
@@ -1119,15 +1784,81 @@ rtp_jitter_buffer_pop (RTPJitterBuffer * jbuf, gint * percent)
     else
       queue->tail = NULL;
     queue->length--;
+
+    jbuf->packets_bytes -= ((RTPJitterBufferItem *) item)->size;
+    if (((RTPJitterBufferItem *) item)->seqnum != G_MAXUINT)
+      ring_remove_first (jbuf, item->next);
+    level_remove_head (jbuf, (RTPJitterBufferItem *) item, item->next);
+    heap_remove (jbuf, (RTPJitterBufferItem *) item);
   }
 
+  return (RTPJitterBufferItem *) item;
+}
+
+/**
+ * rtp_jitter_buffer_pop:
+ * @jbuf: an #RTPJitterBuffer
+ * @percent: the buffering percent
+ *
+ * Pops the oldest buffer from the packet queue of @jbuf. The popped buffer will
+ * have its timestamp adjusted with the incoming running_time and the detected
+ * clock skew.
+ *
+ * Returns: a #GstBuffer or %NULL when there was no packet in the queue.
+ */
+RTPJitterBufferItem *
+rtp_jitter_buffer_pop (RTPJitterBuffer * jbuf, gint * percent)
+{
+  RTPJitterBufferItem *item;
+
+  g_return_val_if_fail (jbuf != NULL, NULL);
+
+  item = queue_pop_head (jbuf);
+
   /* buffering mode, update buffer stats */
   if (jbuf->mode == RTP_JITTER_BUFFER_MODE_BUFFER)
     update_buffer_level (jbuf, percent);
   else if (percent)
     *percent = -1;
 
-  return (RTPJitterBufferItem *) item;
+  return item;
+}
+
+/**
+ * rtp_jitter_buffer_pop_ready:
+ * @jbuf: an #RTPJitterBuffer
+ * @max_pts: the highest pts that is due, %GST_CLOCK_TIME_NONE to pop all items
+ * @items: (out caller-allocates) (array length=max_items): the popped items
+ * @max_items: the maximum number of items to pop
+ * @percent: the buffering percent
+ *
+ * Pops the oldest items from the packet queue of @jbuf for as long as the
+ * earliest pts of the queued items, see rtp_jitter_buffer_find_earliest(), is
+ * at most @max_pts. This is the same as calling rtp_jitter_buffer_pop() while
+ * that is the case, but the buffering state is only updated once.
+ *
+ * Returns: the number of items stored in @items.
+ */
+guint
+rtp_jitter_buffer_pop_ready (RTPJitterBuffer * jbuf, GstClockTime max_pts,
+    RTPJitterBufferItem ** items, guint max_items, gint * percent)
+{
+  guint n_items = 0;
+
+  g_return_val_if_fail (jbuf != NULL, 0);
+  g_return_val_if_fail (items != NULL || max_items == 0, 0);
+
+  while (n_items < max_items && jbuf->heap_len > 0
+      && jbuf->heap[0].pts <= max_pts)
+    items[n_items++] = queue_pop_head (jbuf);
+
+  /* buffering mode, update buffer stats */
+  if (jbuf->mode == RTP_JITTER_BUFFER_MODE_BUFFER)
+    update_buffer_level (jbuf, percent);
+  else if (percent)
+    *percent = -1;
+
+  return n_items;
 }
 
 /**
@@ -1155,7 +1886,9 @@ rtp_jitter_buffer_peek (RTPJitterBuffer * jbuf)
  * @free_func: function to free each item
  * @user_data: user data passed to @free_func
  *
- * Flush all packets from the jitterbuffer.
+ * Flush all packets from the jitterbuffer. @free_func is responsible for
+ * the data of the items and for giving pooled items back with
+ * rtp_jitter_buffer_free_item().
  */
 void
 rtp_jitter_buffer_flush (RTPJitterBuffer * jbuf, GFunc free_func,
@@ -1168,6 +1901,28 @@ rtp_jitter_buffer_flush (RTPJitterBuffer * jbuf, GFunc free_func,
 
   while ((item = g_queue_pop_head_link (jbuf->packets)))
     free_func ((RTPJitterBufferItem *) item, user_data);
+
+  /* start over with a small ring if it grew */
+  if (jbuf->ring_mask + 1 > RING_MIN_SIZE) {
+    g_free (jbuf->ring);
+    jbuf->ring = g_new0 (RTPJitterBufferItem *, RING_MIN_SIZE);
+    jbuf->ring_mask = RING_MIN_SIZE - 1;
+  } else {
+    memset (jbuf->ring, 0, RING_MIN_SIZE * sizeof (RTPJitterBufferItem *));
+  }
+  jbuf->ring_span = 0;
+  jbuf->ring_packets = 0;
+  jbuf->ring_contiguous = 0;
+  jbuf->packets_bytes = 0;
+
+  if (jbuf->heap_size > HEAP_MIN_SIZE) {
+    g_free (jbuf->heap);
+    jbuf->heap = g_new (RTPJitterBufferHeapEntry, HEAP_MIN_SIZE);
+    jbuf->heap_size = HEAP_MIN_SIZE;
+  }
+  jbuf->heap_len = 0;
+
+  level_reset (jbuf);
 }
 
 /**
@@ -1241,6 +1996,23 @@ rtp_jitter_buffer_num_packets (RTPJitterBuffer * jbuf)
   return jbuf->packets->length;
 }
 
+/**
+ * rtp_jitter_buffer_get_bytes:
+ * @jbuf: an #RTPJitterBuffer
+ *
+ * Get the size of the packets currently in @jbuf, the sum of the @size of
+ * their items.
+ *
+ * Returns: The number of bytes in @jbuf.
+ */
+guint64
+rtp_jitter_buffer_get_bytes (RTPJitterBuffer * jbuf)
+{
+  g_return_val_if_fail (jbuf != NULL, 0);
+
+  return jbuf->packets_bytes;
+}
+
 /**
  * rtp_jitter_buffer_get_ts_diff:
  * @jbuf: an #RTPJitterBuffer
@@ -1290,34 +2062,13 @@ rtp_jitter_buffer_get_ts_diff (RTPJitterBuffer * jbuf)
 static guint16
 rtp_jitter_buffer_get_seqnum_diff (RTPJitterBuffer * jbuf)
 {
-  guint32 high_seqnum, low_seqnum;
-  RTPJitterBufferItem *high_buf, *low_buf;
-  guint16 result;
-
   g_return_val_if_fail (jbuf != NULL, 0);
 
-  high_buf = (RTPJitterBufferItem *) g_queue_peek_tail_link (jbuf->packets);
-  low_buf = (RTPJitterBufferItem *) g_queue_peek_head_link (jbuf->packets);
-
-  while (high_buf && high_buf->seqnum == G_MAXUINT)
-    high_buf = (RTPJitterBufferItem *) high_buf->prev;
-
-  while (low_buf && low_buf->seqnum == G_MAXUINT)
-    low_buf = (RTPJitterBufferItem *) low_buf->next;
-
-  if (!high_buf || !low_buf || high_buf == low_buf)
+  /* the queued packets span ring_span seqnums from the first to the last */
+  if (jbuf->ring_packets < 2)
     return 0;
 
-  high_seqnum = high_buf->seqnum;
-  low_seqnum = low_buf->seqnum;
-
-  /* it needs to work if ts wraps */
-  if (high_seqnum >= low_seqnum) {
-    result = (guint32) (high_seqnum - low_seqnum);
-  } else {
-    result = (guint32) (high_seqnum + G_MAXUINT16 + 1 - low_seqnum);
-  }
-  return result;
+  return jbuf->ring_span - 1;
 }
 
 /**
@@ -1351,42 +2102,138 @@ rtp_jitter_buffer_get_sync (RTPJitterBuffer * jbuf, guint64 * rtptime,
     *last_rtptime = jbuf->last_rtptime;
 }
 
+/**
+ * rtp_jitter_buffer_get_snapshot:
+ * @jbuf: an #RTPJitterBuffer
+ * @snapshot: (out): the timing state of @jbuf
+ *
+ * Get the timing state of @jbuf so that another #RTPJitterBuffer receiving the
+ * same stream can continue from it with rtp_jitter_buffer_set_snapshot().
+ *
+ * Returns: %FALSE if the skew window of @jbuf is not filled yet.
+ */
+gboolean
+rtp_jitter_buffer_get_snapshot (RTPJitterBuffer * jbuf,
+    RTPJitterBufferSnapshot * snapshot)
+{
+  guint i;
+
+  g_return_val_if_fail (jbuf != NULL, FALSE);
+  g_return_val_if_fail (snapshot != NULL, FALSE);
+
+  if (jbuf->window_filling || jbuf->base_time == GST_CLOCK_TIME_NONE
+      || jbuf->need_resync)
+    return FALSE;
+
+  snapshot->clock_rate = jbuf->clock_rate;
+  snapshot->base_time = jbuf->base_time;
+  snapshot->base_rtptime = jbuf->base_rtptime;
+  snapshot->base_extrtp = jbuf->base_extrtp;
+  snapshot->ext_rtptime = jbuf->ext_rtptime;
+  snapshot->skew = jbuf->skew;
+  snapshot->jitter = jbuf->jitter;
+
+  /* the oldest sample is the next one to be replaced */
+  snapshot->window_size = jbuf->window_size;
+  for (i = 0; i < jbuf->window_size; i++)
+    snapshot->window[i] =
+        jbuf->window[(jbuf->window_pos + i) % jbuf->window_size];
+
+  return TRUE;
+}
+
+/**
+ * rtp_jitter_buffer_set_snapshot:
+ * @jbuf: an #RTPJitterBuffer
+ * @snapshot: a timing state from rtp_jitter_buffer_get_snapshot()
+ *
+ * Continue the skew estimation of the stream described by @snapshot instead
+ * of filling the skew window again. Only the newest samples are kept if the
+ * window of @jbuf is smaller.
+ *
+ * Returns: %FALSE if @snapshot is invalid or for another clock rate.
+ */
+gboolean
+rtp_jitter_buffer_set_snapshot (RTPJitterBuffer * jbuf,
+    const RTPJitterBufferSnapshot * snapshot)
+{
+  guint i, n_samples;
+
+  g_return_val_if_fail (jbuf != NULL, FALSE);
+  g_return_val_if_fail (snapshot != NULL, FALSE);
+
+  if (snapshot->clock_rate != jbuf->clock_rate || snapshot->window_size == 0
+      || snapshot->window_size > RTP_JITTER_BUFFER_MAX_WINDOW
+      || snapshot->base_time == GST_CLOCK_TIME_NONE
+      || snapshot->base_rtptime == GST_CLOCK_TIME_NONE)
+    return FALSE;
+
+  rtp_jitter_buffer_reset_skew (jbuf);
+
+  jbuf->base_time = snapshot->base_time;
+  jbuf->base_rtptime = snapshot->base_rtptime;
+  jbuf->base_extrtp = snapshot->base_extrtp;
+  jbuf->ext_rtptime = snapshot->ext_rtptime;
+  jbuf->skew = snapshot->skew;
+  jbuf->jitter = snapshot->jitter;
+  jbuf->need_resync = FALSE;
+
+  n_samples = MIN (snapshot->window_size, jbuf->window_max_size);
+  for (i = 0; i < n_samples; i++)
+    window_push (jbuf, i,
+        snapshot->window[snapshot->window_size - n_samples + i]);
+  jbuf->window_size = n_samples;
+  jbuf->window_pos = 0;
+  jbuf->window_filling = FALSE;
+
+  GST_DEBUG ("continuing from snapshot, skew %" G_GINT64_FORMAT ", min %"
+      G_GINT64_FORMAT, jbuf->skew, jbuf->window_min);
+
+  return TRUE;
+}
+
 /**
  * rtp_jitter_buffer_can_fast_start:
  * @jbuf: an #RTPJitterBuffer
  * @num_packets: Number of consecutive packets needed
  *
  * Check if in the queue if there is enough packets with consecutive seqnum in
- * order to start delivering them.
+ * order to start delivering them, starting with the first queued packet. This
+ * is tracked as packets are inserted and popped.
  *
  * Returns: %TRUE if the required number of consecutive packets was found.
  */
 gboolean
 rtp_jitter_buffer_can_fast_start (RTPJitterBuffer * jbuf, gint num_packet)
 {
-  gboolean ret = TRUE;
-  RTPJitterBufferItem *last_item = NULL, *item;
-  gint i;
+  g_return_val_if_fail (jbuf != NULL, FALSE);
 
-  if (rtp_jitter_buffer_num_packets (jbuf) < (guint) num_packet)
-    return FALSE;
+  return jbuf->ring_contiguous >= (guint) num_packet;
+}
 
-  item = rtp_jitter_buffer_peek (jbuf);
-  for (i = 0; i < num_packet; i++) {
-    if (G_LIKELY (last_item)) {
-      guint16 expected_seqnum = last_item->seqnum + 1;
+/**
+ * rtp_jitter_buffer_num_contiguous:
+ * @jbuf: an #RTPJitterBuffer
+ * @seqnum: the seqnum of the first queued packet, or -1 for any
+ *
+ * Get the number of packets with consecutive seqnums at the head of the queue,
+ * as long as the first one has @seqnum.
+ *
+ * Returns: the number of consecutive packets, 0 if the queue doesn't start
+ * with @seqnum.
+ */
+guint
+rtp_jitter_buffer_num_contiguous (RTPJitterBuffer * jbuf, gint seqnum)
+{
+  g_return_val_if_fail (jbuf != NULL, 0);
 
-      if (expected_seqnum != item->seqnum) {
-        ret = FALSE;
-        break;
-      }
-    }
+  if (jbuf->ring_packets == 0)
+    return 0;
 
-    last_item = item;
-    item = (RTPJitterBufferItem *) last_item->next;
-  }
+  if (seqnum != -1 && jbuf->ring_base != (guint16) seqnum)
+    return 0;
 
-  return ret;
+  return jbuf->ring_contiguous;
 }
 
 gboolean
@@ -1396,25 +2243,46 @@ rtp_jitter_buffer_is_full (RTPJitterBuffer * jbuf)
       rtp_jitter_buffer_num_packets (jbuf) > 10000;
 }
 
+/**
+ * rtp_jitter_buffer_find_earliest:
+ * @jbuf: an #RTPJitterBuffer
+ * @pts: (out): the lowest pts of the queued items
+ * @seqnum: (out): the seqnum of that item
+ *
+ * Find the queued item with the lowest pts, items without pts come last. When
+ * several items have the same pts, the most recently inserted one is returned.
+ * @pts is %GST_CLOCK_TIME_NONE and @seqnum 0 when @jbuf is empty.
+ */
 void
 rtp_jitter_buffer_find_earliest (RTPJitterBuffer * jbuf, GstClockTime * pts,
     guint * seqnum)
 {
-  GList *tmp;
-  RTPJitterBufferItem *earliest = NULL;
-
-  *pts = GST_CLOCK_TIME_NONE;
-  *seqnum = 0;
-
-  for (tmp = jbuf->packets->head; tmp; tmp = tmp->next) {
-    RTPJitterBufferItem *item = (RTPJitterBufferItem *) tmp;
-
-    if (!earliest || item->pts <= earliest->pts)
-      earliest = item;
+  if (jbuf->heap_len > 0) {
+    *pts = jbuf->heap[0].pts;
+    *seqnum = jbuf->heap[0].item->seqnum;
+  } else {
+    *pts = GST_CLOCK_TIME_NONE;
+    *seqnum = 0;
   }
+}
 
-  if (earliest) {
-    *pts = earliest->pts;
-    *seqnum = earliest->seqnum;
-  }
+#ifdef RTP_JITTER_BUFFER_TUNING
+/**
+ * rtp_jitter_buffer_get_tuning_stats:
+ * @jbuf: an #RTPJitterBuffer
+ * @stats: (out): the #RTPJitterBufferTuningStats of @jbuf
+ *
+ * Get the tuning counters of @jbuf along with its current skew estimate.
+ */
+void
+rtp_jitter_buffer_get_tuning_stats (RTPJitterBuffer * jbuf,
+    RTPJitterBufferTuningStats * stats)
+{
+  g_return_if_fail (jbuf != NULL);
+  g_return_if_fail (stats != NULL);
+
+  *stats = jbuf->tuning;
+  stats->skew = jbuf->skew;
+  stats->window_min = jbuf->window_min;
 }
+#endif
@@ -23,9 +23,12 @@
 #include <gst/gst.h>
 #include <gst/rtp/gstrtcpbuffer.h>
 
+#include "rtpstats.h"
+
 typedef struct _RTPJitterBuffer RTPJitterBuffer;
 typedef struct _RTPJitterBufferClass RTPJitterBufferClass;
 typedef struct _RTPJitterBufferItem RTPJitterBufferItem;
+typedef struct _RTPJitterBufferHeapEntry RTPJitterBufferHeapEntry;
 
 #define RTP_TYPE_JITTER_BUFFER             (rtp_jitter_buffer_get_type())
 #define RTP_JITTER_BUFFER(src)             (G_TYPE_CHECK_INSTANCE_CAST((src),RTP_TYPE_JITTER_BUFFER,RTPJitterBuffer))
@@ -48,6 +51,10 @@ typedef struct _RTPJitterBufferItem RTPJitterBufferItem;
  *    like #RTP_JITTER_BUFFER_MODE_SLAVE but skew is assumed to be 0. Good for
  *    low latency communication when sender and receiver clocks are
  *    synchronized and there is thus no clock skew.
+ * @RTP_JITTER_BUFFER_MODE_PASSTHROUGH: like #RTP_JITTER_BUFFER_MODE_SLAVE,
+ *    but packets which arrive in order are not held until their deadline,
+ *    only gaps and reordered packets are waited for. Good for interactive
+ *    communication on links with little reordering.
  * @RTP_JITTER_BUFFER_MODE_LAST: last buffer mode.
  *
  * The different buffer modes for a jitterbuffer.
@@ -58,13 +65,88 @@ typedef enum {
   RTP_JITTER_BUFFER_MODE_BUFFER  = 2,
   /* FIXME 3 is missing because it was used for 'auto' in jitterbuffer */
   RTP_JITTER_BUFFER_MODE_SYNCED  = 4,
+  RTP_JITTER_BUFFER_MODE_PASSTHROUGH = 5,
   RTP_JITTER_BUFFER_MODE_LAST
 } RTPJitterBufferMode;
 
 #define RTP_TYPE_JITTER_BUFFER_MODE (rtp_jitter_buffer_mode_get_type())
 GType rtp_jitter_buffer_mode_get_type (void);
 
+/**
+ * RTPJitterBufferInsertResult:
+ * @RTP_JITTER_BUFFER_INSERT_OK: the item was inserted
+ * @RTP_JITTER_BUFFER_INSERT_DUPLICATE: a packet with the same seqnum is
+ *    already queued
+ * @RTP_JITTER_BUFFER_INSERT_OUT_OF_RANGE: the seqnum is too far from the
+ *    queued packets to be ordered with them
+ *
+ * The outcome of inserting an item in the jitterbuffer.
+ */
+typedef enum {
+  RTP_JITTER_BUFFER_INSERT_OK           = 0,
+  RTP_JITTER_BUFFER_INSERT_DUPLICATE    = 1,
+  RTP_JITTER_BUFFER_INSERT_OUT_OF_RANGE = 2
+} RTPJitterBufferInsertResult;
+
 #define RTP_JITTER_BUFFER_MAX_WINDOW 512
+
+#define RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS 16
+
+/**
+ * RTPJitterBufferTuningStats:
+ * @insert_walk: histogram of the number of ring slots and events looked at to
+ *    find the position of an inserted packet
+ * @reorder_distance: histogram of the number of seqnums an inserted packet is
+ *    behind the last queued one
+ * @queue_depth: histogram of the number of queued items after an insertion
+ * @num_resyncs: number of times the skew estimation locked on new base times
+ * @num_skew_resets: number of times the skew estimation was reset, including
+ *    the initial reset
+ * @skew: the current skew estimate
+ * @window_min: the current minimum of the skew window
+ *
+ * Counters of the work done by an #RTPJitterBuffer, only maintained when built
+ * with RTP_JITTER_BUFFER_TUNING defined. Bucket 0 of the histograms counts the
+ * value 0, bucket n the values from 2^(n-1) to 2^n - 1 and the last bucket all
+ * bigger values.
+ */
+typedef struct {
+  guint64        insert_walk[RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS];
+  guint64        reorder_distance[RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS];
+  guint64        queue_depth[RTP_JITTER_BUFFER_HISTOGRAM_BUCKETS];
+  guint64        num_resyncs;
+  guint64        num_skew_resets;
+  gint64         skew;
+  gint64         window_min;
+} RTPJitterBufferTuningStats;
+
+/**
+ * RTPJitterBufferSnapshot:
+ * @clock_rate: the clock rate of the stream
+ * @base_time: the running time the timing of the outgoing packets is based on
+ * @base_rtptime: the RTP time matching @base_time, in nanoseconds
+ * @base_extrtp: the extended RTP timestamp matching @base_time
+ * @ext_rtptime: the last extended RTP timestamp
+ * @skew: the skew estimate
+ * @jitter: the interarrival jitter, scaled by 16
+ * @window_size: number of samples in @window
+ * @window: the samples of the skew window, oldest first
+ *
+ * The timing state of a converged #RTPJitterBuffer, which another one can
+ * start from for the same stream instead of estimating the skew again.
+ */
+typedef struct {
+  guint32        clock_rate;
+  GstClockTime   base_time;
+  GstClockTime   base_rtptime;
+  guint64        base_extrtp;
+  guint64        ext_rtptime;
+  gint64         skew;
+  guint64        jitter;
+  guint          window_size;
+  gint64         window[RTP_JITTER_BUFFER_MAX_WINDOW];
+} RTPJitterBufferSnapshot;
+
 /**
  * RTPJitterBuffer:
  *
@@ -74,6 +156,32 @@ struct _RTPJitterBuffer {
   GObject        object;
 
   GQueue        *packets;
+  /* sum of the item sizes in @packets */
+  guint64        packets_bytes;
+
+  /* packets in @packets indexed by seqnum & ring_mask, starting at the
+   * lowest queued seqnum ring_base and covering ring_span seqnums, the
+   * first ring_contiguous of them are all queued */
+  RTPJitterBufferItem **ring;
+  guint          ring_mask;
+  guint16        ring_base;
+  guint          ring_span;
+  guint          ring_packets;
+  guint          ring_contiguous;
+
+  /* recycled items, linked through their next pointer. The pool has its own
+   * lock as items are given back from wherever they get dropped */
+  GMutex         pool_lock;
+  RTPJitterBufferItem *pool;
+  guint          pool_free;
+  guint          pool_used;
+  guint          pool_high_water;
+
+  /* binary min-heap on the pts of all queued items */
+  RTPJitterBufferHeapEntry *heap;
+  guint          heap_len;
+  guint          heap_size;
+  guint          heap_stamp;
 
   RTPJitterBufferMode mode;
 
@@ -84,12 +192,22 @@ struct _RTPJitterBuffer {
   guint64           low_level;
   guint64           high_level;
 
+  /* first and last queued item with a timestamp, each with the seqnum of the
+   * nearest packet at or before it (G_MAXUINT for none), and the resulting
+   * buffer level */
+  RTPJitterBufferItem *level_low;
+  RTPJitterBufferItem *level_high;
+  guint             level_low_seqnum;
+  guint             level_high_seqnum;
+  guint64           level;
+
   /* for calculating skew */
   gboolean       need_resync;
   GstClockTime   base_time;
   GstClockTime   base_rtptime;
   GstClockTime   media_clock_base_time;
   guint32        clock_rate;
+  RTPTimeScale   time_scale;
   GstClockTime   base_extrtp;
   GstClockTime   prev_out_time;
   guint64        ext_rtptime;
@@ -99,10 +217,23 @@ struct _RTPJitterBuffer {
   guint          window_size;
   gboolean       window_filling;
   gint64         window_min;
+  /* positions in @window of the samples that can still become the window
+   * minimum, oldest first with increasing values */
+  guint16        window_min_pos[RTP_JITTER_BUFFER_MAX_WINDOW];
+  guint          window_min_head;
+  guint          window_min_len;
+  guint          window_max_size;
+  GstClockTime   window_max_time;
   gint64         skew;
   gint64         prev_send_diff;
   gboolean       buffering_disabled;
 
+  /* RFC 3550 interarrival jitter, in nanoseconds scaled by 16 like
+   * RTPSourceStats::jitter */
+  gboolean       have_transit;
+  gint64         transit;
+  guint64        jitter;
+
   GMutex         clock_lock;
   GstClock      *pipeline_clock;
   GstClock      *media_clock;
@@ -110,6 +241,22 @@ struct _RTPJitterBuffer {
   guint64        media_clock_offset;
 
   gboolean       rfc7273_sync;
+
+  /* bumped with clock_lock held whenever the clocks, the offset or
+   * rfc7273_sync change */
+  gint           clock_generation;
+
+  /* copy of the above as last seen by rtp_jitter_buffer_calculate_pts(),
+   * holding its own references to the clocks */
+  gint           snapshot_generation;
+  GstClock      *snapshot_pipeline_clock;
+  GstClock      *snapshot_media_clock;
+  guint64        snapshot_media_clock_offset;
+  gboolean       snapshot_rfc7273_sync;
+
+#ifdef RTP_JITTER_BUFFER_TUNING
+  RTPJitterBufferTuningStats tuning;
+#endif
 };
 
 struct _RTPJitterBufferClass {
@@ -129,8 +276,13 @@ struct _RTPJitterBufferClass {
  *   append.
  * @count: amount of seqnum in this item
  * @rtptime: rtp timestamp
+ * @heap_index: position of the item in the pts index of the jitterbuffer,
+ *   private. @pts must not be changed while the item is queued.
+ * @size: size of the packet in @data, 0 for other items
  *
- * An object containing an RTP packet or event.
+ * An object containing an RTP packet or event. @size is set by the caller
+ * when the packet is received so that the packet memory is not needed again
+ * until it is pushed.
  */
 struct _RTPJitterBufferItem {
   gpointer data;
@@ -142,6 +294,8 @@ struct _RTPJitterBufferItem {
   guint seqnum;
   guint count;
   guint rtptime;
+  guint heap_index;
+  guint size;
 };
 
 GType rtp_jitter_buffer_get_type (void);
@@ -156,6 +310,7 @@ GstClockTime          rtp_jitter_buffer_get_delay        (RTPJitterBuffer *jbuf)
 void                  rtp_jitter_buffer_set_delay        (RTPJitterBuffer *jbuf, GstClockTime delay);
 
 void                  rtp_jitter_buffer_set_clock_rate   (RTPJitterBuffer *jbuf, guint32 clock_rate);
+void                  rtp_jitter_buffer_set_skew_window  (RTPJitterBuffer *jbuf, guint size, GstClockTime time);
 guint32               rtp_jitter_buffer_get_clock_rate   (RTPJitterBuffer *jbuf);
 
 void                  rtp_jitter_buffer_set_media_clock  (RTPJitterBuffer *jbuf, GstClock * clock, guint64 clock_offset);
@@ -165,15 +320,30 @@ gboolean              rtp_jitter_buffer_get_rfc7273_sync (RTPJitterBuffer *jbuf)
 void                  rtp_jitter_buffer_set_rfc7273_sync (RTPJitterBuffer *jbuf, gboolean rfc7273_sync);
 
 void                  rtp_jitter_buffer_reset_skew       (RTPJitterBuffer *jbuf);
+gboolean              rtp_jitter_buffer_get_snapshot     (RTPJitterBuffer *jbuf, RTPJitterBufferSnapshot *snapshot);
+gboolean              rtp_jitter_buffer_set_snapshot     (RTPJitterBuffer *jbuf, const RTPJitterBufferSnapshot *snapshot);
+gint64                rtp_jitter_buffer_get_skew         (RTPJitterBuffer *jbuf);
+GstClockTime          rtp_jitter_buffer_get_jitter       (RTPJitterBuffer *jbuf);
+
+RTPJitterBufferItem * rtp_jitter_buffer_alloc_item       (RTPJitterBuffer *jbuf);
+void                  rtp_jitter_buffer_free_item        (RTPJitterBuffer *jbuf, RTPJitterBufferItem *item);
+void                  rtp_jitter_buffer_get_pool_stats   (RTPJitterBuffer *jbuf, guint *n_free, guint *high_water);
 
 gboolean              rtp_jitter_buffer_insert           (RTPJitterBuffer *jbuf,
                                                           RTPJitterBufferItem *item,
                                                           gboolean *head, gint *percent);
+guint                 rtp_jitter_buffer_insert_list      (RTPJitterBuffer *jbuf,
+                                                          RTPJitterBufferItem **items, guint n_items,
+                                                          RTPJitterBufferInsertResult *results,
+                                                          gboolean *head, gint *percent);
 
 void                  rtp_jitter_buffer_disable_buffering (RTPJitterBuffer *jbuf, gboolean disabled);
 
 RTPJitterBufferItem * rtp_jitter_buffer_peek             (RTPJitterBuffer *jbuf);
 RTPJitterBufferItem * rtp_jitter_buffer_pop              (RTPJitterBuffer *jbuf, gint *percent);
+guint                 rtp_jitter_buffer_pop_ready        (RTPJitterBuffer *jbuf, GstClockTime max_pts,
+                                                          RTPJitterBufferItem **items, guint max_items,
+                                                          gint *percent);
 
 void                  rtp_jitter_buffer_flush            (RTPJitterBuffer *jbuf,
                                                           GFunc free_func, gpointer user_data);
@@ -183,6 +353,7 @@ void                  rtp_jitter_buffer_set_buffering    (RTPJitterBuffer * jbuf
 gint                  rtp_jitter_buffer_get_percent      (RTPJitterBuffer * jbuf);
 
 guint                 rtp_jitter_buffer_num_packets      (RTPJitterBuffer *jbuf);
+guint64               rtp_jitter_buffer_get_bytes        (RTPJitterBuffer *jbuf);
 guint32               rtp_jitter_buffer_get_ts_diff      (RTPJitterBuffer *jbuf);
 
 void                  rtp_jitter_buffer_get_sync         (RTPJitterBuffer *jbuf, guint64 *rtptime,
@@ -194,8 +365,13 @@ GstClockTime          rtp_jitter_buffer_calculate_pts    (RTPJitterBuffer * jbuf
                                                           gboolean is_rtx);
 
 gboolean              rtp_jitter_buffer_can_fast_start   (RTPJitterBuffer * jbuf, gint num_packet);
+guint                 rtp_jitter_buffer_num_contiguous   (RTPJitterBuffer * jbuf, gint seqnum);
 
 gboolean              rtp_jitter_buffer_is_full          (RTPJitterBuffer * jbuf);
 void                  rtp_jitter_buffer_find_earliest     (RTPJitterBuffer * jbuf, GstClockTime *pts, guint * seqnum);
 
+#ifdef RTP_JITTER_BUFFER_TUNING
+void                  rtp_jitter_buffer_get_tuning_stats (RTPJitterBuffer * jbuf, RTPJitterBufferTuningStats *stats);
+#endif
+
 #endif /* __RTP_JITTER_BUFFER_H__ */
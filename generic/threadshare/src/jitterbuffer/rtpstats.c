@@ -21,13 +21,230 @@
 
 #include "rtpstats.h"
 
+/* upper 64 bits of the 128 bit product of @a and @b */
+static inline guint64
+mul_high (guint64 a, guint64 b)
+{
+#ifdef __SIZEOF_INT128__
+  return (guint64) (((unsigned __int128) a * b) >> 64);
+#else
+  guint64 a_lo = a & G_MAXUINT32, a_hi = a >> 32;
+  guint64 b_lo = b & G_MAXUINT32, b_hi = b >> 32;
+  guint64 lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+  guint64 lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  guint64 cross = (lo_lo >> 32) + (hi_lo & G_MAXUINT32) + lo_hi;
+
+  return hi_hi + (hi_lo >> 32) + (cross >> 32);
+#endif
+}
+
+/* @divisor must be below 2^32, see "Division by Invariant Integers using
+ * Multiplication" by Granlund and Montgomery */
+static void
+reciprocal_init (RTPReciprocal * recip, guint64 divisor)
+{
+  guint64 quot = 0, rem;
+  guint log2 = 0, i;
+
+  while (divisor >> (log2 + 1))
+    log2++;
+
+  recip->divisor = divisor;
+  recip->magic = 0;
+  recip->shift = log2;
+  recip->add = FALSE;
+
+  /* powers of two only need the shift */
+  if ((divisor & (divisor - 1)) == 0)
+    return;
+
+  /* 2^(64 + log2) / divisor, the remainder always stays below the divisor */
+  rem = G_GUINT64_CONSTANT (1) << log2;
+  for (i = 0; i < 64; i++) {
+    rem <<= 1;
+    quot <<= 1;
+    if (rem >= divisor) {
+      rem -= divisor;
+      quot |= 1;
+    }
+  }
+
+  if (divisor - rem < (G_GUINT64_CONSTANT (1) << log2)) {
+    recip->magic = quot + 1;
+  } else {
+    /* the multiplier needs 65 bits, only keep the lower ones and add the
+     * dividend back when dividing */
+    quot += quot;
+    if (rem + rem >= divisor)
+      quot++;
+    recip->magic = quot + 1;
+    recip->add = TRUE;
+  }
+}
+
+static inline guint64
+reciprocal_divide (const RTPReciprocal * recip, guint64 val)
+{
+  guint64 quot;
+
+  if (recip->magic == 0)
+    return val >> recip->shift;
+
+  quot = mul_high (recip->magic, val);
+  if (recip->add)
+    quot += (val - quot) >> 1;
+
+  return quot >> recip->shift;
+}
+
+/* @quot * @num + @scaled_rem, saturating like gst_util_uint64_scale() */
+static inline guint64
+scale_combine (guint64 quot, guint64 scaled_rem, guint64 num, guint64 max_quot)
+{
+  guint64 res;
+
+  if (G_UNLIKELY (quot > max_quot))
+    return G_MAXUINT64;
+
+  res = quot * num;
+  if (G_UNLIKELY (res + scaled_rem < res))
+    return G_MAXUINT64;
+
+  return res + scaled_rem;
+}
+
+/* @val * @num / @denom with constants the compiler turns into
+ * multiplications, the remainder times @num must fit in 64 bits */
+static inline guint64
+scale_const (guint64 val, guint64 num, guint64 denom)
+{
+  return scale_combine (val / denom, val % denom * num / denom, num,
+      G_MAXUINT64 / num);
+}
+
+static inline guint64
+scale_reciprocal (guint64 val, const RTPReciprocal * num,
+    const RTPReciprocal * denom, guint64 max_quot)
+{
+  guint64 quot, rem;
+
+  quot = reciprocal_divide (denom, val);
+  rem = val - quot * denom->divisor;
+
+  return scale_combine (quot, reciprocal_divide (denom, rem * num->divisor),
+      num->divisor, max_quot);
+}
+
+/**
+ * gst_rtp_time_scale_init:
+ * @scale: an #RTPTimeScale
+ * @clock_rate: the clock rate
+ *
+ * Precompute the conversions for @clock_rate.
+ */
+void
+gst_rtp_time_scale_init (RTPTimeScale * scale, guint32 clock_rate)
+{
+  guint64 gcd = GST_SECOND, b = clock_rate, t;
+
+  scale->clock_rate = clock_rate;
+  scale->num.divisor = 0;
+  scale->denom.divisor = 0;
+
+  /* the conversions fall back to gst_util_uint64_scale_int() and its checks
+   * for the clock rates it refuses */
+  if (clock_rate == 0 || clock_rate > G_MAXINT)
+    return;
+
+  while (b) {
+    t = gcd % b;
+    gcd = b;
+    b = t;
+  }
+
+  reciprocal_init (&scale->num, GST_SECOND / gcd);
+  reciprocal_init (&scale->denom, clock_rate / gcd);
+  scale->max_time_quot = G_MAXUINT64 / scale->num.divisor;
+  scale->max_rtp_quot = G_MAXUINT64 / scale->denom.divisor;
+}
+
+/**
+ * gst_rtp_time_scale_to_time:
+ * @scale: an #RTPTimeScale
+ * @rtptime: a time in clock rate units
+ *
+ * Returns: @rtptime in nanoseconds, the same as
+ * gst_util_uint64_scale_int (@rtptime, %GST_SECOND, clock_rate).
+ */
+GstClockTime
+gst_rtp_time_scale_to_time (const RTPTimeScale * scale, guint64 rtptime)
+{
+  switch (scale->clock_rate) {
+    case 90000:
+      return scale_const (rtptime, 100000, 9);
+    case 48000:
+      return scale_const (rtptime, 62500, 3);
+    case 44100:
+      return scale_const (rtptime, 10000000, 441);
+    case 16000:
+      return scale_const (rtptime, 62500, 1);
+    case 8000:
+      return scale_const (rtptime, 125000, 1);
+    default:
+      break;
+  }
+
+  if (G_UNLIKELY (scale->denom.divisor == 0))
+    return gst_util_uint64_scale_int (rtptime, GST_SECOND, scale->clock_rate);
+
+  return scale_reciprocal (rtptime, &scale->num, &scale->denom,
+      scale->max_time_quot);
+}
+
+/**
+ * gst_rtp_time_scale_to_rtp:
+ * @scale: an #RTPTimeScale
+ * @time: a time in nanoseconds
+ *
+ * Returns: @time in clock rate units, the same as
+ * gst_util_uint64_scale (@time, clock_rate, %GST_SECOND).
+ */
+guint64
+gst_rtp_time_scale_to_rtp (const RTPTimeScale * scale, GstClockTime time)
+{
+  switch (scale->clock_rate) {
+    case 90000:
+      return scale_const (time, 9, 100000);
+    case 48000:
+      return scale_const (time, 3, 62500);
+    case 44100:
+      return scale_const (time, 441, 10000000);
+    case 16000:
+      return scale_const (time, 1, 62500);
+    case 8000:
+      return scale_const (time, 1, 125000);
+    default:
+      break;
+  }
+
+  if (G_UNLIKELY (scale->denom.divisor == 0))
+    return gst_util_uint64_scale (time, scale->clock_rate, GST_SECOND);
+
+  return scale_reciprocal (time, &scale->denom, &scale->num,
+      scale->max_rtp_quot);
+}
+
 void
 gst_rtp_packet_rate_ctx_reset (RTPPacketRateCtx * ctx, gint32 clock_rate)
 {
   ctx->clock_rate = clock_rate;
+  gst_rtp_time_scale_init (&ctx->scale, clock_rate);
   ctx->probed = FALSE;
   ctx->avg_packet_rate = -1;
   ctx->last_ts = -1;
+  /* Thresholds are never derived for a time of 0, nothing is cached */
+  ctx->dropout.time_ms = 0;
+  ctx->misorder.time_ms = 0;
 }
 
 guint32
@@ -56,8 +273,9 @@ gst_rtp_packet_rate_ctx_update (RTPPacketRateCtx * ctx, guint16 seqnum,
   }
 
   diff_ts = new_ts - ctx->last_ts;
-  diff_ts = gst_util_uint64_scale_int (diff_ts, GST_SECOND, ctx->clock_rate);
-  new_packet_rate = gst_util_uint64_scale (diff_seqnum, GST_SECOND, diff_ts);
+  diff_ts = gst_rtp_time_scale_to_time (&ctx->scale, diff_ts);
+  /* diff_seqnum is 1 here, no need for a scale */
+  new_packet_rate = GST_SECOND / MAX (diff_ts, 1);
 
   /* The goal is that higher packet rates "win".
    * If there's a sudden burst, the average will go up fast,
@@ -85,6 +303,21 @@ gst_rtp_packet_rate_ctx_get (RTPPacketRateCtx * ctx)
   return ctx->avg_packet_rate;
 }
 
+/* The rate usually stays the same over many packets, the division is only
+ * done again once it changes */
+static inline guint32
+packet_rate_threshold (RTPPacketRateThreshold * threshold, guint32 packet_rate,
+    gint32 time_ms, guint32 min_value)
+{
+  if (threshold->packet_rate != packet_rate || threshold->time_ms != time_ms) {
+    threshold->packet_rate = packet_rate;
+    threshold->time_ms = time_ms;
+    threshold->value = MAX (min_value, packet_rate * time_ms / 1000);
+  }
+
+  return threshold->value;
+}
+
 guint32
 gst_rtp_packet_rate_ctx_get_max_dropout (RTPPacketRateCtx * ctx, gint32 time_ms)
 {
@@ -92,7 +325,8 @@ gst_rtp_packet_rate_ctx_get_max_dropout (RTPPacketRateCtx * ctx, gint32 time_ms)
     return RTP_DEF_DROPOUT;
   }
 
-  return MAX (RTP_MIN_DROPOUT, ctx->avg_packet_rate * time_ms / 1000);
+  return packet_rate_threshold (&ctx->dropout, ctx->avg_packet_rate, time_ms,
+      RTP_MIN_DROPOUT);
 }
 
 guint32
@@ -103,7 +337,44 @@ gst_rtp_packet_rate_ctx_get_max_misorder (RTPPacketRateCtx * ctx,
     return RTP_DEF_MISORDER;
   }
 
-  return MAX (RTP_MIN_MISORDER, ctx->avg_packet_rate * time_ms / 1000);
+  return packet_rate_threshold (&ctx->misorder, ctx->avg_packet_rate, time_ms,
+      RTP_MIN_MISORDER);
+}
+
+/**
+ * gst_rtp_packet_rate_ctx_update_list:
+ * @ctx: an #RTPPacketRateCtx
+ * @entries: (array length=n_entries): the packets in arrival order
+ * @n_entries: the number of entries
+ * @dropout_ms: the time covered by the maximum dropout
+ * @misorder_ms: the time covered by the maximum misorder
+ *
+ * Accounts for the packets of @entries, as many calls to
+ * gst_rtp_packet_rate_ctx_update() would. The maximum dropout and misorder of
+ * each entry are the ones gst_rtp_packet_rate_ctx_get_max_dropout() and
+ * gst_rtp_packet_rate_ctx_get_max_misorder() return once its packet is
+ * accounted for.
+ *
+ * Returns: the average packet rate after the last entry
+ */
+guint32
+gst_rtp_packet_rate_ctx_update_list (RTPPacketRateCtx * ctx,
+    RTPPacketRateEntry * entries, guint n_entries, gint32 dropout_ms,
+    gint32 misorder_ms)
+{
+  guint i;
+
+  for (i = 0; i < n_entries; i++) {
+    RTPPacketRateEntry *entry = &entries[i];
+
+    gst_rtp_packet_rate_ctx_update (ctx, entry->seqnum, entry->ts);
+    entry->max_dropout = gst_rtp_packet_rate_ctx_get_max_dropout (ctx,
+        dropout_ms);
+    entry->max_misorder = gst_rtp_packet_rate_ctx_get_max_misorder (ctx,
+        misorder_ms);
+  }
+
+  return ctx->avg_packet_rate;
 }
 
 /**
@@ -203,6 +203,59 @@ typedef struct {
 #define RTP_DEF_MISORDER     100
 #define RTP_MIN_MISORDER     10
 
+/**
+ * RTPReciprocal:
+ * @divisor: the divisor, 0 when unset
+ * @magic: multiplier, 0 for powers of two
+ * @shift: shift applied after the multiplication
+ * @add: whether the multiplier needs a 65th bit
+ *
+ * Precomputed reciprocal to divide 64 bit values by a constant with a
+ * multiplication and a shift.
+ */
+typedef struct {
+  guint64 divisor;
+  guint64 magic;
+  guint8 shift;
+  gboolean add;
+} RTPReciprocal;
+
+/**
+ * RTPTimeScale:
+ * @clock_rate: the clock rate
+ * @num: %GST_SECOND divided by its greatest common divisor with @clock_rate
+ * @denom: @clock_rate divided by the same
+ * @max_time_quot: largest quotient by @denom that can be scaled by @num
+ * @max_rtp_quot: largest quotient by @num that can be scaled by @denom
+ *
+ * Conversion between RTP time in @clock_rate units and #GstClockTime that
+ * gives the same results as gst_util_uint64_scale() without its 128 bit
+ * divisions.
+ */
+typedef struct {
+  guint32 clock_rate;
+  RTPReciprocal num;
+  RTPReciprocal denom;
+  guint64 max_time_quot;
+  guint64 max_rtp_quot;
+} RTPTimeScale;
+
+void gst_rtp_time_scale_init (RTPTimeScale * scale, guint32 clock_rate);
+GstClockTime gst_rtp_time_scale_to_time (const RTPTimeScale * scale, guint64 rtptime);
+guint64 gst_rtp_time_scale_to_rtp (const RTPTimeScale * scale, GstClockTime time);
+
+/**
+ * RTPPacketRateThreshold:
+ *
+ * A threshold derived from the packet rate, cached until the rate or the
+ * time it covers change.
+ */
+typedef struct {
+  gint32 time_ms;
+  guint32 packet_rate;
+  guint32 value;
+} RTPPacketRateThreshold;
+
 /**
  * RTPPacketRateCtx:
  *
@@ -214,13 +267,34 @@ typedef struct {
   guint16 last_seqnum;
   guint64 last_ts;
   guint32 avg_packet_rate;
+  RTPTimeScale scale;
+  RTPPacketRateThreshold dropout;
+  RTPPacketRateThreshold misorder;
 } RTPPacketRateCtx;
 
+/**
+ * RTPPacketRateEntry:
+ * @seqnum: the seqnum of the packet
+ * @ts: the RTP timestamp of the packet
+ * @max_dropout: the maximum dropout once the packet is accounted for
+ * @max_misorder: the maximum misorder once the packet is accounted for
+ *
+ * A packet of a batch given to gst_rtp_packet_rate_ctx_update_list().
+ */
+typedef struct {
+  guint16 seqnum;
+  guint32 ts;
+  guint32 max_dropout;
+  guint32 max_misorder;
+} RTPPacketRateEntry;
+
 void gst_rtp_packet_rate_ctx_reset (RTPPacketRateCtx * ctx, gint32 clock_rate);
 guint32 gst_rtp_packet_rate_ctx_update (RTPPacketRateCtx *ctx, guint16 seqnum, guint32 ts);
 guint32 gst_rtp_packet_rate_ctx_get (RTPPacketRateCtx *ctx);
 guint32 gst_rtp_packet_rate_ctx_get_max_dropout (RTPPacketRateCtx *ctx, gint32 time_ms);
 guint32 gst_rtp_packet_rate_ctx_get_max_misorder (RTPPacketRateCtx *ctx, gint32 time_ms);
+guint32 gst_rtp_packet_rate_ctx_update_list (RTPPacketRateCtx *ctx, RTPPacketRateEntry *entries,
+                                             guint n_entries, gint32 dropout_ms, gint32 misorder_ms);
 
 /**
  * RTPSessionStats:
@@ -20,7 +20,7 @@ mod appsrc;
 mod audiotestsrc;
 pub mod dataqueue;
 mod inputselector;
-mod jitterbuffer;
+pub mod jitterbuffer;
 mod proxy;
 mod queue;
 pub mod socket;
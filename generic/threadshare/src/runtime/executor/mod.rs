@@ -42,6 +42,8 @@ pub use task::{SubTaskOutput, TaskId};
 
 pub mod timer;
 
+pub mod timer_wheel;
+
 struct CallOnDrop<F: FnOnce()>(Option<F>);
 
 impl<F: FnOnce()> CallOnDrop<F> {
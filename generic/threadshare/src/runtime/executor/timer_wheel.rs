@@ -0,0 +1,609 @@
+// Take a look at the license at the top of the repository in the LICENSE file.
+
+//! A hierarchical timer wheel shared by the elements running on a [`Context`].
+//!
+//! Elements which compute a new deadline after each processed item, such as jitterbuffers,
+//! would otherwise each register their own timer with the reactor. When hundreds of such
+//! elements share a [`Context`], their timers fire a few microseconds apart and each of them
+//! wakes up a single task.
+//!
+//! With a [`TimerWheel`], deadlines are rounded up to the granularity of the wheel. A single
+//! reactor timer is armed for the earliest deadline, and all the tasks whose deadline has
+//! passed are woken up at once when it fires.
+
+use futures::prelude::*;
+
+use once_cell::sync::Lazy;
+
+use slab::Slab;
+
+use std::collections::HashMap;
+use std::mem;
+use std::pin::Pin;
+use std::sync::{Arc, Mutex, Weak};
+use std::task::{Context as TaskContext, Poll, Waker};
+use std::time::{Duration, Instant};
+
+use super::context::ContextWeak;
+use super::{timer, Context};
+use crate::runtime::RUNTIME_CAT;
+
+const SLOT_BITS: u32 = 6;
+const SLOTS: usize = 1 << SLOT_BITS;
+const LEVELS: usize = 6;
+
+// Ticks covered by one slot of the top level
+const TOP_SLOT_TICKS: u64 = 1 << (SLOT_BITS * (LEVELS as u32 - 1));
+// Entries further in the future are first placed at this distance, which keeps them in a
+// different top level slot than the current one. They move down once the wheel gets there.
+const MAX_TICKS: u64 = TOP_SLOT_TICKS * (SLOTS as u64 - 1) - 1;
+
+// Wheels by `Context` name
+static WHEELS: Lazy<Mutex<HashMap<Arc<str>, Weak<Shared>>>> =
+    Lazy::new(|| Mutex::new(HashMap::new()));
+
+/// Identifies an entry of a [`Wheel`].
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct EntryKey {
+    index: usize,
+    // Slab indices are reused, this tells entries at the same index apart
+    id: u64,
+}
+
+#[derive(Debug)]
+struct Entry<T> {
+    id: u64,
+    deadline: u64,
+    level: usize,
+    slot: usize,
+    // Position in the slot
+    pos: usize,
+    value: T,
+}
+
+/// A hierarchical timer wheel with a fixed granularity.
+///
+/// Level `n` consists of 64 slots of 64^n ticks each. Entries are placed in the lowest level
+/// which can hold their deadline and move down as the time gets closer to it. Inserting and
+/// removing an entry doesn't depend on the number of entries, and advancing the wheel only
+/// visits the slots which hold entries.
+#[derive(Debug)]
+pub struct Wheel<T> {
+    start: Instant,
+    granularity: u64,
+    // Ticks since `start` up to which the wheel has been processed
+    elapsed: u64,
+    next_id: u64,
+    entries: Slab<Entry<T>>,
+    // `LEVELS` levels of `SLOTS` slots
+    slots: Vec<Vec<usize>>,
+    // Non-empty slots by level
+    occupied: [u64; LEVELS],
+}
+
+impl<T> Wheel<T> {
+    pub fn new(granularity: Duration) -> Self {
+        assert!(!granularity.is_zero());
+
+        Wheel {
+            start: Instant::now(),
+            granularity: granularity.as_nanos() as u64,
+            elapsed: 0,
+            next_id: 0,
+            entries: Slab::new(),
+            slots: (0..LEVELS * SLOTS).map(|_| Vec::new()).collect(),
+            occupied: [0; LEVELS],
+        }
+    }
+
+    pub fn granularity(&self) -> Duration {
+        Duration::from_nanos(self.granularity)
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    fn tick_ceil(&self, when: Instant) -> u64 {
+        let elapsed = when.saturating_duration_since(self.start).as_nanos();
+        let granularity = self.granularity as u128;
+        ((elapsed + granularity - 1) / granularity) as u64
+    }
+
+    fn tick_floor(&self, now: Instant) -> u64 {
+        (now.saturating_duration_since(self.start).as_nanos() / self.granularity as u128) as u64
+    }
+
+    fn tick_instant(&self, tick: u64) -> Instant {
+        self.start + Duration::from_nanos(tick.saturating_mul(self.granularity))
+    }
+
+    /// Inserts `value`, to be returned by [`Self::advance`] no sooner than `when`.
+    pub fn insert(&mut self, when: Instant, value: T) -> EntryKey {
+        let id = self.next_id;
+        self.next_id += 1;
+
+        let index = self.entries.insert(Entry {
+            id,
+            deadline: self.tick_ceil(when).max(self.elapsed),
+            level: 0,
+            slot: 0,
+            pos: 0,
+            value,
+        });
+        self.place(index);
+
+        EntryKey { index, id }
+    }
+
+    /// Removes the entry for `key`, unless it has already expired.
+    pub fn remove(&mut self, key: EntryKey) -> Option<T> {
+        if self.entries.get(key.index)?.id != key.id {
+            return None;
+        }
+
+        self.unplace(key.index);
+        Some(self.entries.remove(key.index).value)
+    }
+
+    /// Returns the value for `key`, unless it has already expired.
+    pub fn get_mut(&mut self, key: EntryKey) -> Option<&mut T> {
+        self.entries
+            .get_mut(key.index)
+            .filter(|entry| entry.id == key.id)
+            .map(|entry| &mut entry.value)
+    }
+
+    /// Returns the instant at which the wheel needs to be advanced next.
+    ///
+    /// This can be earlier than the next deadline when its entry needs to move to
+    /// a lower level first.
+    pub fn next_expiration(&self) -> Option<Instant> {
+        self.next_slot().map(|(_, _, tick)| self.tick_instant(tick))
+    }
+
+    /// Moves the values of all the entries which expired at `now` to `expired`.
+    pub fn advance(&mut self, now: Instant, expired: &mut Vec<T>) {
+        let now_tick = self.tick_floor(now);
+
+        while let Some((level, slot, tick)) = self.next_slot() {
+            if tick > now_tick {
+                break;
+            }
+
+            self.elapsed = tick;
+            self.occupied[level] &= !(1 << slot);
+            let mut indices = mem::take(&mut self.slots[level * SLOTS + slot]);
+            for index in indices.drain(..) {
+                if self.entries[index].deadline <= tick {
+                    expired.push(self.entries.remove(index).value);
+                } else {
+                    // Cascade to a lower level
+                    self.place(index);
+                }
+            }
+            // Keep the allocation
+            self.slots[level * SLOTS + slot] = indices;
+        }
+
+        self.elapsed = self.elapsed.max(now_tick);
+    }
+
+    // Returns the level, slot and first tick of the earliest non-empty slot.
+    //
+    // Entries of a level expire before those of the levels above, the earliest
+    // slot is then the first non-empty one of the lowest non-empty level.
+    fn next_slot(&self) -> Option<(usize, usize, u64)> {
+        let level = self.occupied.iter().position(|occupied| *occupied != 0)?;
+
+        let shift = SLOT_BITS * level as u32;
+        let cur_slot = (self.elapsed >> shift) & (SLOTS as u64 - 1);
+        let distance = self.occupied[level]
+            .rotate_right(cur_slot as u32)
+            .trailing_zeros() as u64;
+
+        // Also accounts for top level slots in the next rotation
+        let level_start = self.elapsed & !((1u64 << (shift + SLOT_BITS)) - 1);
+        let tick = level_start + ((cur_slot + distance) << shift);
+
+        Some((level, ((cur_slot + distance) as usize) & (SLOTS - 1), tick))
+    }
+
+    fn place(&mut self, index: usize) {
+        let target = self.entries[index]
+            .deadline
+            .min(self.elapsed.saturating_add(MAX_TICKS));
+
+        // The highest group of bits in which the target differs from the elapsed ticks
+        let significant = 63 - ((self.elapsed ^ target) | (SLOTS as u64 - 1)).leading_zeros();
+        let level = ((significant / SLOT_BITS) as usize).min(LEVELS - 1);
+        let slot = ((target >> (SLOT_BITS * level as u32)) as usize) & (SLOTS - 1);
+
+        let slot_entries = &mut self.slots[level * SLOTS + slot];
+        let entry = &mut self.entries[index];
+        entry.level = level;
+        entry.slot = slot;
+        entry.pos = slot_entries.len();
+        slot_entries.push(index);
+        self.occupied[level] |= 1 << slot;
+    }
+
+    fn unplace(&mut self, index: usize) {
+        let (level, slot, pos) = {
+            let entry = &self.entries[index];
+            (entry.level, entry.slot, entry.pos)
+        };
+
+        let slot_entries = &mut self.slots[level * SLOTS + slot];
+        slot_entries.swap_remove(pos);
+        if let Some(&moved) = slot_entries.get(pos) {
+            self.entries[moved].pos = pos;
+        } else if slot_entries.is_empty() {
+            self.occupied[level] &= !(1 << slot);
+        }
+    }
+}
+
+#[derive(Debug)]
+struct Inner {
+    wheel: Wheel<Waker>,
+    // Next expiration the driver is waiting for
+    armed: Option<Instant>,
+    driver: Option<Waker>,
+}
+
+#[derive(Debug)]
+struct Shared {
+    context: ContextWeak,
+    inner: Mutex<Inner>,
+}
+
+impl Drop for Shared {
+    fn drop(&mut self) {
+        // Let the driver terminate
+        if let Some(driver) = self.inner.get_mut().unwrap().driver.take() {
+            driver.wake();
+        }
+    }
+}
+
+/// The [`Wheel`] of a [`Context`], see the [module documentation](self).
+#[derive(Clone, Debug)]
+pub struct TimerWheel(Arc<Shared>);
+
+impl TimerWheel {
+    /// Returns the wheel of `context`, creating it with `granularity` if needed.
+    ///
+    /// The granularity of an existing wheel is left unchanged.
+    pub fn acquire(context: &Context, granularity: Duration) -> Self {
+        let mut wheels = WHEELS.lock().unwrap();
+
+        if let Some(shared) = wheels.get(context.name()).and_then(Weak::upgrade) {
+            if shared.context.upgrade().as_ref() == Some(context) {
+                gst::debug!(
+                    RUNTIME_CAT,
+                    "Joining timer wheel of Context '{}'",
+                    context.name()
+                );
+                return TimerWheel(shared);
+            }
+        }
+
+        let shared = Arc::new(Shared {
+            context: context.downgrade(),
+            inner: Mutex::new(Inner {
+                wheel: Wheel::new(granularity),
+                armed: None,
+                driver: None,
+            }),
+        });
+
+        wheels.retain(|_, shared| shared.strong_count() > 0);
+        wheels.insert(context.name().into(), Arc::downgrade(&shared));
+
+        context.spawn_and_unpark(Driver {
+            shared: Arc::downgrade(&shared),
+            timer: None,
+            expired: Vec::new(),
+        });
+
+        gst::debug!(
+            RUNTIME_CAT,
+            "New timer wheel for Context '{}' with granularity {:?}",
+            context.name(),
+            granularity,
+        );
+
+        TimerWheel(shared)
+    }
+
+    pub fn granularity(&self) -> Duration {
+        self.0.inner.lock().unwrap().wheel.granularity()
+    }
+
+    /// Creates a timer that emits an event once no sooner than the given time instant.
+    ///
+    /// The event is emitted at the first tick of the wheel after `when`.
+    pub fn after(&self, when: Instant) -> Deadline {
+        Deadline {
+            wheel: self.clone(),
+            when,
+            key: None,
+        }
+    }
+
+    /// Creates a timer that emits an event once after at least the given delay.
+    ///
+    /// See [`Self::after`] for details.
+    pub fn delay_for_at_least(&self, delay: Duration) -> Deadline {
+        self.after(Instant::now() + delay)
+    }
+}
+
+/// A future that resolves at the first tick of a [`TimerWheel`] after the given instant.
+#[derive(Debug)]
+pub struct Deadline {
+    wheel: TimerWheel,
+    when: Instant,
+    key: Option<EntryKey>,
+}
+
+impl Future for Deadline {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut TaskContext<'_>) -> Poll<Self::Output> {
+        let this = &mut *self;
+
+        let mut inner = this.wheel.0.inner.lock().unwrap();
+
+        if Instant::now() >= this.when {
+            if let Some(key) = this.key.take() {
+                inner.wheel.remove(key);
+            }
+
+            return Poll::Ready(());
+        }
+
+        match this.key.and_then(|key| inner.wheel.get_mut(key)) {
+            Some(waker) => {
+                if !waker.will_wake(cx.waker()) {
+                    *waker = cx.waker().clone();
+                }
+            }
+            None => {
+                this.key = Some(inner.wheel.insert(this.when, cx.waker().clone()));
+
+                // Rearm the driver if this is the earliest deadline
+                let next = inner.wheel.next_expiration();
+                if next != inner.armed {
+                    inner.armed = next;
+                    if let Some(driver) = inner.driver.as_ref() {
+                        driver.wake_by_ref();
+                    }
+                }
+            }
+        }
+
+        Poll::Pending
+    }
+}
+
+impl Drop for Deadline {
+    fn drop(&mut self) {
+        if let Some(key) = self.key.take() {
+            self.wheel.0.inner.lock().unwrap().wheel.remove(key);
+        }
+    }
+}
+
+// Runs on the `Context` and wakes up the tasks whose deadline has passed
+struct Driver {
+    shared: Weak<Shared>,
+    timer: Option<(Instant, timer::OneshotAfter)>,
+    expired: Vec<Waker>,
+}
+
+impl Future for Driver {
+    type Output = ();
+
+    fn poll(mut self: Pin<&mut Self>, cx: &mut TaskContext<'_>) -> Poll<Self::Output> {
+        let shared = match self.shared.upgrade() {
+            Some(shared) => shared,
+            None => return Poll::Ready(()),
+        };
+
+        loop {
+            let this = &mut *self;
+
+            {
+                let mut inner = shared.inner.lock().unwrap();
+
+                inner.wheel.advance(Instant::now(), &mut this.expired);
+
+                let next = inner.wheel.next_expiration();
+                if this.timer.as_ref().map(|(when, _)| *when) != next {
+                    this.timer = next.map(|when| (when, timer::after(when)));
+                }
+                inner.armed = next;
+
+                let same_driver = inner
+                    .driver
+                    .as_ref()
+                    .map_or(false, |driver| driver.will_wake(cx.waker()));
+                if !same_driver {
+                    inner.driver = Some(cx.waker().clone());
+                }
+            }
+
+            if !this.expired.is_empty() {
+                gst::trace!(
+                    RUNTIME_CAT,
+                    "timer wheel: {} expired deadlines",
+                    this.expired.len()
+                );
+
+                for waker in this.expired.drain(..) {
+                    waker.wake();
+                }
+            }
+
+            let fired = match this.timer {
+                Some((_, ref mut timer)) => timer.poll_unpin(cx).is_ready(),
+                None => false,
+            };
+            if !fired {
+                return Poll::Pending;
+            }
+
+            this.timer = None;
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use std::time::{Duration, Instant};
+
+    use super::{TimerWheel, Wheel, MAX_TICKS};
+    use crate::runtime::Context;
+
+    const GRANULARITY: Duration = Duration::from_millis(1);
+
+    fn at(wheel: &Wheel<u32>, ms: u64) -> Instant {
+        wheel.start + Duration::from_millis(ms)
+    }
+
+    #[test]
+    fn wheel_expires_in_order() {
+        let mut wheel = Wheel::new(GRANULARITY);
+        // Spread over several levels
+        let deadlines = [3u64, 70, 2, 64, 5000, 63, 300_000, 4096, 1];
+        for (i, ms) in deadlines.iter().enumerate() {
+            wheel.insert(at(&wheel, *ms), i as u32);
+        }
+        assert_eq!(wheel.len(), deadlines.len());
+
+        let mut sorted = deadlines.to_vec();
+        sorted.sort_unstable();
+
+        let mut expired = Vec::new();
+        for (n_expired, ms) in sorted.into_iter().enumerate() {
+            assert!(wheel.next_expiration().unwrap() <= at(&wheel, ms));
+
+            wheel.advance(at(&wheel, ms) - Duration::from_micros(1), &mut expired);
+            assert_eq!(expired.len(), n_expired);
+            // Moved down to the lowest level
+            assert_eq!(wheel.next_expiration(), Some(at(&wheel, ms)));
+
+            wheel.advance(at(&wheel, ms), &mut expired);
+            assert_eq!(expired.len(), n_expired + 1);
+            assert_eq!(deadlines[expired[n_expired] as usize], ms);
+        }
+
+        assert!(wheel.is_empty());
+        assert_eq!(wheel.next_expiration(), None);
+    }
+
+    #[test]
+    fn wheel_rounds_up() {
+        let mut wheel = Wheel::new(Duration::from_millis(10));
+        wheel.insert(at(&wheel, 11), 0);
+        assert_eq!(wheel.next_expiration(), Some(at(&wheel, 20)));
+
+        let mut expired = Vec::new();
+        wheel.advance(at(&wheel, 19), &mut expired);
+        assert!(expired.is_empty());
+        wheel.advance(at(&wheel, 25), &mut expired);
+        assert_eq!(expired, [0]);
+
+        // Deadlines in the past expire at the next advance
+        wheel.insert(at(&wheel, 5), 1);
+        wheel.advance(at(&wheel, 25), &mut expired);
+        assert_eq!(expired, [0, 1]);
+    }
+
+    #[test]
+    fn wheel_remove() {
+        let mut wheel = Wheel::new(GRANULARITY);
+        let first = wheel.insert(at(&wheel, 10), 0);
+        let second = wheel.insert(at(&wheel, 10), 1);
+        let third = wheel.insert(at(&wheel, 10), 2);
+
+        assert_eq!(wheel.remove(first), Some(0));
+        assert_eq!(wheel.remove(first), None);
+        *wheel.get_mut(third).unwrap() = 3;
+
+        let mut expired = Vec::new();
+        wheel.advance(at(&wheel, 10), &mut expired);
+        expired.sort_unstable();
+        assert_eq!(expired, [1, 3]);
+
+        // Expired keys don't match the entries which reuse their index
+        let fourth = wheel.insert(at(&wheel, 20), 4);
+        assert_eq!(wheel.get_mut(second), None);
+        assert_eq!(wheel.remove(third), None);
+        assert_eq!(wheel.remove(fourth), Some(4));
+        assert!(wheel.is_empty());
+    }
+
+    #[test]
+    fn wheel_far_deadlines() {
+        let mut wheel = Wheel::new(Duration::from_nanos(1));
+        let far = Duration::from_nanos(MAX_TICKS * 3);
+        wheel.insert(wheel.start + far, 0);
+
+        let mut expired = Vec::new();
+        let mut advances = 0;
+        while let Some(next) = wheel.next_expiration() {
+            assert!(next <= wheel.start + far);
+            wheel.advance(next, &mut expired);
+            advances += 1;
+        }
+
+        assert_eq!(expired, [0]);
+        assert!(advances < 64);
+    }
+
+    #[test]
+    fn deadlines() {
+        gst::init().unwrap();
+
+        const DELAYS_MS: [u64; 4] = [30, 5, 20, 12];
+
+        let context = Context::acquire("timer_wheel_deadlines", Duration::from_millis(2)).unwrap();
+        let wheel = TimerWheel::acquire(&context, GRANULARITY);
+        assert_eq!(
+            TimerWheel::acquire(&context, Duration::from_millis(10)).granularity(),
+            GRANULARITY
+        );
+
+        let handles = DELAYS_MS
+            .iter()
+            .map(|delay_ms| {
+                let wheel = wheel.clone();
+                context.spawn(async move {
+                    let delay = Duration::from_millis(*delay_ms);
+                    let start = Instant::now();
+                    wheel.delay_for_at_least(delay).await;
+                    // Never returns earlier than the delay
+                    assert!(start.elapsed() >= delay);
+                })
+            })
+            .collect::<Vec<_>>();
+
+        // A cancelled deadline doesn't prevent the others from firing
+        let cancelled = context.spawn({
+            let wheel = wheel.clone();
+            async move { wheel.delay_for_at_least(Duration::from_millis(1)).await }
+        });
+        cancelled.cancel();
+
+        for handle in handles {
+            futures::executor::block_on(handle).unwrap();
+        }
+    }
+}
@@ -31,7 +31,7 @@
 //! [`PadSink`]: pad/struct.PadSink.html
 
 pub mod executor;
-pub use executor::{timer, Async, Context, JoinHandle, SubTaskOutput};
+pub use executor::{timer, timer_wheel, Async, Context, JoinHandle, SubTaskOutput};
 
 pub mod pad;
 pub use pad::{PadSink, PadSinkRef, PadSinkWeak, PadSrc, PadSrcRef, PadSrcWeak};
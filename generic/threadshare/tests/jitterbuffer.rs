@@ -19,7 +19,7 @@
 
 use gst::prelude::*;
 
-use std::sync::mpsc;
+use std::sync::{mpsc, Mutex};
 
 use once_cell::sync::Lazy;
 
@@ -220,3 +220,404 @@ fn jb_ts_pipeline() {
 
     pipeline.set_state(gst::State::Null).unwrap();
 }
+
+const PCMA_SSRC: u32 = 0x1234_5678;
+const PCMA_PACKET_DURATION: gst::ClockTime = gst::ClockTime::from_mseconds(20);
+
+// A 20 ms PCMA packet, with a dts matching its seqnum
+fn pcma_packet(seq: u16) -> gst::Buffer {
+    use gst_rtp::prelude::*;
+    use gst_rtp::RTPBuffer;
+
+    let mut buffer = gst::Buffer::new_rtp_with_sizes(160, 0, 0).unwrap();
+    {
+        let buffer = buffer.get_mut().unwrap();
+        buffer.set_dts(PCMA_PACKET_DURATION * seq as u64);
+        let mut rtp_buffer = RTPBuffer::from_buffer_writable(buffer).unwrap();
+        rtp_buffer.set_payload_type(8);
+        rtp_buffer.set_ssrc(PCMA_SSRC);
+        rtp_buffer.set_seq(seq);
+        rtp_buffer.set_timestamp(seq as u32 * 160);
+    }
+
+    buffer
+}
+
+// appsrc ! ts-jitterbuffer ! appsink, with PCMA caps on the appsrc
+struct PcmaPipeline {
+    pipeline: gst::Pipeline,
+    src: gst_app::AppSrc,
+    jb: gst::Element,
+    sink: gst_app::AppSink,
+    // The seqnums of the buffers reaching the appsink
+    seqnums: mpsc::Receiver<u16>,
+}
+
+impl PcmaPipeline {
+    // The jitterbuffer runs on a context named after the test, with the given properties
+    fn new(context: &str, properties: &[(&str, &str)]) -> Self {
+        use gst_rtp::RTPBuffer;
+
+        let pipeline = gst::Pipeline::default();
+
+        let src = gst_app::AppSrc::builder()
+            .name("appsrc")
+            .is_live(true)
+            .format(gst::Format::Time)
+            .caps(
+                &gst::Caps::builder("application/x-rtp")
+                    .field("media", "audio")
+                    .field("payload", 8i32)
+                    .field("clock-rate", 8000i32)
+                    .field("encoding-name", "PCMA")
+                    .build(),
+            )
+            .build();
+
+        let jb = gst::ElementFactory::make("ts-jitterbuffer")
+            .name("ts-jitterbuffer")
+            .property("context", context)
+            .build()
+            .unwrap();
+        for (name, value) in properties {
+            jb.set_property_from_str(name, value);
+        }
+
+        let sink = gst_app::AppSink::builder()
+            .name("appsink")
+            .sync(false)
+            .async_(false)
+            .build();
+
+        pipeline
+            .add_many(&[src.upcast_ref(), &jb, sink.upcast_ref()])
+            .unwrap();
+        gst::Element::link_many(&[src.upcast_ref(), &jb, sink.upcast_ref()]).unwrap();
+
+        let (sender, seqnums) = mpsc::channel();
+        sink.set_callbacks(
+            gst_app::AppSinkCallbacks::builder()
+                .new_sample(move |appsink| {
+                    let sample = appsink.pull_sample().unwrap();
+                    let buffer = sample.buffer().unwrap();
+                    let seq = RTPBuffer::from_buffer_readable(buffer).unwrap().seq();
+
+                    let _ = sender.send(seq);
+                    Ok(gst::FlowSuccess::Ok)
+                })
+                .build(),
+        );
+
+        PcmaPipeline {
+            pipeline,
+            src,
+            jb,
+            sink,
+            seqnums,
+        }
+    }
+
+    fn play(&self) {
+        self.pipeline.set_state(gst::State::Playing).unwrap();
+    }
+
+    fn push(&self, seq: u16) {
+        self.src.push_buffer(pcma_packet(seq)).unwrap();
+    }
+}
+
+impl Drop for PcmaPipeline {
+    fn drop(&mut self) {
+        self.pipeline.set_state(gst::State::Null).unwrap();
+    }
+}
+
+#[test]
+fn jb_buffer_list() {
+    init();
+
+    const BUFFER_NB: u16 = 10;
+
+    let p = PcmaPipeline::new(
+        "jb_buffer_list",
+        &[("context-wait", "20"), ("latency", "20")],
+    );
+    p.play();
+
+    // Send the packets in a single list, swapped two by two
+    let mut list = gst::BufferList::new_sized(BUFFER_NB as usize);
+    {
+        let list = list.get_mut().unwrap();
+        for idx in 0..BUFFER_NB {
+            list.add(pcma_packet(idx ^ 1));
+        }
+    }
+    p.src.push_buffer_list(list).unwrap();
+
+    gst::debug!(CAT, "jb_buffer_list: waiting for {} buffers", BUFFER_NB);
+    for idx in 0..BUFFER_NB {
+        let seq = p.seqnums.recv().unwrap();
+        gst::debug!(CAT, "jb_buffer_list: received buffer #{} seq {}", idx, seq);
+        assert_eq!(seq, idx);
+    }
+}
+
+#[test]
+fn jb_coalesce_lost() {
+    init();
+
+    // Two runs of packets with 15 packets lost in between
+    const SEQNUMS: [u16; 10] = [0, 1, 2, 3, 4, 20, 21, 22, 23, 24];
+
+    let p = PcmaPipeline::new(
+        "jb_coalesce_lost",
+        &[
+            ("context-wait", "20"),
+            ("latency", "20"),
+            ("do-lost", "true"),
+            ("coalesce-lost", "true"),
+        ],
+    );
+
+    let (lost_sender, lost_receiver) = mpsc::channel();
+    let lost_sender = Mutex::new(lost_sender);
+    p.sink.static_pad("sink").unwrap().add_probe(
+        gst::PadProbeType::EVENT_DOWNSTREAM,
+        move |_, info| {
+            if let Some(gst::PadProbeData::Event(ref event)) = info.data {
+                if let gst::EventView::CustomDownstream(event) = event.view() {
+                    let s = event.structure().unwrap();
+                    if s.has_name("GstRTPPacketLost") {
+                        lost_sender
+                            .lock()
+                            .unwrap()
+                            .send((
+                                s.get::<u32>("seqnum").unwrap(),
+                                s.get::<u32>("count").unwrap(),
+                            ))
+                            .unwrap();
+                    }
+                }
+            }
+            gst::PadProbeReturn::Ok
+        },
+    );
+
+    p.play();
+
+    for seq in SEQNUMS {
+        p.push(seq);
+    }
+
+    for expected in SEQNUMS {
+        let seq = p.seqnums.recv().unwrap();
+        gst::debug!(CAT, "jb_coalesce_lost: received buffer seq {}", seq);
+        assert_eq!(seq, expected);
+    }
+
+    // Lost events are serialized before the first packet after the gap
+    assert_eq!(lost_receiver.try_iter().collect::<Vec<_>>(), [(5, 15)]);
+}
+
+#[test]
+fn jb_adaptive_latency() {
+    init();
+
+    const LATENCY: u64 = 200;
+    const MIN_LATENCY: u64 = 20;
+    // More than 3 s of perfectly paced packets
+    const BUFFER_NB: u16 = 160;
+
+    let p = PcmaPipeline::new(
+        "jb_adaptive_latency",
+        &[
+            ("context-wait", "20"),
+            ("latency", &LATENCY.to_string()),
+            ("min-latency", &MIN_LATENCY.to_string()),
+            ("adaptive-latency", "true"),
+        ],
+    );
+    p.play();
+
+    for seq in 0..BUFFER_NB {
+        p.push(seq);
+    }
+
+    // Without jitter, the latency decreases once per second of packets
+    let bus = p.pipeline.bus().unwrap();
+    let mut n_changes = 0;
+    while n_changes < 3 {
+        let msg = bus
+            .timed_pop_filtered(
+                gst::ClockTime::from_seconds(5),
+                &[gst::MessageType::Latency],
+            )
+            .expect("no latency message");
+        if msg.src().as_ref() == Some(p.jb.upcast_ref()) {
+            n_changes += 1;
+        }
+    }
+
+    let stats = p.jb.property::<gst::Structure>("stats");
+    let latency = gst::ClockTime::from_nseconds(stats.get::<u64>("latency").unwrap());
+    assert!(latency < gst::ClockTime::from_mseconds(LATENCY));
+    assert!(latency >= gst::ClockTime::from_mseconds(MIN_LATENCY));
+}
+
+#[test]
+fn jb_snapshot() {
+    init();
+
+    // More than the 2 s it takes to estimate the skew
+    const BUFFER_NB: u16 = 160;
+
+    let p = PcmaPipeline::new("jb_snapshot", &[("context-wait", "20"), ("latency", "200")]);
+    p.play();
+
+    // Nothing to export before the stream starts
+    assert!(p
+        .jb
+        .emit_by_name::<Option<gst::Structure>>("export-snapshot", &[])
+        .is_none());
+
+    for seq in 0..BUFFER_NB {
+        p.push(seq);
+    }
+
+    for _ in 0..BUFFER_NB / 2 {
+        p.seqnums
+            .recv_timeout(std::time::Duration::from_secs(5))
+            .expect("no sample");
+    }
+
+    let snapshot =
+        p.jb.emit_by_name::<Option<gst::Structure>>("export-snapshot", &[])
+            .expect("no snapshot");
+    assert_eq!(snapshot.name(), "application/x-rtp-jitterbuffer-snapshot");
+    assert_eq!(snapshot.get::<u32>("ssrc").unwrap(), PCMA_SSRC);
+    assert_eq!(snapshot.get::<u32>("clock-rate").unwrap(), 8000);
+    assert!(!snapshot.get::<gst::Array>("window").unwrap().is_empty());
+
+    let warm_jb = gst::ElementFactory::make("ts-jitterbuffer")
+        .build()
+        .unwrap();
+    assert!(warm_jb.emit_by_name::<bool>("import-snapshot", &[&snapshot]));
+    let invalid = gst::Structure::new_empty("application/x-rtp-jitterbuffer-snapshot");
+    assert!(!warm_jb.emit_by_name::<bool>("import-snapshot", &[&invalid]));
+}
+
+#[test]
+fn jb_passthrough() {
+    init();
+
+    const TIMEOUT: std::time::Duration = std::time::Duration::from_millis(500);
+
+    // The latency is way above the time the in-order packets are allowed to take
+    let p = PcmaPipeline::new(
+        "jb_passthrough",
+        &[
+            ("context-wait", "20"),
+            ("latency", "2000"),
+            ("mode", "passthrough"),
+        ],
+    );
+    p.play();
+
+    // In-order packets don't wait for the latency
+    for seq in 0..3 {
+        p.push(seq);
+    }
+    for expected in 0..3 {
+        assert_eq!(p.seqnums.recv_timeout(TIMEOUT).unwrap(), expected);
+    }
+
+    // Packets after a gap are held...
+    p.push(4);
+    p.push(5);
+    assert!(p.seqnums.recv_timeout(TIMEOUT).is_err());
+
+    // ... until the missing packet arrives
+    p.push(3);
+    for expected in 3..6 {
+        assert_eq!(p.seqnums.recv_timeout(TIMEOUT).unwrap(), expected);
+    }
+}
+
+#[test]
+fn jb_passthrough_while_playing() {
+    init();
+
+    const TIMEOUT: std::time::Duration = std::time::Duration::from_millis(500);
+
+    let p = PcmaPipeline::new(
+        "jb_passthrough_while_playing",
+        &[("context-wait", "20"), ("latency", "2000")],
+    );
+    p.play();
+
+    // The packets wait for the latency in slave mode...
+    for seq in 0..3 {
+        p.push(seq);
+    }
+    assert!(p.seqnums.recv_timeout(TIMEOUT).is_err());
+
+    // ... and are pushed as soon as the mode changes
+    p.jb.set_property_from_str("mode", "passthrough");
+    for expected in 0..3 {
+        assert_eq!(p.seqnums.recv_timeout(TIMEOUT).unwrap(), expected);
+    }
+}
+
+// Returns the seqnums pushed out of a queue limited to 4 packets, when 12 of
+// them arrive at once with keyframes at seqnums 0, 3 and 10
+fn jb_drop_policy_run(policy: &str) -> Vec<u16> {
+    const TIMEOUT: std::time::Duration = std::time::Duration::from_secs(5);
+    const KEYFRAMES: [u16; 3] = [0, 3, 10];
+
+    let packet_size = pcma_packet(0).size();
+    let p = PcmaPipeline::new(
+        &format!("jb_drop_policy_{}", policy),
+        &[
+            ("context-wait", "20"),
+            ("latency", "1000"),
+            ("max-size-bytes", &(4 * packet_size).to_string()),
+            ("max-size-time", "0"),
+            ("drop-policy", policy),
+        ],
+    );
+    p.play();
+
+    for seq in 0..12 {
+        let mut buffer = pcma_packet(seq);
+        if !KEYFRAMES.contains(&seq) {
+            buffer
+                .get_mut()
+                .unwrap()
+                .set_flags(gst::BufferFlags::DELTA_UNIT);
+        }
+        p.src.push_buffer(buffer).unwrap();
+    }
+
+    let mut seqnums = Vec::new();
+    while let Ok(seq) = p.seqnums.recv_timeout(TIMEOUT) {
+        seqnums.push(seq);
+        if seq == 11 {
+            break;
+        }
+    }
+
+    seqnums
+}
+
+#[test]
+fn jb_drop_policy() {
+    init();
+
+    // The last 4 packets fit
+    assert_eq!(jb_drop_policy_run("drop-oldest"), [8, 9, 10, 11]);
+
+    // Queueing 4 drops 0 and the delta units up to 3. Queueing 7 drops the
+    // keyframe 3 and everything after it, so the delta units 8 and 9 can't be
+    // decoded either and no packet is pushed before the keyframe 10
+    assert_eq!(jb_drop_policy_run("drop-until-keyframe"), [10, 11]);
+}
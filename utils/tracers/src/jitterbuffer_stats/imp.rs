@@ -0,0 +1,372 @@
+// This Source Code Form is subject to the terms of the Mozilla Public License, v2.0.
+// If a copy of the MPL was not distributed with this file, You can obtain one at
+// <https://mozilla.org/MPL/2.0/>.
+//
+// SPDX-License-Identifier: MPL-2.0
+
+/**
+ * tracer-jitterbuffer-stats:
+ *
+ * This tracer collects the statistics of all `ts-jitterbuffer` elements inside a pipeline
+ * over time, every time they push downstream.
+ *
+ * Example:
+ *
+ * ```console
+ * $ GST_TRACERS='jitterbuffer-stats(file="/tmp/jitterbuffer_stats.log")' gst-launch-1.0 udpsrc ! application/x-rtp,clock-rate=8000 ! ts-jitterbuffer ! fakesink
+ * ```
+ *
+ * The generated file is a CSV file of the format
+ *
+ * ```csv
+ * timestamp,element name,element pointer,num-pushed,num-lost,num-late,num-resyncs,num-skew-resets,skew,window-min,lock-hold-max,insert-walk,reorder-distance,queue-depth,lock-hold-us
+ * ```
+ *
+ * The fields from `num-resyncs` on are only filled when the threadshare plugin is built
+ * with the `tuning` feature. The last four fields are histograms with power of two
+ * buckets, their bucket counts are separated by `;`.
+ *
+ * ## Parameters
+ *
+ * ### `file`
+ *
+ * Specifies the path to the file that will collect the CSV file with the statistics.
+ *
+ * By default the file is written to `/tmp/jitterbuffer_stats.log`.
+ *
+ * ### `include-filter`
+ *
+ * Specifies a regular expression for the jitterbuffer object names that should be included.
+ *
+ * By default this is not set.
+ *
+ * ### `exclude-filter`
+ *
+ * Specifies a regular expression for the jitterbuffer object names that should **not** be
+ * included.
+ *
+ * By default this is not set.
+ */
+use std::collections::HashMap;
+use std::path::PathBuf;
+use std::str::FromStr;
+use std::sync::{Arc, Mutex};
+
+use gst::glib;
+use gst::prelude::*;
+use gst::subclass::prelude::*;
+use once_cell::sync::Lazy;
+use regex::Regex;
+
+static CAT: Lazy<gst::DebugCategory> = Lazy::new(|| {
+    gst::DebugCategory::new(
+        "jitterbuffer-stats",
+        gst::DebugColorFlags::empty(),
+        Some("Tracer to collect jitterbuffer statistics"),
+    )
+});
+
+static JITTERBUFFER_TYPE: Lazy<glib::Type> = Lazy::new(|| {
+    if let Some(jitterbuffer) =
+        gst::ElementFactory::find("ts-jitterbuffer").and_then(|f| f.load().ok())
+    {
+        jitterbuffer.element_type()
+    } else {
+        gst::warning!(CAT, "Can't instantiate ts-jitterbuffer element");
+        glib::Type::INVALID
+    }
+});
+
+fn is_jitterbuffer_type(type_: glib::Type) -> bool {
+    type_ == *JITTERBUFFER_TYPE
+}
+
+#[derive(Debug)]
+struct Settings {
+    file: PathBuf,
+    include_filter: Option<Regex>,
+    exclude_filter: Option<Regex>,
+}
+
+impl Default for Settings {
+    fn default() -> Self {
+        let mut file = glib::tmp_dir();
+        file.push("jitterbuffer_stats.log");
+
+        Self {
+            file,
+            include_filter: None,
+            exclude_filter: None,
+        }
+    }
+}
+
+impl Settings {
+    fn update_from_params(&mut self, imp: &JitterBufferStats, params: String) {
+        let s = match gst::Structure::from_str(&format!("jitterbuffer-stats,{}", params)) {
+            Ok(s) => s,
+            Err(err) => {
+                gst::warning!(CAT, imp: imp, "failed to parse tracer parameters: {}", err);
+                return;
+            }
+        };
+
+        if let Ok(file) = s.get::<&str>("file") {
+            gst::log!(CAT, imp: imp, "file= {}", file);
+            self.file = PathBuf::from(file);
+        }
+
+        if let Ok(filter) = s.get::<&str>("include-filter") {
+            gst::log!(CAT, imp: imp, "include filter= {}", filter);
+            let filter = match Regex::new(filter) {
+                Ok(filter) => Some(filter),
+                Err(err) => {
+                    gst::error!(
+                        CAT,
+                        imp: imp,
+                        "Failed to compile include-filter regex: {}",
+                        err
+                    );
+                    None
+                }
+            };
+            self.include_filter = filter;
+        }
+
+        if let Ok(filter) = s.get::<&str>("exclude-filter") {
+            gst::log!(CAT, imp: imp, "exclude filter= {}", filter);
+            let filter = match Regex::new(filter) {
+                Ok(filter) => Some(filter),
+                Err(err) => {
+                    gst::error!(
+                        CAT,
+                        imp: imp,
+                        "Failed to compile exclude-filter regex: {}",
+                        err
+                    );
+                    None
+                }
+            };
+            self.exclude_filter = filter;
+        }
+    }
+}
+
+#[derive(Default)]
+struct State {
+    jitterbuffers: HashMap<usize, Arc<glib::GString>>,
+    log: Vec<LogLine>,
+    settings: Settings,
+}
+
+struct LogLine {
+    timestamp: u64,
+    name: Arc<glib::GString>,
+    ptr: usize,
+    stats: gst::Structure,
+}
+
+#[derive(Default)]
+pub struct JitterBufferStats {
+    state: Mutex<State>,
+}
+
+#[glib::object_subclass]
+impl ObjectSubclass for JitterBufferStats {
+    const NAME: &'static str = "GstJitterBufferStats";
+    type Type = super::JitterBufferStats;
+    type ParentType = gst::Tracer;
+}
+
+// Formats an optional field of the stats, empty if it's missing
+fn format_field<T: for<'a> glib::value::FromValue<'a> + std::fmt::Display + 'static>(
+    stats: &gst::StructureRef,
+    field: &str,
+) -> String {
+    stats
+        .get::<T>(field)
+        .map(|value| value.to_string())
+        .unwrap_or_default()
+}
+
+fn format_histogram(stats: &gst::StructureRef, field: &str) -> String {
+    stats
+        .get::<gst::Array>(field)
+        .map(|histogram| {
+            histogram
+                .iter()
+                .filter_map(|count| count.get::<u64>().ok())
+                .map(|count| count.to_string())
+                .collect::<Vec<_>>()
+                .join(";")
+        })
+        .unwrap_or_default()
+}
+
+impl ObjectImpl for JitterBufferStats {
+    fn constructed(&self) {
+        self.parent_constructed();
+
+        if let Some(params) = self.obj().property::<Option<String>>("params") {
+            let mut state = self.state.lock().unwrap();
+            state.settings.update_from_params(self, params);
+        }
+
+        Lazy::force(&JITTERBUFFER_TYPE);
+
+        self.register_hook(TracerHook::ElementNew);
+        self.register_hook(TracerHook::ObjectDestroyed);
+        self.register_hook(TracerHook::PadPushPre);
+        self.register_hook(TracerHook::PadPushListPre);
+        self.register_hook(TracerHook::ElementChangeStatePost);
+    }
+
+    fn dispose(&self) {
+        use std::io::prelude::*;
+
+        let state = self.state.lock().unwrap();
+
+        let mut file = match std::fs::File::create(&state.settings.file) {
+            Ok(file) => file,
+            Err(err) => {
+                gst::error!(CAT, imp: self, "Failed to create file: {err}");
+                return;
+            }
+        };
+
+        gst::debug!(
+            CAT,
+            imp: self,
+            "Writing file {}",
+            state.settings.file.display()
+        );
+
+        for LogLine {
+            timestamp,
+            name,
+            ptr,
+            stats,
+        } in &state.log
+        {
+            let res = writeln!(
+                &mut file,
+                "{timestamp},{name},0x{ptr:08x},{},{},{},{},{},{},{},{},{},{},{},{}",
+                format_field::<u64>(stats, "num-pushed"),
+                format_field::<u64>(stats, "num-lost"),
+                format_field::<u64>(stats, "num-late"),
+                format_field::<u64>(stats, "num-resyncs"),
+                format_field::<u64>(stats, "num-skew-resets"),
+                format_field::<i64>(stats, "skew"),
+                format_field::<i64>(stats, "window-min"),
+                format_field::<u64>(stats, "lock-hold-max"),
+                format_histogram(stats, "insert-walk"),
+                format_histogram(stats, "reorder-distance"),
+                format_histogram(stats, "queue-depth"),
+                format_histogram(stats, "lock-hold-us"),
+            );
+            if let Err(err) = res {
+                gst::error!(CAT, imp: self, "Failed to write to file: {err}");
+                return;
+            }
+        }
+    }
+}
+
+impl GstObjectImpl for JitterBufferStats {}
+
+impl TracerImpl for JitterBufferStats {
+    fn element_new(&self, _ts: u64, element: &gst::Element) {
+        if !is_jitterbuffer_type(element.type_()) {
+            return;
+        }
+
+        let ptr = element.as_ptr() as usize;
+        gst::debug!(
+            CAT,
+            imp: self,
+            "new jitterbuffer: {} 0x{:08x}",
+            element.name(),
+            ptr
+        );
+
+        let mut state = self.state.lock().unwrap();
+
+        let name = element.name();
+        if let Some(ref filter) = state.settings.include_filter {
+            if !filter.is_match(&name) {
+                return;
+            }
+        }
+        if let Some(ref filter) = state.settings.exclude_filter {
+            if filter.is_match(&name) {
+                return;
+            }
+        }
+
+        state
+            .jitterbuffers
+            .entry(ptr)
+            .or_insert_with(|| Arc::new(name));
+    }
+
+    fn object_destroyed(&self, _ts: u64, object: std::ptr::NonNull<gst::ffi::GstObject>) {
+        let ptr = object.as_ptr() as usize;
+        let mut state = self.state.lock().unwrap();
+        state.jitterbuffers.remove(&ptr);
+    }
+
+    fn pad_push_pre(&self, ts: u64, pad: &gst::Pad, _buffer: &gst::Buffer) {
+        if let Some(parent) = pad.parent().and_then(|p| p.downcast::<gst::Element>().ok()) {
+            if is_jitterbuffer_type(parent.type_()) {
+                self.log(&parent, ts);
+            }
+        }
+    }
+
+    fn pad_push_list_pre(&self, ts: u64, pad: &gst::Pad, _list: &gst::BufferList) {
+        if let Some(parent) = pad.parent().and_then(|p| p.downcast::<gst::Element>().ok()) {
+            if is_jitterbuffer_type(parent.type_()) {
+                self.log(&parent, ts);
+            }
+        }
+    }
+
+    fn element_change_state_post(
+        &self,
+        ts: u64,
+        element: &gst::Element,
+        change: gst::StateChange,
+        _result: Result<gst::StateChangeSuccess, gst::StateChangeError>,
+    ) {
+        if change.next() != gst::State::Null {
+            return;
+        }
+
+        if !is_jitterbuffer_type(element.type_()) {
+            return;
+        }
+
+        self.log(element, ts);
+    }
+}
+
+impl JitterBufferStats {
+    fn log(&self, element: &gst::Element, timestamp: u64) {
+        let ptr = element.as_ptr() as usize;
+
+        let name = match self.state.lock().unwrap().jitterbuffers.get(&ptr) {
+            Some(name) => name.clone(),
+            None => return,
+        };
+
+        // Not holding our state while the jitterbuffer locks its own
+        let stats = element.property::<gst::Structure>("stats");
+
+        self.state.lock().unwrap().log.push(LogLine {
+            timestamp,
+            name,
+            ptr,
+            stats,
+        });
+    }
+}
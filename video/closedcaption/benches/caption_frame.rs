@@ -0,0 +1,290 @@
+// This Source Code Form is subject to the terms of the Mozilla Public License, v2.0.
+// If a copy of the MPL was not distributed with this file, You can obtain one at
+// <https://mozilla.org/MPL/2.0/>.
+//
+// SPDX-License-Identifier: MPL-2.0
+
+// Benchmarks of the C caption core. Decoding is measured in words, the text
+// conversions in captions and the character encoding in characters.
+
+use criterion::{
+    black_box, criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput,
+};
+use std::ffi::{CStr, CString};
+use std::mem;
+
+use gstrsclosedcaption::ffi;
+
+const LINES: [&str; 8] = [
+    "THE QUICK BROWN FOX JUMPS",
+    "over the lazy dog. Again!",
+    "[Music playing]",
+    ">> Whose café is it, José?",
+    "It's mine, it's been mine",
+    "for 25 years, 10 months",
+    "and \"three\" days (or so).",
+    "♪ la la la ♪",
+];
+
+// Enough captions for every stream to be a few thousand words long
+const N_CAPTIONS: usize = 256;
+// The duration of a frame at 29.97 fps, in seconds
+const FRAME_DURATION: f64 = 1001.0 / 30000.0;
+
+#[derive(Clone, Copy, Debug)]
+enum Mode {
+    PopOn,
+    RollUp,
+    PaintOn,
+}
+
+const MODES: [Mode; 3] = [Mode::PopOn, Mode::RollUp, Mode::PaintOn];
+
+impl Mode {
+    fn name(&self) -> &'static str {
+        match self {
+            Mode::PopOn => "pop-on",
+            Mode::RollUp => "roll-up",
+            Mode::PaintOn => "paint-on",
+        }
+    }
+
+    // Returns the words of `N_CAPTIONS` captions of two rows each, sent like
+    // tttocea608 does with every control word doubled
+    fn stream(&self) -> Vec<u16> {
+        let mut words = Vec::new();
+
+        if let Mode::RollUp = self {
+            control(&mut words, ffi::eia608_control_t_eia608_control_roll_up_2);
+        }
+
+        for caption in 0..N_CAPTIONS {
+            match self {
+                Mode::PopOn => {
+                    control(
+                        &mut words,
+                        ffi::eia608_control_t_eia608_control_resume_caption_loading,
+                    );
+                }
+                Mode::PaintOn => {
+                    control(
+                        &mut words,
+                        ffi::eia608_control_t_eia608_control_erase_display_memory,
+                    );
+                    control(
+                        &mut words,
+                        ffi::eia608_control_t_eia608_control_resume_direct_captioning,
+                    );
+                }
+                Mode::RollUp => (),
+            }
+
+            for row in 0..2 {
+                let line = LINES[(2 * caption + row) % LINES.len()];
+                match self {
+                    Mode::RollUp => {
+                        control(
+                            &mut words,
+                            ffi::eia608_control_t_eia608_control_carriage_return,
+                        );
+                        preamble(&mut words, 14, 0);
+                    }
+                    _ => preamble(&mut words, 13 + row as i32, 0),
+                }
+                text(&mut words, line);
+            }
+
+            if let Mode::PopOn = self {
+                control(
+                    &mut words,
+                    ffi::eia608_control_t_eia608_control_end_of_caption,
+                );
+            }
+        }
+
+        words
+    }
+}
+
+fn control(words: &mut Vec<u16>, cmd: ffi::eia608_control_t) {
+    let word = unsafe { ffi::eia608_control_command(cmd, 0) };
+    words.extend([word, word]);
+}
+
+fn preamble(words: &mut Vec<u16>, row: i32, col: i32) {
+    let word = unsafe { ffi::eia608_row_column_pramble(row, col, 0, 0) };
+    words.extend([word, word]);
+}
+
+fn text(words: &mut Vec<u16>, line: &str) {
+    let line = CString::new(line).unwrap();
+    let len = words.len();
+    words.resize(len + 2 * line.as_bytes().len(), 0);
+    let size = unsafe { ffi::eia608_from_utf8_string(line.as_ptr(), 0, words[len..].as_mut_ptr()) };
+    words.truncate(len + size);
+}
+
+fn new_frame() -> Box<ffi::caption_frame_t> {
+    unsafe {
+        let mut frame = Box::new(mem::MaybeUninit::uninit());
+        ffi::caption_frame_init(frame.as_mut_ptr());
+        Box::from_raw(Box::into_raw(frame) as *mut ffi::caption_frame_t)
+    }
+}
+
+// The text of every caption, wrapped by `caption_frame_from_text()` when
+// longer than a row
+fn captions() -> Vec<CString> {
+    (0..N_CAPTIONS)
+        .map(|caption| {
+            let first = LINES[(2 * caption) % LINES.len()];
+            let second = LINES[(2 * caption + 1) % LINES.len()];
+            let separator = if caption % 2 == 0 { "\n" } else { " " };
+            CString::new(format!("{}{}{}", first, separator, second)).unwrap()
+        })
+        .collect()
+}
+
+fn caption_frame_decode(c: &mut Criterion) {
+    let mut group = c.benchmark_group("caption_frame_decode");
+    for mode in MODES {
+        let words = mode.stream();
+        group.throughput(Throughput::Elements(words.len() as u64));
+        group.bench_with_input(
+            BenchmarkId::new("words", mode.name()),
+            &words,
+            |b, words| {
+                b.iter_batched(
+                    new_frame,
+                    |mut frame| {
+                        for (i, word) in words.iter().enumerate() {
+                            black_box(unsafe {
+                                ffi::caption_frame_decode(
+                                    &mut *frame,
+                                    *word,
+                                    i as f64 * FRAME_DURATION,
+                                )
+                            });
+                        }
+                        frame
+                    },
+                    BatchSize::SmallInput,
+                )
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("buffer", mode.name()),
+            &words,
+            |b, words| {
+                let mut events = Vec::with_capacity(words.len());
+                b.iter_batched(
+                    new_frame,
+                    |mut frame| {
+                        unsafe {
+                            let n_events = ffi::caption_frame_decode_buffer(
+                                &mut *frame,
+                                words.as_ptr(),
+                                words.len(),
+                                0.0,
+                                events.as_mut_ptr(),
+                            );
+                            events.set_len(n_events);
+                        }
+                        black_box(&events);
+                        frame
+                    },
+                    BatchSize::SmallInput,
+                )
+            },
+        );
+    }
+    group.finish();
+}
+
+fn caption_frame_to_text(c: &mut Criterion) {
+    let frames = captions()
+        .iter()
+        .map(|caption| {
+            let mut frame = new_frame();
+            unsafe { ffi::caption_frame_from_text(&mut *frame, caption.as_ptr()) };
+            frame
+        })
+        .collect::<Vec<_>>();
+    let mut data = vec![0u8; ffi::CAPTION_FRAME_TEXT_BYTES as usize];
+
+    let mut group = c.benchmark_group("caption_frame_to_text");
+    group.throughput(Throughput::Elements(frames.len() as u64));
+    for full in [false, true] {
+        let name = if full { "full" } else { "trimmed" };
+        group.bench_function(BenchmarkId::new("captions", name), |b| {
+            b.iter(|| {
+                for frame in &frames {
+                    black_box(unsafe {
+                        ffi::caption_frame_to_text(
+                            &**frame as *const _ as *mut _,
+                            data.as_mut_ptr() as *mut _,
+                            i32::from(full),
+                        )
+                    });
+                }
+            })
+        });
+    }
+    group.finish();
+}
+
+fn caption_frame_from_text(c: &mut Criterion) {
+    let captions = captions();
+
+    let mut group = c.benchmark_group("caption_frame_from_text");
+    group.throughput(Throughput::Elements(captions.len() as u64));
+    group.bench_function("captions", |b| {
+        let mut frame = new_frame();
+        b.iter(|| {
+            for caption in &captions {
+                black_box(unsafe { ffi::caption_frame_from_text(&mut *frame, caption.as_ptr()) });
+            }
+        })
+    });
+    group.bench_function("utf8_wrap_length", |b| {
+        b.iter(|| {
+            for caption in &captions {
+                black_box(unsafe {
+                    ffi::utf8_wrap_length(caption.as_ptr(), ffi::SCREEN_COLS as usize)
+                });
+            }
+        })
+    });
+    group.finish();
+}
+
+fn eia608_from_utf8_1(c: &mut Criterion) {
+    // The map also has the empty string of the null character, which encodes
+    // to 0 like any character that is not in it
+    let chars = unsafe { ffi::eia608_char_map }
+        .iter()
+        .map(|c| unsafe { CStr::from_ptr(*c) }.to_owned())
+        .collect::<Vec<_>>();
+
+    let mut group = c.benchmark_group("eia608_from_utf8_1");
+    group.throughput(Throughput::Elements(chars.len() as u64));
+    for chan in 0..2 {
+        group.bench_function(BenchmarkId::new("charmap", chan), |b| {
+            b.iter(|| {
+                for c in &chars {
+                    black_box(unsafe { ffi::eia608_from_utf8_1(c.as_ptr(), chan) });
+                }
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    caption_frame_decode,
+    caption_frame_to_text,
+    caption_frame_from_text,
+    eia608_from_utf8_1
+);
+criterion_main!(benches);
@@ -0,0 +1,159 @@
+// This Source Code Form is subject to the terms of the Mozilla Public License, v2.0.
+// If a copy of the MPL was not distributed with this file, You can obtain one at
+// <https://mozilla.org/MPL/2.0/>.
+//
+// SPDX-License-Identifier: MPL-2.0
+
+// End-to-end benchmarks of the parsers and converters on the samples of the
+// tests. Parsing is measured in cc_data words and conversions in captions.
+
+use criterion::{criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
+use gst::prelude::*;
+use std::path::PathBuf;
+
+const SCC_SAMPLES: [&str; 2] = ["dn2018-1217.scc", "timecodes-cut-down-sample.scc"];
+const MCC_SAMPLE: &str = "captions-test_708.mcc";
+const TTTOCEA608_MODES: [&str; 3] = ["pop-on", "paint-on", "roll-up2"];
+
+fn init() {
+    use std::sync::Once;
+    static INIT: Once = Once::new();
+
+    INIT.call_once(|| {
+        gst::init().unwrap();
+        gstrsclosedcaption::plugin_register_static().unwrap();
+    });
+}
+
+fn sample(name: &str) -> gst::Buffer {
+    let mut path = PathBuf::from(env!("CARGO_MANIFEST_DIR"));
+    path.push("tests");
+    path.push(name);
+
+    gst::Buffer::from_mut_slice(std::fs::read(path).unwrap())
+}
+
+fn new_harness(pipeline: &str, src_caps: &str) -> gst_check::Harness {
+    let mut h = gst_check::Harness::new_parse(pipeline);
+    h.set_src_caps_str(src_caps);
+
+    h
+}
+
+// Pushes all the buffers and EOS, then returns all the output buffers
+fn run(mut h: gst_check::Harness, buffers: Vec<gst::Buffer>) -> Vec<gst::Buffer> {
+    let mut output = Vec::new();
+
+    for buffer in buffers {
+        assert_eq!(h.push(buffer), Ok(gst::FlowSuccess::Ok));
+        while let Some(buffer) = h.try_pull() {
+            output.push(buffer);
+        }
+    }
+
+    h.push_event(gst::event::Eos::new());
+    while let Some(buffer) = h.try_pull() {
+        output.push(buffer);
+    }
+
+    output
+}
+
+// The captions of a sample, as output by cea608tott
+fn scc_captions(name: &str) -> Vec<gst::Buffer> {
+    run(
+        new_harness("sccparse ! cea608tott", "application/x-scc"),
+        vec![sample(name)],
+    )
+    .into_iter()
+    .filter(|buffer| buffer.size() > 0)
+    .collect()
+}
+
+fn sccparse(c: &mut Criterion) {
+    init();
+
+    let mut group = c.benchmark_group("sccparse");
+    for name in SCC_SAMPLES {
+        let buffer = sample(name);
+        let n_words = run(
+            new_harness("sccparse", "application/x-scc"),
+            vec![buffer.clone()],
+        )
+        .iter()
+        .map(|buffer| buffer.size() / 2)
+        .sum::<usize>();
+
+        group.throughput(Throughput::Elements(n_words as u64));
+        group.bench_with_input(BenchmarkId::new("words", name), &buffer, |b, buffer| {
+            b.iter_batched(
+                || new_harness("sccparse", "application/x-scc"),
+                |h| run(h, vec![buffer.clone()]),
+                BatchSize::SmallInput,
+            )
+        });
+    }
+    group.finish();
+}
+
+fn mccparse_cea608tott(c: &mut Criterion) {
+    init();
+
+    // The sample only has CDPs, which the converter of gst-plugins-bad turns
+    // into the CEA-608 that cea608tott takes
+    if gst::ElementFactory::find("ccconverter").is_none() {
+        eprintln!("Skipping mccparse ! cea608tott, ccconverter is not available");
+        return;
+    }
+
+    let pipeline = "mccparse ! ccconverter ! closedcaption/x-cea-608,format=s334-1a ! cea608tott";
+    let src_caps = "application/x-mcc, version=(int) 1";
+    let buffer = sample(MCC_SAMPLE);
+    let n_captions = run(new_harness(pipeline, src_caps), vec![buffer.clone()])
+        .iter()
+        .filter(|buffer| buffer.size() > 0)
+        .count();
+
+    let mut group = c.benchmark_group("mccparse_cea608tott");
+    group.throughput(Throughput::Elements(n_captions as u64));
+    group.bench_with_input(
+        BenchmarkId::new("captions", MCC_SAMPLE),
+        &buffer,
+        |b, buffer| {
+            b.iter_batched(
+                || new_harness(pipeline, src_caps),
+                |h| run(h, vec![buffer.clone()]),
+                BatchSize::SmallInput,
+            )
+        },
+    );
+    group.finish();
+}
+
+fn tttocea608(c: &mut Criterion) {
+    init();
+
+    let mut group = c.benchmark_group("tttocea608");
+    for name in SCC_SAMPLES {
+        let captions = scc_captions(name);
+        group.throughput(Throughput::Elements(captions.len() as u64));
+        for mode in TTTOCEA608_MODES {
+            let pipeline = format!("tttocea608 mode={}", mode);
+            group.bench_with_input(
+                BenchmarkId::new(format!("captions/{}", mode), name),
+                &captions,
+                |b, captions| {
+                    b.iter_batched(
+                        || new_harness(&pipeline, "text/x-raw"),
+                        |h| run(h, captions.clone()),
+                        BatchSize::SmallInput,
+                    )
+                },
+            );
+        }
+    }
+    group.finish();
+}
+
+criterion_group!(benches, sccparse, mccparse_cea608tott, tttocea608);
+criterion_main!(benches);
@@ -1,11 +1,52 @@
+use std::env;
+use std::path::{Path, PathBuf};
+use std::process::Command;
+
+// Builds the generator of the EIA-608 word table for the host and runs it
+fn generate_eia608_table(out_dir: &Path) -> PathBuf {
+    let host = env::var("HOST").unwrap();
+    let compiler = cc::Build::new()
+        .host(&host)
+        .target(&host)
+        .cargo_metadata(false)
+        .get_compiler();
+
+    let generator = out_dir.join(format!("eia608_table_gen{}", env::consts::EXE_SUFFIX));
+    let mut cmd = compiler.to_command();
+    if compiler.is_like_msvc() {
+        cmd.arg(format!("/Fo{}\\", out_dir.display()));
+        cmd.arg(format!("/Fe{}", generator.display()));
+    } else {
+        cmd.arg("-o").arg(&generator);
+    }
+    cmd.arg("src/c/eia608_table_gen.c");
+
+    let status = cmd.status().expect("Failed to run the C compiler");
+    assert!(status.success(), "Failed to build eia608_table_gen");
+
+    let table = out_dir.join("eia608_table.c");
+    let status = Command::new(&generator)
+        .arg(&table)
+        .status()
+        .expect("Failed to run eia608_table_gen");
+    assert!(status.success(), "Failed to generate eia608_table.c");
+
+    table
+}
+
 fn main() {
     gst_plugin_version_helper::info();
 
+    let out_dir = PathBuf::from(env::var("OUT_DIR").unwrap());
+    let eia608_table = generate_eia608_table(&out_dir);
+
     cc::Build::new()
         .file("src/c/caption.c")
+        .file("src/c/cc_data.c")
         .file("src/c/eia608.c")
         .file("src/c/eia608_charmap.c")
         .file("src/c/eia608_from_utf8.c")
+        .file(eia608_table)
         .file("src/c/utf8.c")
         .file("src/c/xds.c")
         .extra_warnings(false)
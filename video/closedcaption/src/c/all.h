@@ -1,4 +1,5 @@
 #include "caption.h"
+#include "cc_data.h"
 #include "eia608_charmap.h"
 #include "eia608.h"
 #include "utf8.h"
@@ -50,6 +50,72 @@ caption_frame_init (caption_frame_t * frame)
   caption_frame_state_clear (frame);
   caption_frame_buffer_clear (&frame->back);
   caption_frame_buffer_clear (&frame->front);
+  frame->generation = 0;
+  memset (frame->row_generation, 0, sizeof (frame->row_generation));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Change tracking, only the front buffer is displayed
+static void
+caption_frame_touch_rows (caption_frame_t * frame,
+    const caption_frame_buffer_t * buff, uint16_t rows)
+{
+  int r;
+
+  if (buff != &frame->front || !rows) {
+    return;
+  }
+
+  ++frame->generation;
+  for (r = 0; r < SCREEN_ROWS; ++r) {
+    if (rows & (1 << r)) {
+      frame->row_generation[r] = frame->generation;
+    }
+  }
+}
+
+static const caption_frame_cell_t empty_row[SCREEN_COLS];
+
+static uint16_t
+caption_frame_buffer_used_rows (const caption_frame_buffer_t * buff)
+{
+  int r;
+  uint16_t rows = 0;
+
+  for (r = 0; r < SCREEN_ROWS; ++r) {
+    if (memcmp (buff->cell[r], empty_row, sizeof (empty_row))) {
+      rows |= 1 << r;
+    }
+  }
+
+  return rows;
+}
+
+static void
+caption_frame_erase_buffer (caption_frame_t * frame,
+    caption_frame_buffer_t * buff)
+{
+  if (buff == &frame->front) {
+    caption_frame_touch_rows (frame, buff,
+        caption_frame_buffer_used_rows (buff));
+  }
+
+  caption_frame_buffer_clear (buff);
+}
+
+uint16_t
+caption_frame_changed_rows (caption_frame_t * frame, uint32_t generation)
+{
+  int r;
+  uint16_t rows = 0;
+
+  for (r = 0; r < SCREEN_ROWS; ++r) {
+    if (frame->row_generation[r] > generation) {
+      rows |= 1 << r;
+    }
+  }
+
+  return rows;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -73,33 +139,56 @@ int caption_frame_clear_char (caption_frame_t * frame, int row, int col)
   caption_frame_cell_t *cell = frame_buffer_cell (frame->write, row, col);
 
   if (cell) {
-    memset (cell, 0, sizeof (caption_frame_cell_t));
+    if (cell->chr || cell->attr) {
+      memset (cell, 0, sizeof (caption_frame_cell_t));
+      caption_frame_touch_rows (frame, frame->write, 1 << row);
+    }
     return 1;
   }
 
   return 0;
 }
 
-uint16_t _eia608_from_utf8 (const char *s);     // function is in eia608.c.re2c
-int
-caption_frame_write_char (caption_frame_t * frame, int row, int col,
-    eia608_style_t style, int underline, const char *c)
+static int
+caption_frame_write_index (caption_frame_t * frame, int row, int col,
+    eia608_style_t style, int underline, int idx)
 {
-  if (!frame->write || !_eia608_from_utf8 (c)) {
+  if (!frame->write || 0 > idx || EIA608_CHAR_COUNT <= idx) {
     return 0;
   }
 
   caption_frame_cell_t *cell = frame_buffer_cell (frame->write, row, col);
 
-  if (cell && utf8_char_copy (&cell->data[0], c)) {
-    cell->uln = underline;
-    cell->sty = style;
+  if (cell) {
+    caption_frame_cell_t new_cell = { idx + 1,
+      (style & CAPTION_FRAME_CELL_STYLE) |
+          (underline ? CAPTION_FRAME_CELL_UNDERLINE : 0)
+    };
+    // Rewriting the same character, e.g. a repeated caption, changes nothing
+    if (cell->chr != new_cell.chr || cell->attr != new_cell.attr) {
+      *cell = new_cell;
+      caption_frame_touch_rows (frame, frame->write, 1 << row);
+    }
     return 1;
   }
 
   return 0;
 }
 
+int
+caption_frame_write_char (caption_frame_t * frame, int row, int col,
+    eia608_style_t style, int underline, const char *c)
+{
+  return caption_frame_write_index (frame, row, col, style, underline,
+      eia608_utf8_to_index (c));
+}
+
+static const utf8_char_t *
+caption_frame_cell_utf8 (const caption_frame_cell_t * cell)
+{
+  return cell->chr ? eia608_char_map[cell->chr - 1] : EIA608_CHAR_NULL;
+}
+
 const utf8_char_t *
 caption_frame_read_char (caption_frame_t * frame, int row, int col,
     eia608_style_t * style, int *underline)
@@ -120,14 +209,14 @@ caption_frame_read_char (caption_frame_t * frame, int row, int col,
   }
 
   if (style) {
-    (*style) = cell->sty;
+    (*style) = cell->attr & CAPTION_FRAME_CELL_STYLE;
   }
 
   if (underline) {
-    (*underline) = cell->uln;
+    (*underline) = ! !(cell->attr & CAPTION_FRAME_CELL_UNDERLINE);
   }
 
-  return &cell->data[0];
+  return caption_frame_cell_utf8 (cell);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -145,6 +234,10 @@ caption_frame_carriage_return (caption_frame_t * frame)
     return LIBCAPTION_OK;
   }
 
+  // Every row from r - 1 down moves or gets cleared
+  caption_frame_touch_rows (frame, frame->write,
+      ((1 << SCREEN_ROWS) - 1) & ~((1 << (r - 1)) - 1));
+
   for (; r < SCREEN_ROWS; ++r) {
     uint8_t *dst = (uint8_t *) frame_buffer_cell (frame->write, r - 1, 0);
     uint8_t *src = (uint8_t *) frame_buffer_cell (frame->write, r - 0, 0);
@@ -160,14 +253,14 @@ caption_frame_carriage_return (caption_frame_t * frame)
 
 ////////////////////////////////////////////////////////////////////////////////
 libcaption_stauts_t
-eia608_write_char (caption_frame_t * frame, char *c)
+eia608_write_index (caption_frame_t * frame, int idx)
 {
-  if (0 == c || 0 == c[0] || SCREEN_ROWS <= frame->state.row
+  if (0 > idx || SCREEN_ROWS <= frame->state.row
       || 0 > frame->state.row || SCREEN_COLS <= frame->state.col
       || 0 > frame->state.col) {
     // NO-OP
-  } else if (caption_frame_write_char (frame, frame->state.row,
-          frame->state.col, frame->state.sty, frame->state.uln, c)) {
+  } else if (caption_frame_write_index (frame, frame->state.row,
+          frame->state.col, frame->state.sty, frame->state.uln, idx)) {
     frame->state.col += 1;
   }
 
@@ -177,6 +270,17 @@ eia608_write_char (caption_frame_t * frame, char *c)
 libcaption_stauts_t
 caption_frame_end (caption_frame_t * frame)
 {
+  int r;
+  uint16_t rows = 0;
+
+  for (r = 0; r < SCREEN_ROWS; ++r) {
+    if (memcmp (frame->front.cell[r], frame->back.cell[r],
+            sizeof (frame->front.cell[r]))) {
+      rows |= 1 << r;
+    }
+  }
+  caption_frame_touch_rows (frame, &frame->front, rows);
+
   memcpy (&frame->front, &frame->back, sizeof (caption_frame_buffer_t));
   caption_frame_buffer_clear (&frame->back);    // This is required
   return LIBCAPTION_READY;
@@ -251,7 +355,7 @@ caption_frame_decode_control (caption_frame_t * frame, uint16_t cc_data)
       return LIBCAPTION_OK;
 
     case eia608_control_erase_display_memory:
-      caption_frame_buffer_clear (&frame->front);
+      caption_frame_erase_buffer (frame, &frame->front);
       return LIBCAPTION_CLEAR;
 
       // ROLL-UP
@@ -286,7 +390,7 @@ caption_frame_decode_control (caption_frame_t * frame, uint16_t cc_data)
       return LIBCAPTION_OK;
 
     case eia608_control_erase_non_displayed_memory:
-      caption_frame_buffer_clear (&frame->back);
+      caption_frame_erase_buffer (frame, &frame->back);
       return LIBCAPTION_OK;
 
     case eia608_control_end_of_caption:
@@ -311,44 +415,35 @@ caption_frame_decode_control (caption_frame_t * frame, uint16_t cc_data)
 }
 
 libcaption_stauts_t
-caption_frame_decode_text (caption_frame_t * frame, uint16_t cc_data)
+caption_frame_decode_text (caption_frame_t * frame, uint32_t info)
 {
-  int chan;
-  char char1[5], char2[5];
-  size_t chars = eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
+  int c1 = eia608_word_index1 (info), c2 = eia608_word_index2 (info);
 
-  if (eia608_is_westeu (cc_data)) {
+  if (eia608_word_westeu == eia608_word_class (info)) {
     // Extended charcters replace the previous charcter for back compatibility
     caption_frame_backspace (frame);
   }
 
-  if (0 < chars) {
-    eia608_write_char (frame, char1);
+  if (0 <= c1) {
+    eia608_write_index (frame, c1);
   }
 
-  if (1 < chars) {
-    eia608_write_char (frame, char2);
+  if (0 <= c2) {
+    eia608_write_index (frame, c2);
   }
 
   return LIBCAPTION_OK;
 }
 
-libcaption_stauts_t
-caption_frame_decode (caption_frame_t * frame, uint16_t cc_data,
-    double timestamp)
+// decodes a word with valid parity that isn't padding
+static libcaption_stauts_t
+caption_frame_decode_word (caption_frame_t * frame, uint16_t cc_data,
+    uint32_t info, double timestamp)
 {
-  if (!eia608_parity_varify (cc_data)) {
-    frame->status = LIBCAPTION_ERROR;
-    return frame->status;
-  }
-
-  if (eia608_is_padding (cc_data)) {
-    frame->status = LIBCAPTION_OK;
-    return frame->status;
-  }
+  eia608_word_class_t word_class = eia608_word_class (info);
 
   // skip duplicate controll commands. We also skip duplicate specialna to match the behaviour of iOS/vlc
-  if ((eia608_is_specialna(cc_data) || eia608_is_control(cc_data)) && cc_data == frame->state.cc_data) {
+  if ((eia608_word_specialna == word_class || eia608_word_control == word_class) && cc_data == frame->state.cc_data) {
     if (timestamp < 0 && caption_frame_popon (frame))
       frame->timestamp += (1 / 29.97);
     return LIBCAPTION_OK;
@@ -365,32 +460,255 @@ caption_frame_decode (caption_frame_t * frame, uint16_t cc_data,
 
   if (frame->xds.state) {
     frame->status = xds_decode (&frame->xds, cc_data);
-  } else if (eia608_is_xds (cc_data)) {
-    frame->status = xds_decode (&frame->xds, cc_data);
-  } else if (eia608_is_control (cc_data)) {
-    frame->status = caption_frame_decode_control (frame, cc_data);
-  } else if (eia608_is_basicna (cc_data) || eia608_is_specialna (cc_data)
-      || eia608_is_westeu (cc_data)) {
+    return frame->status;
+  }
+
+  switch (word_class) {
+    case eia608_word_xds:
+      frame->status = xds_decode (&frame->xds, cc_data);
+      break;
+
+    case eia608_word_control:
+      frame->status = caption_frame_decode_control (frame, cc_data);
+      break;
+
+    case eia608_word_basicna:
+    case eia608_word_specialna:
+    case eia608_word_westeu:
+      // Don't decode text if we dont know what mode we are in.
+      if (!frame->write) {
+        frame->status = LIBCAPTION_OK;
+        break;
+      }
+
+      frame->status = caption_frame_decode_text (frame, info);
+
+      // If we are in paint on mode, display immiditally
+      if (LIBCAPTION_OK == frame->status && caption_frame_painton (frame)) {
+        frame->status = LIBCAPTION_READY;
+      }
+      break;
+
+    case eia608_word_preamble:
+      frame->status = caption_frame_decode_preamble (frame, cc_data);
+      break;
+
+    case eia608_word_midrowchange:
+      frame->status = caption_frame_decode_midrowchange (frame, cc_data);
+      break;
+
+    default:
+      break;
+  }
+
+  return frame->status;
+}
+
+libcaption_stauts_t
+caption_frame_decode (caption_frame_t * frame, uint16_t cc_data,
+    double timestamp)
+{
+  uint32_t info = eia608_word_info (cc_data);
 
-    // Don't decode text if we dont know what mode we are in.
-    if (!frame->write) {
+  if (!(info & EIA608_WORD_PARITY)) {
+    frame->status = LIBCAPTION_ERROR;
+    return frame->status;
+  }
+
+  if (eia608_is_padding (cc_data)) {
+    frame->status = LIBCAPTION_OK;
+    return frame->status;
+  }
+
+  return caption_frame_decode_word (frame, cc_data, info, timestamp);
+}
+
+// four words at a time, each byte must have odd parity
+#define CAPTION_FRAME_BLOCK_WORDS 4
+#define CAPTION_FRAME_BLOCK_BYTES 0x0101010101010101ULL
+#define CAPTION_FRAME_BLOCK_PADDING 0x8080808080808080ULL
+
+static int
+caption_frame_block_parity_varify (uint64_t block)
+{
+  // fold the bits of each byte into its lowest bit, the bits shifted in
+  // from the next byte never reach it
+  block ^= block >> 4;
+  block ^= block >> 2;
+  block ^= block >> 1;
+
+  return CAPTION_FRAME_BLOCK_BYTES == (block & CAPTION_FRAME_BLOCK_BYTES);
+}
+
+static size_t
+caption_frame_decode_event (caption_frame_t * frame, uint16_t cc_data,
+    double timestamp, size_t index, caption_frame_event_t * events,
+    size_t n_events)
+{
+  uint32_t info = eia608_word_info (cc_data);
+  libcaption_stauts_t status;
+
+  if (!(info & EIA608_WORD_PARITY)) {
+    status = frame->status = LIBCAPTION_ERROR;
+  } else if (eia608_is_padding (cc_data)) {
+    status = frame->status = LIBCAPTION_OK;
+  } else {
+    status = caption_frame_decode_word (frame, cc_data, info, timestamp);
+  }
+
+  if (LIBCAPTION_OK != status) {
+    events[n_events].index = index;
+    events[n_events].status = status;
+    ++n_events;
+  }
+
+  return n_events;
+}
+
+size_t
+caption_frame_decode_buffer (caption_frame_t * frame, const uint16_t * cc_data,
+    size_t size, double timestamp, caption_frame_event_t * events)
+{
+  size_t i = 0, n_events = 0;
+
+  for (; i + CAPTION_FRAME_BLOCK_WORDS <= size; i += CAPTION_FRAME_BLOCK_WORDS) {
+    uint64_t block;
+    memcpy (&block, cc_data + i, sizeof (block));
+
+    if (CAPTION_FRAME_BLOCK_PADDING == block) {
       frame->status = LIBCAPTION_OK;
-      return frame->status;
+      continue;
     }
 
-    frame->status = caption_frame_decode_text (frame, cc_data);
+    if (!caption_frame_block_parity_varify (block)) {
+      for (size_t j = i; j < i + CAPTION_FRAME_BLOCK_WORDS; ++j) {
+        n_events = caption_frame_decode_event (frame, cc_data[j], timestamp,
+            j, events, n_events);
+      }
+      continue;
+    }
+
+    for (size_t j = i; j < i + CAPTION_FRAME_BLOCK_WORDS; ++j) {
+      libcaption_stauts_t status;
 
-    // If we are in paint on mode, display immiditally
-    if (LIBCAPTION_OK == frame->status && caption_frame_painton (frame)) {
-      frame->status = LIBCAPTION_READY;
+      if (eia608_is_padding (cc_data[j])) {
+        frame->status = LIBCAPTION_OK;
+        continue;
+      }
+
+      status = caption_frame_decode_word (frame, cc_data[j],
+          eia608_word_info (cc_data[j]), timestamp);
+      if (LIBCAPTION_OK != status) {
+        events[n_events].index = j;
+        events[n_events].status = status;
+        ++n_events;
+      }
     }
-  } else if (eia608_is_preamble (cc_data)) {
-    frame->status = caption_frame_decode_preamble (frame, cc_data);
-  } else if (eia608_is_midrowchange (cc_data)) {
-    frame->status = caption_frame_decode_midrowchange (frame, cc_data);
   }
 
-  return frame->status;
+  for (; i < size; ++i) {
+    n_events = caption_frame_decode_event (frame, cc_data[i], timestamp, i,
+        events, n_events);
+  }
+
+  return n_events;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void
+caption_channels_init (caption_channels_t * channels)
+{
+  for (int i = 0; i < CAPTION_CHANNELS; ++i) {
+    caption_frame_init (&channels->frame[i]);
+  }
+
+  xds_init (&channels->xds);
+  channels->data_channel[0] = channels->data_channel[1] = 0;
+}
+
+// routes a word with valid parity that isn't padding
+static caption_channel_t
+caption_channels_route_word (caption_channels_t * channels, int field,
+    uint32_t info)
+{
+  switch (eia608_word_class (info)) {
+    case eia608_word_xds:
+      return field ? caption_channel_xds : caption_channel_none;
+
+    case eia608_word_basicna:
+    case eia608_word_other:
+      // the content and end of a packet don't look like XDS codes
+      if (field && channels->xds.state) {
+        return caption_channel_xds;
+      }
+      break;
+
+    default:
+      if (field && channels->xds.state) {
+        xds_init (&channels->xds);
+      }
+
+      channels->data_channel[field] = (info & EIA608_WORD_CHANNEL) ? 1 : 0;
+      break;
+  }
+
+  return (caption_channel_t) (field * 2 + channels->data_channel[field]);
+}
+
+caption_channel_t
+caption_channels_route (caption_channels_t * channels, int field,
+    uint16_t cc_data)
+{
+  uint32_t info = eia608_word_info (cc_data);
+
+  if (!(info & EIA608_WORD_PARITY) || eia608_is_padding (cc_data)) {
+    return caption_channel_none;
+  }
+
+  return caption_channels_route_word (channels, field ? 1 : 0, info);
+}
+
+size_t
+caption_channels_decode (caption_channels_t * channels, int field,
+    const uint16_t * cc_data, size_t size, double timestamp,
+    caption_channels_event_t * events)
+{
+  size_t n_events = 0;
+
+  field = field ? 1 : 0;
+
+  for (size_t i = 0; i < size; ++i) {
+    uint32_t info = eia608_word_info (cc_data[i]);
+    caption_channel_t channel;
+    libcaption_stauts_t status;
+
+    if (!(info & EIA608_WORD_PARITY)) {
+      channel = caption_channel_none;
+      status = LIBCAPTION_ERROR;
+    } else if (eia608_is_padding (cc_data[i])) {
+      continue;
+    } else {
+      channel = caption_channels_route_word (channels, field, info);
+
+      if (caption_channel_xds == channel) {
+        status = xds_decode (&channels->xds, cc_data[i]);
+      } else if (caption_channel_none == channel) {
+        continue;
+      } else {
+        status = caption_frame_decode_word (&channels->frame[channel],
+            cc_data[i], info, timestamp);
+      }
+    }
+
+    if (LIBCAPTION_OK != status) {
+      events[n_events].index = i;
+      events[n_events].channel = channel;
+      events[n_events].status = status;
+      ++n_events;
+    }
+  }
+
+  return n_events;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -456,6 +774,50 @@ caption_frame_to_text (caption_frame_t * frame, utf8_char_t * data, int full)
   return size;
 }
 
+size_t
+caption_frame_to_runs (caption_frame_t * frame, uint16_t rows,
+    caption_frame_runs_t * runs)
+{
+  size_t size = 0;
+  runs->count = 0;
+
+  for (int r = 0; r < SCREEN_ROWS; ++r) {
+    caption_frame_run_t *run = 0;
+
+    if (!(rows & (1 << r))) {
+      continue;
+    }
+
+    for (int c = 0; c < SCREEN_COLS; ++c) {
+      const caption_frame_cell_t *cell = &frame->front.cell[r][c];
+      const utf8_char_t *chr;
+      size_t s;
+
+      if (!cell->chr) {
+        run = 0;
+        continue;
+      }
+
+      // the previous cell is the last one of the run
+      if (!run || cell->attr != frame->front.cell[r][c - 1].attr) {
+        run = &runs->run[runs->count++];
+        run->row = (uint8_t) r;
+        run->col = (uint8_t) c;
+        run->style = cell->attr & CAPTION_FRAME_CELL_STYLE;
+        run->underline = !!(cell->attr & CAPTION_FRAME_CELL_UNDERLINE);
+        run->offset = (uint16_t) size;
+        run->size = 0;
+      }
+
+      chr = caption_frame_cell_utf8 (cell);
+      s = utf8_char_copy (&runs->text[size], chr);
+      size += s, run->size += (uint16_t) s;
+    }
+  }
+
+  return runs->count;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 size_t
 caption_frame_dump_buffer (caption_frame_t * frame, utf8_char_t * buf)
@@ -488,7 +850,8 @@ caption_frame_dump_buffer (caption_frame_t * frame, utf8_char_t * buf)
     for (c = 0; c < SCREEN_COLS; ++c) {
       caption_frame_cell_t *cell = frame_buffer_cell (&frame->front, r, c);
       bytes = utf8_char_copy (buf, (!cell
-              || 0 == cell->data[0]) ? EIA608_CHAR_SPACE : &cell->data[0]);
+              || 0 == cell->chr) ? EIA608_CHAR_SPACE :
+          caption_frame_cell_utf8 (cell));
       total += bytes, buf += bytes;
     }
 
@@ -501,7 +864,8 @@ caption_frame_dump_buffer (caption_frame_t * frame, utf8_char_t * buf)
     for (c = 0; c < SCREEN_COLS; ++c) {
       caption_frame_cell_t *cell = frame_buffer_cell (&frame->back, r, c);
       bytes = utf8_char_copy (buf, (!cell
-              || 0 == cell->data[0]) ? EIA608_CHAR_SPACE : &cell->data[0]);
+              || 0 == cell->chr) ? EIA608_CHAR_SPACE :
+          caption_frame_cell_utf8 (cell));
       total += bytes, buf += bytes;
     }
 
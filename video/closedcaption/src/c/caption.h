@@ -47,11 +47,13 @@ static inline libcaption_stauts_t libcaption_status_update(libcaption_stauts_t o
 #define SCREEN_COLS 32
 
 typedef struct {
-    uint8_t uln; //< underline
-    uint8_t sty; //< style
-    utf8_char_t data[5]; //< 4 byte utf8 values plus null term
+    uint8_t chr; //< index in eia608_char_map plus one, 0 for an empty cell
+    uint8_t attr; //< style in the low bits, underline in CAPTION_FRAME_CELL_UNDERLINE
 } caption_frame_cell_t;
 
+#define CAPTION_FRAME_CELL_STYLE 0x07
+#define CAPTION_FRAME_CELL_UNDERLINE 0x08
+
 typedef struct {
     caption_frame_cell_t cell[SCREEN_ROWS][SCREEN_COLS];
 } caption_frame_buffer_t;
@@ -73,6 +75,8 @@ typedef struct {
     caption_frame_buffer_t back;
     caption_frame_buffer_t* write;
     libcaption_stauts_t status;
+    uint32_t generation; //< incremented whenever a displayed row changes
+    uint32_t row_generation[SCREEN_ROWS]; //< generation of the last change of each displayed row
 } caption_frame_t;
 
 /*!
@@ -97,6 +101,16 @@ static inline int caption_frame_rollup(caption_frame_t* frame) { return _caption
     \param
 */
 static inline double caption_frame_timestamp(caption_frame_t* frame) { return frame->timestamp; }
+/*! \brief Returns the generation of the latest change to the displayed rows
+    \param frame A pointer to an allocted and initialized caption_frame_t object
+*/
+static inline uint32_t caption_frame_generation(caption_frame_t* frame) { return frame->generation; }
+/*! \brief Returns the displayed rows changed after a generation
+    \param frame A pointer to an allocted and initialized caption_frame_t object
+    \param generation A generation previously returned by caption_frame_generation(), or 0 for every row changed since init
+    \return A mask with bit n set if row n changed
+*/
+uint16_t caption_frame_changed_rows(caption_frame_t* frame, uint32_t generation);
 /*! \brief Writes a single charcter to a caption_frame_t object
     \param frame A pointer to an allocted and initialized caption_frame_t object
     \param row Row position to write charcter, must be between 0 and SCREEN_ROWS-1
@@ -104,6 +118,7 @@ static inline double caption_frame_timestamp(caption_frame_t* frame) { return fr
     \param style Style to apply to charcter
     \param underline Set underline attribute, 0 = off any other value = on
     \param c pointer to a single valid utf8 charcter. Bytes are automatically determined, and a NULL terminator is not required
+    Cells store the character as its eia608_char_map entry, which caption_frame_read_char() returns
 */
 int caption_frame_write_char(caption_frame_t* frame, int row, int col, eia608_style_t style, int underline, const utf8_char_t* c);
 /*! \brief
@@ -114,6 +129,21 @@ const utf8_char_t* caption_frame_read_char(caption_frame_t* frame, int row, int
     \param
 */
 libcaption_stauts_t caption_frame_decode(caption_frame_t* frame, uint16_t cc_data, double timestamp);
+/*! \brief A status other than LIBCAPTION_OK returned while decoding a buffer of cc_data
+*/
+typedef struct {
+    size_t index; //< index of the cc_data word in the buffer
+    libcaption_stauts_t status;
+} caption_frame_event_t;
+/*! \brief Decodes a buffer of cc_data, like calling caption_frame_decode() on every word
+    \param frame A pointer to an allocted and initialized caption_frame_t object
+    \param cc_data The cc_data words, in host byte order
+    \param size The number of cc_data words
+    \param timestamp Timestamp of all the words, as passed to caption_frame_decode()
+    \param events Array of at least size entries, receives the words that returned LIBCAPTION_READY, LIBCAPTION_CLEAR or LIBCAPTION_ERROR
+    \return The number of events written
+*/
+size_t caption_frame_decode_buffer(caption_frame_t* frame, const uint16_t* cc_data, size_t size, double timestamp, caption_frame_event_t* events);
 /*! \brief
     \param
 */
@@ -123,6 +153,76 @@ int caption_frame_from_text(caption_frame_t* frame, const utf8_char_t* data);
 */
 #define CAPTION_FRAME_TEXT_BYTES (4 * ((SCREEN_COLS + 2) * SCREEN_ROWS) + 1)
 size_t caption_frame_to_text(caption_frame_t* frame, utf8_char_t* data, int full);
+/*! \brief Displayed charcters of a row that follow each other and share their style and underline
+*/
+typedef struct {
+    uint8_t row;
+    uint8_t col; //< column of the first charcter
+    uint8_t style; //< eia608_style_t
+    uint8_t underline;
+    uint16_t offset; //< first byte of the charcters in the text of caption_frame_runs_t
+    uint16_t size; //< bytes of the charcters, without NULL terminator
+} caption_frame_run_t;
+#define CAPTION_FRAME_RUNS (SCREEN_ROWS * SCREEN_COLS)
+typedef struct {
+    size_t count;
+    caption_frame_run_t run[CAPTION_FRAME_RUNS];
+    utf8_char_t text[CAPTION_FRAME_TEXT_BYTES];
+} caption_frame_runs_t;
+/*! \brief Writes the displayed charcters of some rows as styled runs, without allocating
+    \param frame A pointer to an allocted and initialized caption_frame_t object
+    \param rows Mask with bit n set to write row n, like caption_frame_changed_rows() returns
+    \param runs Receives the runs in row and column order, can be reused between calls
+    \return The number of runs written
+    Empty cells end a run, so a run's columns are the column of its first charcter plus its charcter count.
+*/
+size_t caption_frame_to_runs(caption_frame_t* frame, uint16_t rows, caption_frame_runs_t* runs);
+/*! \brief The caption channels of the two fields, and the XDS packets carried by field 2
+*/
+typedef enum {
+    caption_channel_cc1 = 0,
+    caption_channel_cc2 = 1,
+    caption_channel_cc3 = 2,
+    caption_channel_cc4 = 3,
+    caption_channel_xds = 4,
+    caption_channel_none = 5, //< padding, a charcter with bad parity, or a stray XDS code in field 1
+} caption_channel_t;
+#define CAPTION_CHANNELS 4
+typedef struct {
+    caption_frame_t frame[CAPTION_CHANNELS]; //< indexed by caption_channel_t, CC1 to CC4
+    xds_t xds;
+    uint8_t data_channel[2]; //< data channel of the basic charcters of each field, from its last caption code
+} caption_channels_t;
+/*! \brief Initializes an allocated caption_channels_t instance
+    \param channels Pointer to prealocated caption_channels_t object
+*/
+void caption_channels_init(caption_channels_t* channels);
+/*! \brief Returns the channel a word belongs to, without decoding it
+    \param channels A pointer to an allocted and initialized caption_channels_t object
+    \param field 0 for field 1, which carries CC1 and CC2, any other value for field 2, which carries CC3, CC4 and XDS
+    \param cc_data The cc_data word
+    Codes with a channel bit select the data channel of the basic charcters that follow them in the same field.
+    Caption codes interrupt an XDS packet in progress, dropping it.
+*/
+caption_channel_t caption_channels_route(caption_channels_t* channels, int field, uint16_t cc_data);
+/*! \brief A status other than LIBCAPTION_OK returned while decoding a buffer of cc_data for a channel
+*/
+typedef struct {
+    size_t index; //< index of the cc_data word in the buffer
+    caption_channel_t channel; //< caption_channel_none for LIBCAPTION_ERROR on a word with bad parity
+    libcaption_stauts_t status;
+} caption_channels_event_t;
+/*! \brief Decodes a buffer of cc_data of one field, routing each word to its channel
+    \param channels A pointer to an allocted and initialized caption_channels_t object
+    \param field The field of all the words, as passed to caption_channels_route()
+    \param cc_data The cc_data words, in host byte order
+    \param size The number of cc_data words
+    \param timestamp Timestamp of all the words, as passed to caption_frame_decode()
+    \param events Array of at least size entries, receives the words that returned LIBCAPTION_READY, LIBCAPTION_CLEAR or LIBCAPTION_ERROR
+    \return The number of events written
+    A LIBCAPTION_READY event of caption_channel_xds means channels->xds holds a complete packet.
+*/
+size_t caption_channels_decode(caption_channels_t* channels, int field, const uint16_t* cc_data, size_t size, double timestamp, caption_channels_event_t* events);
 /*! \brief
     \param
 */
@@ -0,0 +1,134 @@
+/**********************************************************************************************/
+/* SPDX-License-Identifier: MIT                                                               */
+/*                                                                                            */
+/* cc_data() triples of CEA-708 CDPs and caption SEIs, see cc_data.h                          */
+/**********************************************************************************************/
+#include "cc_data.h"
+
+static void
+cc_data_clear (cc_data_t * cc)
+{
+  cc->cea608_count[0] = cc->cea608_count[1] = 0;
+  cc->dtvcc = 0;
+  cc->dtvcc_count = 0;
+  cc->error_byte = 0;
+}
+
+size_t
+cc_data_demux (cc_data_t * cc, const uint8_t * data, size_t size)
+{
+  size_t count = size / CC_DATA_TRIPLE_BYTES;
+
+  cc_data_clear (cc);
+
+  if (count > CC_DATA_MAX_COUNT) {
+    count = CC_DATA_MAX_COUNT;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t *triple = data + i * CC_DATA_TRIPLE_BYTES;
+    cc_type_t type = cc_data_triple_type (triple);
+
+    // invalid triples are padding, also the DTVCC ones
+    if (!cc_data_triple_valid (triple)) {
+      continue;
+    }
+
+    if (type & cc_type_dtvcc_packet_data) {
+      // the DTVCC triples follow the CEA-608 ones, up to the end of the data
+      cc->dtvcc = triple;
+      cc->dtvcc_count = (uint8_t) (count - i);
+      break;
+    }
+
+    cc->cea608[type][cc->cea608_count[type]++] =
+        (uint16_t) (triple[1] << 8 | triple[2]);
+  }
+
+  return count;
+}
+
+// logic from ccconverter
+cc_data_status_t
+cc_data_demux_cdp (cc_data_t * cc, const uint8_t * cdp, size_t size)
+{
+  size_t pos = 0, cc_size;
+  uint8_t flags;
+
+  cc_data_clear (cc);
+
+  if (size < 11) {
+    return CC_DATA_WRONG_LENGTH;
+  }
+
+  if (0x96 != cdp[0] || 0x69 != cdp[1]) {
+    return CC_DATA_WRONG_MAGIC_SEQUENCE;
+  }
+
+  pos = 2;
+  if (cdp[pos] != size) {
+    cc->error_byte = pos;
+    return CC_DATA_WRONG_LENGTH;
+  }
+
+  // the checksum ending the footer makes the sum of all the bytes a multiple of 256
+  {
+    uint8_t sum = 0;
+
+    for (size_t i = 0; i < size; ++i) {
+      sum += cdp[i];
+    }
+
+    if (sum) {
+      cc->error_byte = size - 1;
+      return CC_DATA_WRONG_CHECKSUM;
+    }
+  }
+
+  // skip length and framerate
+  pos += 2;
+
+  flags = cdp[pos++];
+  if (!(flags & 0x40)) {
+    // no cc_data
+    return CC_DATA_OK;
+  }
+
+  // skip sequence counter
+  pos += 2;
+
+  // skip timecode
+  if (flags & 0x80) {
+    if (size - pos < 5) {
+      cc->error_byte = pos;
+      return CC_DATA_WRONG_LENGTH;
+    }
+    pos += 5;
+  }
+
+  if (size - pos < 2) {
+    cc->error_byte = pos;
+    return CC_DATA_WRONG_LENGTH;
+  }
+
+  if (0x72 != cdp[pos]) {
+    cc->error_byte = pos;
+    return CC_DATA_WRONG_MAGIC_SEQUENCE;
+  }
+  ++pos;
+
+  if (0xE0 != (cdp[pos] & 0xE0)) {
+    cc->error_byte = pos;
+    return CC_DATA_WRONG_MAGIC_SEQUENCE;
+  }
+
+  cc_size = (cdp[pos++] & 0x1F) * CC_DATA_TRIPLE_BYTES;
+  if (cc_size > size - pos) {
+    cc->error_byte = pos;
+    return CC_DATA_WRONG_LENGTH;
+  }
+
+  cc_data_demux (cc, cdp + pos, cc_size);
+
+  return CC_DATA_OK;
+}
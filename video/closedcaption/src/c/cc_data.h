@@ -0,0 +1,67 @@
+/**********************************************************************************************/
+/* SPDX-License-Identifier: MIT                                                               */
+/*                                                                                            */
+/* Demuxes the cc_data() triples of CEA-708 CDPs and caption SEIs, in place. The CEA-608      */
+/* words of each field are handed to caption_frame_decode_buffer() or                         */
+/* caption_channels_decode(), the DTVCC triples are left where they are.                     */
+/**********************************************************************************************/
+#ifndef LIBCAPTION_CC_DATA_H
+#define LIBCAPTION_CC_DATA_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef enum {
+    cc_type_ntsc_cc_field_1 = 0,
+    cc_type_ntsc_cc_field_2 = 1,
+    cc_type_dtvcc_packet_data = 2,
+    cc_type_dtvcc_packet_start = 3,
+} cc_type_t;
+
+typedef enum {
+    CC_DATA_OK = 0,
+    CC_DATA_WRONG_LENGTH = 1,
+    CC_DATA_WRONG_MAGIC_SEQUENCE = 2,
+    CC_DATA_WRONG_CHECKSUM = 3,
+} cc_data_status_t;
+
+#define CC_DATA_TRIPLE_BYTES 3
+#define CC_DATA_MAX_COUNT 31 //< cc_count is 5 bits
+/*! \brief Returns whether a triple has cc_valid set
+*/
+static inline int cc_data_triple_valid(const uint8_t* triple) { return (triple[0] & 0x04) ? 1 : 0; }
+/*! \brief Returns the cc_type of a triple
+*/
+static inline cc_type_t cc_data_triple_type(const uint8_t* triple) { return (cc_type_t)(triple[0] & 0x03); }
+
+typedef struct {
+    uint16_t cea608[2][CC_DATA_MAX_COUNT]; //< cc_data words of the valid triples of each field, in host byte order
+    uint8_t cea608_count[2];
+    const uint8_t* dtvcc; //< first valid DTVCC triple in the demuxed data, NULL if there are none
+    uint8_t dtvcc_count; //< number of triples from dtvcc on, valid or not
+    size_t error_byte; //< offset in the demuxed data of the error returned by cc_data_demux_cdp()
+} cc_data_t;
+
+/*! \brief Demuxes a block of cc_data triples
+    \param cc A pointer to a cc_data_t object, overwritten
+    \param data The triples, they must outlive cc
+    \param size The size of data in bytes, a trailing partial triple is ignored
+    \return The number of triples demuxed, at most CC_DATA_MAX_COUNT
+    Triples are CEA-608 until the first valid DTVCC triple, valid CEA-608 triples that follow it are dropped.
+*/
+size_t cc_data_demux(cc_data_t* cc, const uint8_t* data, size_t size);
+/*! \brief Demuxes the cc_data section of a CDP
+    \param cc A pointer to a cc_data_t object, overwritten
+    \param cdp The CDP, it must outlive cc
+    \param size The size of the CDP in bytes
+    \return CC_DATA_OK, also without a cc_data section, or the error at cc->error_byte
+*/
+cc_data_status_t cc_data_demux_cdp(cc_data_t* cc, const uint8_t* cdp, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
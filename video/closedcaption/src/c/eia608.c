@@ -140,49 +140,16 @@ utf8_from_index (int idx)
   return (0 <= idx && EIA608_CHAR_COUNT > idx) ? eia608_char_map[idx] : "";
 }
 
-static int
+int
 eia608_to_index (uint16_t cc_data, int *chan, int *c1, int *c2)
 {
-  (*c1) = (*c2) = -1;
-  (*chan) = 0;
-  cc_data &= 0x7F7F;            // strip off parity bits
-
-  // Handle Basic NA BEFORE we strip the channel bit
-  if (eia608_is_basicna (cc_data)) {
-    // we got first char, yes. But what about second char?
-    (*c1) = (cc_data >> 8) - 0x20;
-    cc_data &= 0x00FF;
-
-    if (0x0020 <= cc_data && 0x0080 > cc_data) {
-      (*c2) = cc_data - 0x20;
-      return 2;
-    }
-
-    return 1;
-  }
-  // Check then strip second channel toggle
-  (*chan) = cc_data & 0x0800;
-  cc_data = cc_data & 0xF7FF;
-
-  if (eia608_is_specialna (cc_data)) {
-    // Special North American character
-    (*c1) = cc_data - 0x1130 + 0x60;
-    return 1;
-  }
-
-  if (0x1220 <= cc_data && 0x1240 > cc_data) {
-    // Extended Western European character set, Spanish/Miscellaneous/French
-    (*c1) = cc_data - 0x1220 + 0x70;
-    return 1;
-  }
+  uint32_t info = eia608_word_info (cc_data);
 
-  if (0x1320 <= cc_data && 0x1340 > cc_data) {
-    // Extended Western European character set, Portuguese/German/Danish
-    (*c1) = cc_data - 0x1320 + 0x90;
-    return 1;
-  }
+  (*chan) = (info & EIA608_WORD_CHANNEL) ? 0x0800 : 0;
+  (*c1) = eia608_word_index1 (info);
+  (*c2) = eia608_word_index2 (info);
 
-  return 0;
+  return (0 <= (*c2)) ? 2 : (0 <= (*c1)) ? 1 : 0;
 }
 
 int
@@ -231,6 +198,72 @@ eia608_from_utf8_2 (const utf8_char_t * c1, const utf8_char_t * c2)
   return eia608_from_basicna (cc1, cc2);
 }
 
+size_t
+eia608_from_utf8_string (const utf8_char_t * data, int chan,
+    uint16_t * cc_data)
+{
+  const uint16_t space = eia608_parity (0x2000);
+  uint16_t prev_char = 0;
+  size_t size = 0;
+
+  while (*data) {
+    uint16_t c = eia608_from_utf8_1 (data, chan);
+    size_t length = utf8_char_length (data);
+
+    // step over invalid bytes one at a time, without passing the terminator
+    for (size_t i = 1; i < length; ++i) {
+      if (!data[i]) {
+        length = 0;
+        break;
+      }
+    }
+    data += length ? length : 1;
+
+    if (0 == c) {
+      c = space;
+    }
+
+    if (prev_char) {
+      if (eia608_is_basicna (c)) {
+        cc_data[size++] = eia608_from_basicna (prev_char, c);
+      } else if (eia608_is_westeu (c)) {
+        cc_data[size++] = eia608_from_basicna (prev_char, space);
+        cc_data[size++] = c;
+      } else {
+        cc_data[size++] = prev_char;
+        cc_data[size++] = c;
+      }
+      prev_char = 0;
+    } else if (eia608_is_westeu (c)) {
+      cc_data[size++] = space;
+      cc_data[size++] = c;
+    } else if (eia608_is_basicna (c)) {
+      prev_char = c;
+    } else {
+      cc_data[size++] = c;
+    }
+  }
+
+  if (prev_char) {
+    cc_data[size++] = prev_char;
+  }
+
+  return size;
+}
+
+int
+eia608_utf8_to_index (const utf8_char_t * c)
+{
+  int chan, c1, c2;
+  uint16_t cc_data = _eia608_from_utf8 (c);
+
+  if (0 == cc_data || 0 == eia608_to_index (cc_data, &chan, &c1, &c2)) {
+    return -1;
+  }
+
+  return c1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 int
@@ -247,110 +280,131 @@ eia608_to_text (char *buf, ssize_t size, uint16_t cc_data)
     text = "parity failed";
   } else if (0 == eia608_parity_strip (cc_data)) {
     text = "pad";
-  } else if (eia608_is_basicna (cc_data)) {
-    text = "basicna";
-    eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
-  } else if (eia608_is_specialna (cc_data)) {
-    text = "specialna";
-    eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
-  } else if (eia608_is_westeu (cc_data)) {
-    text = "westeu";
-    eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
-  } else if (eia608_is_xds (cc_data)) {
-    text = "xds";
-  } else if (eia608_is_midrowchange (cc_data)) {
-    text = "midrowchange";
-  } else if (eia608_is_norpak (cc_data)) {
-    text = "norpak";
-  } else if (eia608_is_preamble (cc_data)) {
-    eia608_parse_preamble (cc_data, &row, &col, &style, &chan, &underline);
-    ret = snprintf(buf, size, "cc %04X (%04X) '%s' '%s' (preamble: row: %d col: %d style: %d chan: %d underline: %d)",
-        cc_data, eia608_parity_strip (cc_data), char1, char2, row, col, style, chan, underline);
-  } else if (eia608_is_control (cc_data)) {
-    switch (eia608_parse_control (cc_data, &chan)) {
-
-      default:
-        text = "unknown_control";
+  } else {
+    switch (eia608_word_class (eia608_word_info (cc_data))) {
+      case eia608_word_basicna:
+        text = "basicna";
+        eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
         break;
 
-      case eia608_tab_offset_0:
-        text = "eia608_tab_offset_0";
+      case eia608_word_specialna:
+        text = "specialna";
+        eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
         break;
 
-      case eia608_tab_offset_1:
-        text = "eia608_tab_offset_1";
+      case eia608_word_westeu:
+        text = "westeu";
+        eia608_to_utf8 (cc_data, &chan, &char1[0], &char2[0]);
         break;
 
-      case eia608_tab_offset_2:
-        text = "eia608_tab_offset_2";
+      case eia608_word_xds:
+        text = "xds";
         break;
 
-      case eia608_tab_offset_3:
-        text = "eia608_tab_offset_3";
+      case eia608_word_midrowchange:
+        text = "midrowchange";
         break;
 
-      case eia608_control_resume_caption_loading:
-        text = "eia608_control_resume_caption_loading";
+      case eia608_word_preamble:
+        eia608_parse_preamble (cc_data, &row, &col, &style, &chan, &underline);
+        ret = snprintf(buf, size, "cc %04X (%04X) '%s' '%s' (preamble: row: %d col: %d style: %d chan: %d underline: %d)",
+            cc_data, eia608_parity_strip (cc_data), char1, char2, row, col, style, chan, underline);
         break;
 
-      case eia608_control_backspace:
-        text = "eia608_control_backspace";
-        break;
+      case eia608_word_control:
+        if (eia608_is_norpak (cc_data)) {
+          text = "norpak";
+          break;
+        }
 
-      case eia608_control_alarm_off:
-        text = "eia608_control_alarm_off";
-        break;
+        switch (eia608_parse_control (cc_data, &chan)) {
 
-      case eia608_control_alarm_on:
-        text = "eia608_control_alarm_on";
-        break;
+          default:
+            text = "unknown_control";
+            break;
 
-      case eia608_control_delete_to_end_of_row:
-        text = "eia608_control_delete_to_end_of_row";
-        break;
+          case eia608_tab_offset_0:
+            text = "eia608_tab_offset_0";
+            break;
 
-      case eia608_control_roll_up_2:
-        text = "eia608_control_roll_up_2";
-        break;
+          case eia608_tab_offset_1:
+            text = "eia608_tab_offset_1";
+            break;
 
-      case eia608_control_roll_up_3:
-        text = "eia608_control_roll_up_3";
-        break;
+          case eia608_tab_offset_2:
+            text = "eia608_tab_offset_2";
+            break;
 
-      case eia608_control_roll_up_4:
-        text = "eia608_control_roll_up_4";
-        break;
+          case eia608_tab_offset_3:
+            text = "eia608_tab_offset_3";
+            break;
 
-      case eia608_control_resume_direct_captioning:
-        text = "eia608_control_resume_direct_captioning";
-        break;
+          case eia608_control_resume_caption_loading:
+            text = "eia608_control_resume_caption_loading";
+            break;
 
-      case eia608_control_text_restart:
-        text = "eia608_control_text_restart";
-        break;
+          case eia608_control_backspace:
+            text = "eia608_control_backspace";
+            break;
 
-      case eia608_control_text_resume_text_display:
-        text = "eia608_control_text_resume_text_display";
-        break;
+          case eia608_control_alarm_off:
+            text = "eia608_control_alarm_off";
+            break;
 
-      case eia608_control_erase_display_memory:
-        text = "eia608_control_erase_display_memory";
-        break;
+          case eia608_control_alarm_on:
+            text = "eia608_control_alarm_on";
+            break;
 
-      case eia608_control_carriage_return:
-        text = "eia608_control_carriage_return";
-        break;
+          case eia608_control_delete_to_end_of_row:
+            text = "eia608_control_delete_to_end_of_row";
+            break;
+
+          case eia608_control_roll_up_2:
+            text = "eia608_control_roll_up_2";
+            break;
+
+          case eia608_control_roll_up_3:
+            text = "eia608_control_roll_up_3";
+            break;
+
+          case eia608_control_roll_up_4:
+            text = "eia608_control_roll_up_4";
+            break;
+
+          case eia608_control_resume_direct_captioning:
+            text = "eia608_control_resume_direct_captioning";
+            break;
 
-      case eia608_control_erase_non_displayed_memory:
-        text = "eia608_control_erase_non_displayed_memory";
+          case eia608_control_text_restart:
+            text = "eia608_control_text_restart";
+            break;
+
+          case eia608_control_text_resume_text_display:
+            text = "eia608_control_text_resume_text_display";
+            break;
+
+          case eia608_control_erase_display_memory:
+            text = "eia608_control_erase_display_memory";
+            break;
+
+          case eia608_control_carriage_return:
+            text = "eia608_control_carriage_return";
+            break;
+
+          case eia608_control_erase_non_displayed_memory:
+            text = "eia608_control_erase_non_displayed_memory";
+            break;
+
+          case eia608_control_end_of_caption:
+            text = "eia608_control_end_of_caption";
+            break;
+        }
         break;
 
-      case eia608_control_end_of_caption:
-        text = "eia608_control_end_of_caption";
+      default:
+        text = "unhandled";
         break;
     }
-  } else {
-    text = "unhandled";
   }
 
   if (text != 0) {
@@ -116,6 +116,47 @@ static inline int eia608_is_norpak(uint16_t cc_data) { return 0x1724 == (0x777C
 */
 static inline int eia608_is_padding(uint16_t cc_data) { return 0x8080 == cc_data; }
 
+////////////////////////////////////////////////////////////////////////////////
+// word table
+typedef enum {
+    eia608_word_other = 0,
+    eia608_word_xds = 1,
+    eia608_word_control = 2,
+    eia608_word_basicna = 3,
+    eia608_word_specialna = 4,
+    eia608_word_westeu = 5,
+    eia608_word_preamble = 6,
+    eia608_word_midrowchange = 7,
+} eia608_word_class_t;
+
+#define EIA608_WORD_CLASS 0x0F
+#define EIA608_WORD_CHANNEL 0x10
+#define EIA608_WORD_PARITY 0x20
+#define EIA608_WORD_INDEX1_SHIFT 8
+#define EIA608_WORD_INDEX2_SHIFT 16
+
+// One entry per word, generated by eia608_table_gen.c at build time
+extern const uint32_t eia608_word_table[65536];
+/*! \brief Returns the table entry of a word
+    \param cc_data word including parity bits
+    The entry holds the class the eia608_is_*() functions give in the order caption_frame_decode() tests them,
+    EIA608_WORD_CHANNEL for the second channel, EIA608_WORD_PARITY if the parity is valid and the
+    eia608_char_map indices plus one of its charcters after EIA608_WORD_INDEX1_SHIFT and EIA608_WORD_INDEX2_SHIFT
+*/
+static inline uint32_t eia608_word_info(uint16_t cc_data) { return eia608_word_table[cc_data]; }
+/*! \brief Returns the class of a word
+    \param info entry returned by eia608_word_info()
+*/
+static inline eia608_word_class_t eia608_word_class(uint32_t info) { return (eia608_word_class_t)(info & EIA608_WORD_CLASS); }
+/*! \brief Returns the eia608_char_map index of the first charcter of a word, -1 if none
+    \param info entry returned by eia608_word_info()
+*/
+static inline int eia608_word_index1(uint32_t info) { return (int)((info >> EIA608_WORD_INDEX1_SHIFT) & 0xFF) - 1; }
+/*! \brief Returns the eia608_char_map index of the second charcter of a word, -1 if none
+    \param info entry returned by eia608_word_info()
+*/
+static inline int eia608_word_index2(uint32_t info) { return (int)((info >> EIA608_WORD_INDEX2_SHIFT) & 0xFF) - 1; }
+
 ////////////////////////////////////////////////////////////////////////////////
 // preamble
 typedef enum {
@@ -199,10 +240,29 @@ uint16_t eia608_from_utf8_2(const utf8_char_t* c1, const utf8_char_t* c2);
     \param
 */
 uint16_t eia608_from_basicna(uint16_t bna1, uint16_t bna2);
+/*! \brief Encodes a line of utf8 text, pairing consecutive basic North American charcters in one word
+    \param data NULL terminated utf8 text
+    \param chan Channel of the special and extended charcters
+    \param cc_data Receives the words, must have room for twice as many words as data has charcters, twice its size in bytes is always enough
+    \return The number of words written
+    An extended charcter replaces the previous one, so a space is written before each of them. Charcters
+    that can not be encoded are written as spaces.
+*/
+size_t eia608_from_utf8_string(const utf8_char_t* data, int chan, uint16_t* cc_data);
 /*! \brief
     \param
 */
 int eia608_to_utf8(uint16_t c, int* chan, utf8_char_t* char1, utf8_char_t* char2);
+/*! \brief Returns the eia608_char_map indices of the charcters of a text word
+    \param c1 Index of the first character, -1 if none
+    \param c2 Index of the second character, -1 if none
+    \return The number of characters
+*/
+int eia608_to_index(uint16_t cc_data, int* chan, int* c1, int* c2);
+/*! \brief Returns the eia608_char_map index of a utf8 character, -1 if it can not be encoded
+    \param c pointer to a single utf8 charcter
+*/
+int eia608_utf8_to_index(const utf8_char_t* c);
 ////////////////////////////////////////////////////////////////////////////////
 /*! \brief
     \param
@@ -0,0 +1,124 @@
+/**********************************************************************************************/
+/* SPDX-License-Identifier: MIT                                                               */
+/*                                                                                            */
+/* Generates eia608_word_table, see eia608_word_info() in eia608.h. Run by build.rs, with the */
+/* path of the C file to write as its only argument.                                          */
+/**********************************************************************************************/
+#include "eia608.h"
+#include <stdio.h>
+
+// The class of a word, tested in the same order as caption_frame_decode()
+static eia608_word_class_t
+eia608_classify (uint16_t cc_data)
+{
+  if (eia608_is_xds (cc_data)) {
+    return eia608_word_xds;
+  } else if (eia608_is_control (cc_data)) {
+    return eia608_word_control;
+  } else if (eia608_is_basicna (cc_data)) {
+    return eia608_word_basicna;
+  } else if (eia608_is_specialna (cc_data)) {
+    return eia608_word_specialna;
+  } else if (eia608_is_westeu (cc_data)) {
+    return eia608_word_westeu;
+  } else if (eia608_is_preamble (cc_data)) {
+    return eia608_word_preamble;
+  } else if (eia608_is_midrowchange (cc_data)) {
+    return eia608_word_midrowchange;
+  }
+
+  return eia608_word_other;
+}
+
+// The eia608_char_map indices of the charcters of a word, whatever its class
+static void
+eia608_classify_index (uint16_t cc_data, int *chan, int *c1, int *c2)
+{
+  (*c1) = (*c2) = -1;
+  (*chan) = 0;
+  cc_data &= 0x7F7F;            // strip off parity bits
+
+  // Handle Basic NA BEFORE we strip the channel bit
+  if (eia608_is_basicna (cc_data)) {
+    (*c1) = (cc_data >> 8) - 0x20;
+    cc_data &= 0x00FF;
+
+    if (0x0020 <= cc_data && 0x0080 > cc_data) {
+      (*c2) = cc_data - 0x20;
+    }
+
+    return;
+  }
+  // Check then strip second channel toggle
+  (*chan) = cc_data & 0x0800;
+  cc_data = cc_data & 0xF7FF;
+
+  if (eia608_is_specialna (cc_data)) {
+    // Special North American character
+    (*c1) = cc_data - 0x1130 + 0x60;
+  } else if (0x1220 <= cc_data && 0x1240 > cc_data) {
+    // Extended Western European character set, Spanish/Miscellaneous/French
+    (*c1) = cc_data - 0x1220 + 0x70;
+  } else if (0x1320 <= cc_data && 0x1340 > cc_data) {
+    // Extended Western European character set, Portuguese/German/Danish
+    (*c1) = cc_data - 0x1320 + 0x90;
+  }
+}
+
+static uint32_t
+eia608_classify_word (uint16_t cc_data)
+{
+  int chan, c1, c2;
+  uint32_t info = eia608_classify (cc_data);
+
+  eia608_classify_index (cc_data, &chan, &c1, &c2);
+
+  if (chan) {
+    info |= EIA608_WORD_CHANNEL;
+  }
+
+  if (eia608_parity_varify (cc_data)) {
+    info |= EIA608_WORD_PARITY;
+  }
+
+  info |= (uint32_t) (c1 + 1) << EIA608_WORD_INDEX1_SHIFT;
+  info |= (uint32_t) (c2 + 1) << EIA608_WORD_INDEX2_SHIFT;
+
+  return info;
+}
+
+int
+main (int argc, char **argv)
+{
+  FILE *file;
+
+  if (2 != argc) {
+    fprintf (stderr, "usage: %s <eia608_table.c>\n", argv[0]);
+    return 1;
+  }
+
+  file = fopen (argv[1], "w");
+  if (!file) {
+    perror (argv[1]);
+    return 1;
+  }
+
+  fprintf (file, "// Generated by eia608_table_gen.c, do not edit\n");
+  fprintf (file, "#include <stdint.h>\n\n");
+  fprintf (file, "const uint32_t eia608_word_table[65536] = {\n");
+
+  for (uint32_t cc_data = 0; cc_data <= 0xFFFF; ++cc_data) {
+    fprintf (file, "%s0x%08X,%s", 0 == cc_data % 8 ? "  " : " ",
+        eia608_classify_word ((uint16_t) cc_data),
+        7 == cc_data % 8 ? "\n" : "");
+  }
+
+  fprintf (file, "};\n");
+
+  if (fclose (file)) {
+    perror (argv[1]);
+    return 1;
+  }
+
+  return 0;
+}
@@ -7,9 +7,10 @@
 // SPDX-License-Identifier: MPL-2.0
 
 use super::ffi;
+use crate::ttutils::TextStyle;
 use std::mem;
 
-#[derive(Copy, Clone, Debug)]
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
 #[allow(unused)]
 pub enum Status {
     Ok,
@@ -17,10 +18,47 @@ pub enum Status {
     Clear,
 }
 
-#[derive(Copy, Clone, Debug)]
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
 pub struct Error;
 
-pub struct CaptionFrame(ffi::caption_frame_t);
+// The frame and the events of the last `decode_buffer()` call
+pub struct CaptionFrame(ffi::caption_frame_t, Vec<ffi::caption_frame_event_t>);
+
+fn status_from_ffi(status: ffi::libcaption_stauts_t) -> Result<Status, Error> {
+    match status {
+        ffi::libcaption_stauts_t_LIBCAPTION_OK => Ok(Status::Ok),
+        ffi::libcaption_stauts_t_LIBCAPTION_READY => Ok(Status::Ready),
+        ffi::libcaption_stauts_t_LIBCAPTION_CLEAR => Ok(Status::Clear),
+        _ => Err(Error),
+    }
+}
+
+fn frame_to_text_into(
+    frame: &ffi::caption_frame_t,
+    full: bool,
+    text: &mut String,
+) -> Result<(), Error> {
+    text.clear();
+    text.reserve(ffi::CAPTION_FRAME_TEXT_BYTES as usize);
+
+    unsafe {
+        let data = text.as_mut_vec();
+
+        let len = ffi::caption_frame_to_text(
+            frame as *const _ as *mut _,
+            data.as_mut_ptr() as *mut _,
+            i32::from(full),
+        );
+        data.set_len(len);
+
+        if std::str::from_utf8(data).is_err() {
+            data.clear();
+            return Err(Error);
+        }
+    }
+
+    Ok(())
+}
 
 unsafe impl Send for CaptionFrame {}
 unsafe impl Sync for CaptionFrame {}
@@ -30,42 +68,458 @@ impl CaptionFrame {
         unsafe {
             let mut frame = mem::MaybeUninit::uninit();
             ffi::caption_frame_init(frame.as_mut_ptr());
-            Self(frame.assume_init())
+            Self(frame.assume_init(), Vec::new())
         }
     }
 
     #[allow(unused)]
     pub fn decode(&mut self, cc_data: u16, timestamp: f64) -> Result<Status, Error> {
+        unsafe { status_from_ffi(ffi::caption_frame_decode(&mut self.0, cc_data, timestamp)) }
+    }
+
+    // Decodes all the words like `decode()` would, returns the index and result of the words
+    // that didn't decode to `Status::Ok`
+    pub fn decode_buffer(
+        &mut self,
+        cc_data: &[u16],
+        timestamp: f64,
+    ) -> impl Iterator<Item = (usize, Result<Status, Error>)> + '_ {
+        self.1.clear();
+        self.1.reserve(cc_data.len());
+
         unsafe {
-            let res = ffi::caption_frame_decode(&mut self.0, cc_data, timestamp);
-            match res {
-                ffi::libcaption_stauts_t_LIBCAPTION_OK => Ok(Status::Ok),
-                ffi::libcaption_stauts_t_LIBCAPTION_READY => Ok(Status::Ready),
-                ffi::libcaption_stauts_t_LIBCAPTION_CLEAR => Ok(Status::Clear),
-                _ => Err(Error),
-            }
+            let len = ffi::caption_frame_decode_buffer(
+                &mut self.0,
+                cc_data.as_ptr(),
+                cc_data.len(),
+                timestamp,
+                self.1.as_mut_ptr(),
+            );
+            self.1.set_len(len);
         }
+
+        self.1
+            .iter()
+            .map(|event| (event.index, status_from_ffi(event.status)))
     }
 
     #[allow(unused)]
     pub fn to_text(&self, full: bool) -> Result<String, Error> {
-        unsafe {
-            let mut data = Vec::with_capacity(ffi::CAPTION_FRAME_TEXT_BYTES as usize);
+        let mut text = String::new();
+        self.to_text_into(full, &mut text)?;
 
-            let len = ffi::caption_frame_to_text(
-                &self.0 as *const _ as *mut _,
-                data.as_ptr() as *mut _,
-                i32::from(full),
-            );
-            data.set_len(len);
+        Ok(text)
+    }
+
+    // Like `to_text()` but reuses the allocation of `text`
+    pub fn to_text_into(&self, full: bool, text: &mut String) -> Result<(), Error> {
+        frame_to_text_into(&self.0, full, text)
+    }
 
-            String::from_utf8(data).map_err(|_| Error)
+    // Increases whenever a displayed row changes
+    pub fn generation(&self) -> u32 {
+        self.0.generation
+    }
+
+    // Mask of the displayed rows changed after `generation`, 0 for all the rows changed
+    // since creation
+    pub fn changed_rows(&self, generation: u32) -> u16 {
+        unsafe { ffi::caption_frame_changed_rows(&self.0 as *const _ as *mut _, generation) }
+    }
+
+    // Writes the displayed characters of the rows in the `rows` mask into `runs`
+    pub fn to_runs(&self, rows: u16, runs: &mut StyledRuns) {
+        unsafe {
+            ffi::caption_frame_to_runs(&self.0 as *const _ as *mut _, rows, &mut *runs.0);
         }
     }
 }
 
+// Displayed characters of a row that follow each other and share their style
+#[derive(Copy, Clone, Debug)]
+pub struct StyledRun<'a> {
+    pub row: u32,
+    pub col: u32,
+    pub style: TextStyle,
+    pub underline: bool,
+    pub text: &'a str,
+}
+
+// Output of `CaptionFrame::to_runs()`, meant to be reused between calls
+pub struct StyledRuns(Box<ffi::caption_frame_runs_t>);
+
+impl StyledRuns {
+    pub fn new() -> Self {
+        // Safety: the struct only holds integers
+        unsafe { Self(Box::new(mem::zeroed())) }
+    }
+
+    // Runs in row and column order
+    pub fn iter(&self) -> impl Iterator<Item = StyledRun<'_>> {
+        let runs = &*self.0;
+        let text =
+            unsafe { std::slice::from_raw_parts(runs.text.as_ptr() as *const u8, runs.text.len()) };
+
+        runs.run[..runs.count].iter().map(move |run| {
+            let offset = run.offset as usize;
+            let text = &text[offset..offset + run.size as usize];
+
+            StyledRun {
+                row: run.row as u32,
+                col: run.col as u32,
+                style: TextStyle::from(run.style as u32),
+                underline: run.underline != 0,
+                // Safety: runs only hold whole characters of the charmap, which is valid UTF-8
+                text: unsafe { std::str::from_utf8_unchecked(text) },
+            }
+        })
+    }
+}
+
+impl Default for StyledRuns {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
 impl Default for CaptionFrame {
     fn default() -> Self {
         Self::new()
     }
 }
+
+// CC1 and CC2 are carried by field 1, CC3, CC4 and XDS by field 2
+#[derive(Copy, Clone, Debug, PartialEq, Eq)]
+pub enum Channel {
+    Cc1,
+    Cc2,
+    Cc3,
+    Cc4,
+    Xds,
+}
+
+impl Channel {
+    pub const CAPTIONS: [Channel; 4] = [Channel::Cc1, Channel::Cc2, Channel::Cc3, Channel::Cc4];
+
+    fn from_ffi(channel: ffi::caption_channel_t) -> Option<Self> {
+        match channel {
+            ffi::caption_channel_t_caption_channel_cc1 => Some(Channel::Cc1),
+            ffi::caption_channel_t_caption_channel_cc2 => Some(Channel::Cc2),
+            ffi::caption_channel_t_caption_channel_cc3 => Some(Channel::Cc3),
+            ffi::caption_channel_t_caption_channel_cc4 => Some(Channel::Cc4),
+            ffi::caption_channel_t_caption_channel_xds => Some(Channel::Xds),
+            _ => None,
+        }
+    }
+
+    // Index of a caption channel in `Channel::CAPTIONS`
+    pub fn index(self) -> usize {
+        assert_ne!(self, Channel::Xds);
+        self as usize
+    }
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Channel::Cc1 => "cc1",
+            Channel::Cc2 => "cc2",
+            Channel::Cc3 => "cc3",
+            Channel::Cc4 => "cc4",
+            Channel::Xds => "xds",
+        }
+    }
+}
+
+// One frame for each caption channel and the XDS state, decoded in a single pass over the
+// words of a field, and the events of the last `decode()` call
+pub struct CaptionChannels(
+    Box<ffi::caption_channels_t>,
+    Vec<ffi::caption_channels_event_t>,
+);
+
+unsafe impl Send for CaptionChannels {}
+unsafe impl Sync for CaptionChannels {}
+
+impl CaptionChannels {
+    pub fn new() -> Self {
+        unsafe {
+            // Safety: zeroed is a valid value for the struct, which is then initialized
+            let mut channels = Box::<ffi::caption_channels_t>::new(mem::zeroed());
+            ffi::caption_channels_init(&mut *channels);
+            Self(channels, Vec::new())
+        }
+    }
+
+    // The channel of a word of `field`, 0 or 1, or `None` for padding and invalid words.
+    // Updates the channel selected for the following words without decoding them
+    pub fn route(&mut self, field: u8, cc_data: u16) -> Option<Channel> {
+        unsafe {
+            Channel::from_ffi(ffi::caption_channels_route(
+                &mut *self.0,
+                i32::from(field),
+                cc_data,
+            ))
+        }
+    }
+
+    // Decodes the words of `field`, 0 or 1, into their channels. Returns the index, channel and
+    // result of the words that didn't decode to `Status::Ok`, the channel is `None` for words
+    // with invalid parity
+    pub fn decode(
+        &mut self,
+        field: u8,
+        cc_data: &[u16],
+        timestamp: f64,
+    ) -> impl Iterator<Item = (usize, Option<Channel>, Result<Status, Error>)> + '_ {
+        self.1.clear();
+        self.1.reserve(cc_data.len());
+
+        unsafe {
+            let len = ffi::caption_channels_decode(
+                &mut *self.0,
+                i32::from(field),
+                cc_data.as_ptr(),
+                cc_data.len(),
+                timestamp,
+                self.1.as_mut_ptr(),
+            );
+            self.1.set_len(len);
+        }
+
+        self.1.iter().map(|event| {
+            (
+                event.index,
+                Channel::from_ffi(event.channel),
+                status_from_ffi(event.status),
+            )
+        })
+    }
+
+    // Like `CaptionFrame::to_text_into()` for the frame of a caption channel
+    pub fn to_text_into(
+        &self,
+        channel: Channel,
+        full: bool,
+        text: &mut String,
+    ) -> Result<(), Error> {
+        frame_to_text_into(&self.0.frame[channel.index()], full, text)
+    }
+}
+
+impl Default for CaptionChannels {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::ffi::CString;
+
+    const PADDING: u16 = 0x8080;
+
+    fn control(cmd: ffi::eia608_control_t) -> [u16; 2] {
+        let word = unsafe { ffi::eia608_control_command(cmd, 0) };
+        [word, word]
+    }
+
+    fn preamble(row: i32, col: i32) -> [u16; 2] {
+        let word = unsafe { ffi::eia608_row_column_pramble(row, col, 0, 0) };
+        [word, word]
+    }
+
+    fn text(text: &str) -> Vec<u16> {
+        let text = CString::new(text).unwrap();
+        let mut words = vec![0; 2 * text.as_bytes().len()];
+        let len = unsafe { ffi::eia608_from_utf8_string(text.as_ptr(), 0, words.as_mut_ptr()) };
+        words.truncate(len);
+        words
+    }
+
+    // Everything a frame decodes to, but the XDS state
+    fn frame_state(frame: &CaptionFrame) -> Vec<u8> {
+        let frame = &frame.0;
+        let mut state = vec![
+            frame.state.uln,
+            frame.state.sty,
+            frame.state.rup,
+            frame.state.row as u8,
+            frame.state.col as u8,
+            u8::from(frame.write == &frame.back as *const _ as *mut _),
+        ];
+        state.extend(frame.state.cc_data.to_be_bytes());
+        state.extend(frame.status.to_be_bytes());
+        state.extend(frame.generation.to_be_bytes());
+        for generation in frame.row_generation {
+            state.extend(generation.to_be_bytes());
+        }
+        for buffer in [&frame.front, &frame.back] {
+            for cell in buffer.cell.iter().flatten() {
+                state.extend([cell.chr, cell.attr]);
+            }
+        }
+
+        state
+    }
+
+    #[test]
+    fn test_decode_buffer() {
+        // Padding blocks, doubled controls, words and blocks with parity errors, in pop-on,
+        // roll-up and paint-on modes
+        let mut words = vec![PADDING; 4];
+        words.extend(control(
+            ffi::eia608_control_t_eia608_control_resume_caption_loading,
+        ));
+        words.extend(preamble(13, 0));
+        words.extend(text("Hello"));
+        words.extend([
+            PADDING,
+            control(ffi::eia608_control_t_eia608_control_backspace)[0] ^ 0x8000,
+        ]);
+        words.extend(preamble(14, 4));
+        words.extend(text("world!"));
+        words.extend(control(ffi::eia608_control_t_eia608_control_end_of_caption));
+        words.extend([PADDING; 8]);
+        words.extend(text("Bad parity").iter().map(|word| word & 0x7f7f));
+        words.extend(control(ffi::eia608_control_t_eia608_control_roll_up_2));
+        words.extend(control(
+            ffi::eia608_control_t_eia608_control_carriage_return,
+        ));
+        words.extend(preamble(14, 0));
+        words.extend(text("Rolling"));
+        words.extend(control(
+            ffi::eia608_control_t_eia608_control_carriage_return,
+        ));
+        words.extend(text("up"));
+        words.extend(control(
+            ffi::eia608_control_t_eia608_control_erase_display_memory,
+        ));
+        words.extend(control(
+            ffi::eia608_control_t_eia608_control_resume_direct_captioning,
+        ));
+        words.extend(preamble(1, 8));
+        words.extend(text("Painted"));
+        words.extend([PADDING; 3]);
+
+        // Every alignment of the words with the blocks of decode_buffer()
+        for offset in 0..4 {
+            let mut cc_data = vec![PADDING; offset];
+            cc_data.extend(&words);
+
+            let mut expected_frame = CaptionFrame::new();
+            let expected_events = cc_data
+                .iter()
+                .enumerate()
+                .map(|(i, word)| (i, expected_frame.decode(*word, 1.0)))
+                .filter(|(_, status)| *status != Ok(Status::Ok))
+                .collect::<Vec<_>>();
+
+            let mut frame = CaptionFrame::new();
+            let events = frame.decode_buffer(&cc_data, 1.0).collect::<Vec<_>>();
+
+            assert_eq!(events, expected_events, "offset {}", offset);
+            assert_eq!(
+                frame_state(&frame),
+                frame_state(&expected_frame),
+                "offset {}",
+                offset
+            );
+            for status in [Ok(Status::Ready), Ok(Status::Clear), Err(Error)] {
+                assert!(
+                    events.iter().any(|(_, event)| *event == status),
+                    "no {:?} event",
+                    status
+                );
+            }
+            assert_eq!(
+                frame.to_text(true).unwrap(),
+                expected_frame.to_text(true).unwrap()
+            );
+        }
+    }
+
+    #[test]
+    fn test_changed_rows() {
+        fn decode(frame: &mut CaptionFrame, words: &[u16]) {
+            for word in words {
+                frame.decode(*word, 0.0).unwrap();
+            }
+        }
+
+        // Returns the mask of the rows changed since `generation` and moves it to the current
+        // generation
+        fn changed_rows(frame: &CaptionFrame, generation: &mut u32) -> u16 {
+            let rows = frame.changed_rows(*generation);
+            *generation = frame.generation();
+            rows
+        }
+
+        const ROWS_13_14: u16 = 1 << 13 | 1 << 14;
+        let mut frame = CaptionFrame::new();
+        let mut generation = 0;
+
+        // Loading a pop-on caption doesn't change the displayed rows, ending it does
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_resume_caption_loading),
+        );
+        decode(&mut frame, &preamble(13, 0));
+        decode(&mut frame, &text("Hi"));
+        decode(&mut frame, &preamble(14, 0));
+        decode(&mut frame, &text("Yo"));
+        assert_eq!(changed_rows(&frame, &mut generation), 0);
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_end_of_caption),
+        );
+        assert_eq!(changed_rows(&frame, &mut generation), ROWS_13_14);
+
+        // Only the rows that differ from the displayed ones change
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_resume_caption_loading),
+        );
+        decode(&mut frame, &preamble(13, 0));
+        decode(&mut frame, &text("Hi"));
+        decode(&mut frame, &preamble(14, 0));
+        decode(&mut frame, &text("Ya"));
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_end_of_caption),
+        );
+        assert_eq!(changed_rows(&frame, &mut generation), 1 << 14);
+
+        // Rewriting the displayed characters changes nothing
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_resume_direct_captioning),
+        );
+        decode(&mut frame, &preamble(14, 0));
+        decode(&mut frame, &text("Ya"));
+        assert_eq!(changed_rows(&frame, &mut generation), 0);
+
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_erase_display_memory),
+        );
+        assert_eq!(changed_rows(&frame, &mut generation), ROWS_13_14);
+
+        // A carriage return moves the rows of the roll-up window
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_roll_up_2),
+        );
+        decode(&mut frame, &preamble(14, 0));
+        decode(&mut frame, &text("AB"));
+        assert_eq!(changed_rows(&frame, &mut generation), 1 << 14);
+        decode(
+            &mut frame,
+            &control(ffi::eia608_control_t_eia608_control_carriage_return),
+        );
+        assert_eq!(changed_rows(&frame, &mut generation), ROWS_13_14);
+        assert_eq!(frame.to_text(false).unwrap(), "AB");
+
+        // Every row changed since creation
+        assert_eq!(frame.changed_rows(0), ROWS_13_14);
+    }
+}
@@ -6,8 +6,11 @@
 //
 // SPDX-License-Identifier: MPL-2.0
 
+use crate::ffi;
 use byteorder::{BigEndian, ByteOrder};
 use std::fmt;
+use std::marker::PhantomData;
+use std::mem;
 
 #[allow(clippy::enum_variant_names)]
 #[derive(Debug, Clone, Copy)]
@@ -15,6 +18,7 @@ pub enum ParseErrorCode {
     WrongLength,
     WrongMagicSequence,
     WrongLayout,
+    WrongChecksum,
 }
 
 #[derive(Debug, Clone)]
@@ -26,6 +30,7 @@ pub struct ParseError {
 
 pub fn extract_cdp(mut data: &[u8]) -> Result<&[u8], ParseError> {
     /* logic from ccconverter */
+    let cdp = data;
     let data_len = data.len();
 
     if data.len() < 11 {
@@ -61,6 +66,15 @@ pub fn extract_cdp(mut data: &[u8]) -> Result<&[u8], ParseError> {
     }
     data = &data[1..];
 
+    /* the checksum ending the footer makes the sum of all the bytes a multiple of 256 */
+    if cdp.iter().fold(0u8, |sum, byte| sum.wrapping_add(*byte)) != 0 {
+        return Err(ParseError {
+            code: ParseErrorCode::WrongChecksum,
+            byte: data_len - 1,
+            msg: String::from("cdp packet has an invalid checksum"),
+        });
+    }
+
     /* skip framerate value */
     data = &data[1..];
 
@@ -129,11 +143,85 @@ pub fn extract_cdp(mut data: &[u8]) -> Result<&[u8], ParseError> {
         });
     }
 
-    /* TODO: validate checksum */
-
     Ok(&data[..len])
 }
 
+// cc_data triples demuxed in place by the C core: the CEA-608 words of each field, ready for
+// `CaptionFrame::decode_buffer()` and `CaptionChannels::decode()`, and the DTVCC triples
+pub struct CcData<'a> {
+    cc: ffi::cc_data_t,
+    phantom: PhantomData<&'a [u8]>,
+}
+
+impl<'a> CcData<'a> {
+    // Demuxes at most 31 triples, CEA-608 triples after the first valid DTVCC one are dropped
+    pub fn demux(data: &'a [u8]) -> Self {
+        unsafe {
+            // Safety: the struct only holds integers and a nullable pointer
+            let mut cc: ffi::cc_data_t = mem::zeroed();
+            ffi::cc_data_demux(&mut cc, data.as_ptr(), data.len());
+
+            Self {
+                cc,
+                phantom: PhantomData,
+            }
+        }
+    }
+
+    // Demuxes the cc_data section of a CDP, like `demux(extract_cdp(cdp)?)`
+    pub fn demux_cdp(cdp: &'a [u8]) -> Result<Self, ParseError> {
+        let (status, cc) = unsafe {
+            let mut cc: ffi::cc_data_t = mem::zeroed();
+            let status = ffi::cc_data_demux_cdp(&mut cc, cdp.as_ptr(), cdp.len());
+
+            (status, cc)
+        };
+
+        match status {
+            ffi::cc_data_status_t_CC_DATA_OK => Ok(Self {
+                cc,
+                phantom: PhantomData,
+            }),
+            ffi::cc_data_status_t_CC_DATA_WRONG_LENGTH => Err(ParseError {
+                code: ParseErrorCode::WrongLength,
+                byte: cc.error_byte,
+                msg: String::from("cdp packet or its cc_data has an invalid length"),
+            }),
+            ffi::cc_data_status_t_CC_DATA_WRONG_CHECKSUM => Err(ParseError {
+                code: ParseErrorCode::WrongChecksum,
+                byte: cc.error_byte,
+                msg: String::from("cdp packet has an invalid checksum"),
+            }),
+            _ => Err(ParseError {
+                code: ParseErrorCode::WrongMagicSequence,
+                byte: cc.error_byte,
+                msg: String::from("cdp packet has invalid magic bytes"),
+            }),
+        }
+    }
+
+    // cc_data words of the valid triples of `field`, 0 or 1
+    pub fn cea608(&self, field: u8) -> &[u16] {
+        let field = field as usize;
+        &self.cc.cea608[field][..self.cc.cea608_count[field] as usize]
+    }
+
+    // Triples from the first valid DTVCC one on, valid or not
+    #[allow(unused)]
+    pub fn dtvcc(&self) -> &'a [u8] {
+        if self.cc.dtvcc.is_null() {
+            return &[];
+        }
+
+        unsafe {
+            std::slice::from_raw_parts(
+                self.cc.dtvcc,
+                self.cc.dtvcc_count as usize * ffi::CC_DATA_TRIPLE_BYTES as usize,
+            )
+        }
+    }
+}
+
 impl fmt::Display for ParseError {
     fn fmt(&self, f: &mut fmt::Formatter) -> fmt::Result {
         write!(f, "{:?} at byte {}: {}", self.code, self.byte, self.msg)
@@ -141,3 +229,91 @@ impl fmt::Display for ParseError {
 }
 
 impl std::error::Error for ParseError {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // CDP with cc_data for both fields, followed by a DTVCC packet start and its footer
+    const CDP: [u8; 22] = [
+        0x96, 0x69, 0x16, 0x4f, 0x43, 0x00, 0x01, 0x72, 0xe3, 0xfc, 0x94, 0x20, 0xfd, 0x80, 0x80,
+        0xff, 0x02, 0x21, 0x74, 0x00, 0x01, 0xbf,
+    ];
+
+    #[test]
+    fn test_demux_cdp() {
+        let cc_data = CcData::demux_cdp(&CDP).unwrap();
+
+        assert_eq!(cc_data.cea608(0), &[0x9420]);
+        assert_eq!(cc_data.cea608(1), &[0x8080]);
+        assert_eq!(cc_data.dtvcc(), &CDP[15..18]);
+        assert_eq!(
+            cc_data.dtvcc().as_ptr(),
+            CDP[15..].as_ptr(),
+            "DTVCC triples are not demuxed in place"
+        );
+        assert_eq!(
+            extract_cdp(&CDP).unwrap(),
+            &CDP[9..18],
+            "extract_cdp() disagrees on the cc_data section"
+        );
+    }
+
+    #[test]
+    fn test_demux_cdp_errors() {
+        assert!(matches!(
+            CcData::demux_cdp(&CDP[..10]),
+            Err(ParseError {
+                code: ParseErrorCode::WrongLength,
+                ..
+            })
+        ));
+
+        // Keep the sum of the bytes unchanged
+        let mut cdp = CDP;
+        cdp[7] -= 1;
+        cdp[21] += 1;
+        assert!(matches!(
+            CcData::demux_cdp(&cdp),
+            Err(ParseError {
+                code: ParseErrorCode::WrongMagicSequence,
+                byte: 7,
+                ..
+            })
+        ));
+
+        let mut cdp = CDP;
+        cdp[21] ^= 0x01;
+        assert!(matches!(
+            CcData::demux_cdp(&cdp),
+            Err(ParseError {
+                code: ParseErrorCode::WrongChecksum,
+                byte: 21,
+                ..
+            })
+        ));
+        assert!(matches!(
+            extract_cdp(&cdp),
+            Err(ParseError {
+                code: ParseErrorCode::WrongChecksum,
+                byte: 21,
+                ..
+            })
+        ));
+    }
+
+    #[test]
+    fn test_demux() {
+        // Invalid triples are skipped, also the DTVCC padding in front of CEA-608 ones, and
+        // CEA-608 triples after the first valid DTVCC one are dropped
+        let data = [
+            0xf8, 0x94, 0x20, 0xfc, 0x94, 0x2c, 0xfa, 0x00, 0x00, 0xfc, 0x94, 0x2c, 0xfd, 0x80,
+            0x80, 0xff, 0x02, 0x21, 0xfc, 0x80, 0x80,
+        ];
+        let cc_data = CcData::demux(&data);
+
+        assert_eq!(cc_data.cea608(0), &[0x942c, 0x942c]);
+        assert_eq!(cc_data.cea608(1), &[0x8080]);
+        assert_eq!(cc_data.dtvcc(), &data[15..]);
+    }
+}
@@ -13,12 +13,15 @@ use gst_video::prelude::*;
 
 use once_cell::sync::Lazy;
 
+use std::mem;
 use std::sync::Mutex;
 
 use pango::prelude::*;
 
-use crate::caption_frame::{CaptionFrame, Status};
-use crate::ccutils::extract_cdp;
+use crate::caption_frame::{CaptionFrame, Status, StyledRuns};
+use crate::ccutils::CcData;
+use crate::ffi;
+use crate::ttutils::TextStyle;
 
 static CAT: Lazy<gst::DebugCategory> = Lazy::new(|| {
     gst::DebugCategory::new(
@@ -28,6 +31,19 @@ static CAT: Lazy<gst::DebugCategory> = Lazy::new(|| {
     )
 });
 
+// Foreground color of the text in a style
+fn style_color(style: TextStyle) -> (u16, u16, u16) {
+    match style {
+        TextStyle::White | TextStyle::ItalicWhite => (0xffff, 0xffff, 0xffff),
+        TextStyle::Green => (0, 0xffff, 0),
+        TextStyle::Blue => (0, 0, 0xffff),
+        TextStyle::Cyan => (0, 0xffff, 0xffff),
+        TextStyle::Red => (0xffff, 0, 0),
+        TextStyle::Yellow => (0xffff, 0xffff, 0),
+        TextStyle::Magenta => (0xffff, 0, 0xffff),
+    }
+}
+
 const DEFAULT_FIELD: i32 = -1;
 const DEFAULT_BLACK_BACKGROUND: bool = false;
 
@@ -52,8 +68,19 @@ struct State {
     video_info: Option<gst_video::VideoInfo>,
     layout: Option<pango::Layout>,
     caption_frame: CaptionFrame,
+    // cc_data words of the selected field in the current buffer
+    cc_data: Vec<u16>,
+    // Caption frame generation the rows were rendered for
+    rendered_generation: u32,
+    // One rectangle per caption row, only the changed ones are rendered again
+    rows: [Option<gst_video::VideoOverlayRectangle>; ffi::SCREEN_ROWS as usize],
+    // Styled runs of the changed rows and the text of the row being rendered,
+    // kept around to not allocate them for every caption
+    runs: StyledRuns,
+    row_text: String,
     composition: Option<gst_video::VideoOverlayComposition>,
     left_alignment: i32,
+    line_height: i32,
     attach: bool,
     selected_field: Option<u8>,
     last_cc_pts: Option<gst::ClockTime>,
@@ -70,8 +97,14 @@ impl Default for State {
             video_info: None,
             layout: None,
             caption_frame: CaptionFrame::default(),
+            cc_data: Vec::new(),
+            rendered_generation: 0,
+            rows: Default::default(),
+            runs: StyledRuns::default(),
+            row_text: String::new(),
             composition: None,
             left_alignment: 0,
+            line_height: 0,
             attach: false,
             selected_field: None,
             last_cc_pts: gst::ClockTime::NONE,
@@ -126,31 +159,120 @@ impl Cea608Overlay {
             font_size += 1;
         }
 
-        if self.settings.lock().unwrap().black_background {
-            let attrs = pango::AttrList::new();
-            let attr = pango::AttrColor::new_background(0, 0, 0);
-            attrs.insert(attr);
-            layout.set_attributes(Some(&attrs));
-        }
+        layout.set_text("1");
+        let (_ink_rect, logical_rect) = layout.extents();
 
         state.left_alignment = left_alignment;
+        state.line_height = logical_rect.height() / pango::SCALE;
         state.layout = Some(layout);
 
+        // Everything has to be rendered again with the new layout
+        self.clear_overlay(state);
+        self.update_overlay(state);
+
         Ok(gst::FlowSuccess::Ok)
     }
 
-    fn overlay_text(&self, text: &str, state: &mut State) {
+    fn clear_overlay(&self, state: &mut State) {
+        state.rendered_generation = 0;
+        state.rows = Default::default();
+        state.composition = None;
+    }
+
+    // Renders again the rows of the caption frame which changed since the last
+    // rendering, nothing is done if no displayed row changed
+    fn update_overlay(&self, state: &mut State) {
+        if state.layout.is_none() {
+            return;
+        }
+
+        let changed_rows = state.caption_frame.changed_rows(state.rendered_generation);
+        if changed_rows == 0 {
+            return;
+        }
+        state.rendered_generation = state.caption_frame.generation();
+        state.caption_frame.to_runs(changed_rows, &mut state.runs);
+
+        let black_background = self.settings.lock().unwrap().black_background;
+        let mut text = mem::take(&mut state.row_text);
+        let mut runs = state.runs.iter().peekable();
+
+        for row in 0..ffi::SCREEN_ROWS {
+            if changed_rows & (1 << row) == 0 {
+                continue;
+            }
+
+            // Empty cells are left as spaces without attributes so that each run
+            // starts at its column in the monospace layout
+            text.clear();
+            let attrs = pango::AttrList::new();
+            let mut col = 0;
+            while let Some(run) = runs.next_if(|run| run.row == row) {
+                text.extend((col..run.col).map(|_| ' '));
+                let start = text.len() as u32;
+                text.push_str(run.text);
+                let end = text.len() as u32;
+                col = run.col + run.text.chars().count() as u32;
+
+                let (red, green, blue) = style_color(run.style);
+                let mut attr = pango::AttrColor::new_foreground(red, green, blue);
+                attr.set_start_index(start);
+                attr.set_end_index(end);
+                attrs.insert(attr);
+
+                if run.style == TextStyle::ItalicWhite {
+                    let mut attr = pango::AttrInt::new_style(pango::Style::Italic);
+                    attr.set_start_index(start);
+                    attr.set_end_index(end);
+                    attrs.insert(attr);
+                }
+
+                if run.underline {
+                    let mut attr = pango::AttrInt::new_underline(pango::Underline::Single);
+                    attr.set_start_index(start);
+                    attr.set_end_index(end);
+                    attrs.insert(attr);
+                }
+
+                if black_background {
+                    let mut attr = pango::AttrColor::new_background(0, 0, 0);
+                    attr.set_start_index(start);
+                    attr.set_end_index(end);
+                    attrs.insert(attr);
+                }
+            }
+
+            let rect = self.render_row(&text, &attrs, row, state);
+            state.rows[row as usize] = rect;
+        }
+
+        drop(runs);
+        state.row_text = text;
+
+        state.composition = gst_video::VideoOverlayComposition::from_rectangles(
+            state.rows.iter().flatten().cloned(),
+        )
+        .ok();
+    }
+
+    fn render_row(
+        &self,
+        text: &str,
+        attrs: &pango::AttrList,
+        row: u32,
+        state: &State,
+    ) -> Option<gst_video::VideoOverlayRectangle> {
         let video_info = state.video_info.as_ref().unwrap();
         let layout = state.layout.as_ref().unwrap();
         layout.set_text(text);
+        layout.set_attributes(Some(attrs));
         let (_ink_rect, logical_rect) = layout.extents();
         let height = logical_rect.height() / pango::SCALE;
         let width = logical_rect.width() / pango::SCALE;
 
         // No text actually needs rendering
         if width == 0 || height == 0 {
-            state.composition = None;
-            return;
+            return None;
         }
 
         let render_buffer = || -> Option<gst::Buffer> {
@@ -228,24 +350,21 @@ impl Cea608Overlay {
             Some(buffer) => buffer,
             None => {
                 gst::error!(CAT, imp: self, "Failed to render buffer");
-                state.composition = None;
-                return;
+                return None;
             }
         };
 
-        let rect = gst_video::VideoOverlayRectangle::new_raw(
+        // The rows are laid out as a block of SCREEN_ROWS lines centered vertically
+        let top = (video_info.height() as i32 - ffi::SCREEN_ROWS as i32 * state.line_height) / 2;
+
+        Some(gst_video::VideoOverlayRectangle::new_raw(
             &buffer,
             state.left_alignment,
-            (video_info.height() as i32 - height) / 2,
+            top + row as i32 * state.line_height,
             width as u32,
             height as u32,
             gst_video::VideoOverlayFormatFlags::PREMULTIPLIED_ALPHA,
-        );
-
-        state.composition = match gst_video::VideoOverlayComposition::new(Some(&rect)) {
-            Ok(composition) => Some(composition),
-            Err(_) => None,
-        };
+        ))
     }
 
     fn negotiate(&self, state: &mut State) -> Result<gst::FlowSuccess, gst::FlowError> {
@@ -294,70 +413,65 @@ impl Cea608Overlay {
         }
     }
 
-    fn decode_cc_data(&self, pad: &gst::Pad, state: &mut State, data: &[u8], pts: gst::ClockTime) {
-        if data.len() % 3 != 0 {
-            gst::warning!(CAT, "cc_data length is not a multiple of 3, truncating");
+    fn decode_cc_data(
+        &self,
+        pad: &gst::Pad,
+        state: &mut State,
+        cc_data: &CcData,
+        pts: gst::ClockTime,
+    ) {
+        if state.selected_field.is_none() {
+            if let Some(field) = (0..2).find(|field| !cc_data.cea608(*field).is_empty()) {
+                state.selected_field = Some(field);
+                gst::info!(CAT, imp: self, "Selected field {} automatically", field);
+            }
         }
 
-        for triple in data.chunks_exact(3) {
-            let cc_valid = (triple[0] & 0x04) == 0x04;
-            let cc_type = triple[0] & 0x03;
-
-            if cc_valid {
-                if cc_type == 0x00 || cc_type == 0x01 {
-                    if state.selected_field.is_none() {
-                        state.selected_field = Some(cc_type);
-                        gst::info!(CAT, imp: self, "Selected field {} automatically", cc_type);
-                    }
+        let words = match state.selected_field {
+            Some(field) if !cc_data.cea608(field).is_empty() => cc_data.cea608(field),
+            _ => return,
+        };
 
-                    if Some(cc_type) == state.selected_field {
-                        match state
-                            .caption_frame
-                            .decode((triple[1] as u16) << 8 | triple[2] as u16, 0.0)
-                        {
-                            Ok(Status::Ready) => {
-                                let text = match state.caption_frame.to_text(true) {
-                                    Ok(text) => text,
-                                    Err(_) => {
-                                        gst::error!(
-                                            CAT,
-                                            obj: pad,
-                                            "Failed to convert caption frame to text"
-                                        );
-                                        continue;
-                                    }
-                                };
-
-                                self.overlay_text(&text, state);
-                            }
-                            Ok(Status::Clear) => {
-                                self.overlay_text("", state);
-                            }
-                            Ok(Status::Ok) => (),
-                            Err(err) => {
-                                gst::error!(
-                                    CAT,
-                                    obj: pad,
-                                    "Failed to decode caption frame: {:?}",
-                                    err
-                                );
-                            }
-                        }
-
-                        self.reset_timeout(state, pts);
-                    }
-                } else {
-                    break;
+        let mut update = false;
+        for (_, res) in state.caption_frame.decode_buffer(words, 0.0) {
+            match res {
+                Ok(Status::Ready) | Ok(Status::Clear) => update = true,
+                Ok(Status::Ok) => (),
+                Err(err) => {
+                    gst::error!(CAT, obj: pad, "Failed to decode caption frame: {:?}", err);
                 }
             }
         }
+
+        if update {
+            self.update_overlay(state);
+        }
+        self.reset_timeout(state, pts);
     }
 
-    fn decode_s334_1a(&self, pad: &gst::Pad, state: &mut State, data: &[u8], pts: gst::ClockTime) {
+    // Decodes `state.cc_data`, only updating the overlay on `Status::Ready`
+    fn decode_cc_words(&self, state: &mut State, pts: gst::ClockTime) {
+        if state.cc_data.is_empty() {
+            return;
+        }
+
+        let update = state
+            .caption_frame
+            .decode_buffer(&state.cc_data, 0.0)
+            .any(|(_, res)| matches!(res, Ok(Status::Ready)));
+
+        if update {
+            self.update_overlay(state);
+        }
+        self.reset_timeout(state, pts);
+    }
+
+    fn decode_s334_1a(&self, _pad: &gst::Pad, state: &mut State, data: &[u8], pts: gst::ClockTime) {
         if data.len() % 3 != 0 {
             gst::warning!(CAT, "cc_data length is not a multiple of 3, truncating");
         }
 
+        state.cc_data.clear();
         for triple in data.chunks_exact(3) {
             let cc_type = triple[0] & 0x01;
             if state.selected_field.is_none() {
@@ -366,24 +480,13 @@ impl Cea608Overlay {
             }
 
             if Some(cc_type) == state.selected_field {
-                if let Ok(Status::Ready) = state
-                    .caption_frame
-                    .decode((triple[1] as u16) << 8 | triple[2] as u16, 0.0)
-                {
-                    let text = match state.caption_frame.to_text(true) {
-                        Ok(text) => text,
-                        Err(_) => {
-                            gst::error!(CAT, obj: pad, "Failed to convert caption frame to text");
-                            continue;
-                        }
-                    };
-
-                    self.overlay_text(&text, state);
-                }
-
-                self.reset_timeout(state, pts);
+                state
+                    .cc_data
+                    .push((triple[1] as u16) << 8 | triple[2] as u16);
             }
         }
+
+        self.decode_cc_words(state, pts);
     }
 
     fn reset_timeout(&self, state: &mut State, pts: gst::ClockTime) {
@@ -414,9 +517,9 @@ impl Cea608Overlay {
 
         for meta in buffer.iter_meta::<gst_video::VideoCaptionMeta>() {
             if meta.caption_type() == gst_video::VideoCaptionType::Cea708Cdp {
-                match extract_cdp(meta.data()) {
-                    Ok(data) => {
-                        self.decode_cc_data(pad, &mut state, data, pts);
+                match CcData::demux_cdp(meta.data()) {
+                    Ok(cc_data) => {
+                        self.decode_cc_data(pad, &mut state, &cc_data, pts);
                     }
                     Err(e) => {
                         gst::warning!(CAT, "{}", &e.to_string());
@@ -424,34 +527,23 @@ impl Cea608Overlay {
                     }
                 }
             } else if meta.caption_type() == gst_video::VideoCaptionType::Cea708Raw {
-                self.decode_cc_data(pad, &mut state, meta.data(), pts);
+                if meta.data().len() % 3 != 0 {
+                    gst::warning!(CAT, "cc_data length is not a multiple of 3, truncating");
+                }
+
+                let cc_data = CcData::demux(meta.data());
+                self.decode_cc_data(pad, &mut state, &cc_data, pts);
             } else if meta.caption_type() == gst_video::VideoCaptionType::Cea608S3341a {
                 self.decode_s334_1a(pad, &mut state, meta.data(), pts);
             } else if meta.caption_type() == gst_video::VideoCaptionType::Cea608Raw {
                 let data = meta.data();
                 assert!(data.len() % 2 == 0);
-                for i in 0..data.len() / 2 {
-                    if let Ok(Status::Ready) = state
-                        .caption_frame
-                        .decode((data[i * 2] as u16) << 8 | data[i * 2 + 1] as u16, 0.0)
-                    {
-                        let text = match state.caption_frame.to_text(true) {
-                            Ok(text) => text,
-                            Err(_) => {
-                                gst::error!(
-                                    CAT,
-                                    obj: pad,
-                                    "Failed to convert caption frame to text"
-                                );
-                                continue;
-                            }
-                        };
-
-                        self.overlay_text(&text, &mut state);
-                    }
-
-                    self.reset_timeout(&mut state, pts);
-                }
+                state.cc_data.clear();
+                state.cc_data.extend(
+                    data.chunks_exact(2)
+                        .map(|word| (word[0] as u16) << 8 | word[1] as u16),
+                );
+                self.decode_cc_words(&mut state, pts);
             }
         }
 
@@ -459,7 +551,7 @@ impl Cea608Overlay {
             if let Some(interval) = pts.opt_saturating_sub(state.last_cc_pts) {
                 if interval > timeout {
                     gst::info!(CAT, imp: self, "Reached timeout, clearing overlay");
-                    state.composition.take();
+                    self.clear_overlay(&mut state);
                     state.last_cc_pts.take();
                 }
             }
@@ -506,7 +598,7 @@ impl Cea608Overlay {
             EventView::FlushStop(..) => {
                 let mut state = self.state.lock().unwrap();
                 state.caption_frame = CaptionFrame::default();
-                state.composition = None;
+                self.clear_overlay(&mut state);
                 gst::Pad::event_default(pad, Some(&*self.obj()), event)
             }
             _ => gst::Pad::event_default(pad, Some(&*self.obj()), event),
@@ -8,10 +8,6 @@
 
 // TODO:
 //
-//  * For now the element completely discards data for channel 1,
-//    as it has never really been used. Ideally it should handle it,
-//    not critical.
-//
 //  * A few control commands aren't supported, see TODO in
 //    decode_control. The only notable command is delete_to_end_of_row,
 //    probably hasn't seen wide usage though :)
@@ -29,8 +25,9 @@ use gst::glib;
 use gst::prelude::*;
 use gst::subclass::prelude::*;
 
+use crate::caption_frame::{CaptionChannels, Channel};
 use crate::ffi;
-use crate::ttutils::{Cea608Mode, Chunk, Line, Lines, TextStyle};
+use crate::ttutils::{Cea608Mode, ChannelSrcPads, Chunk, Line, Lines, TextStyle};
 
 use atomic_refcell::AtomicRefCell;
 
@@ -193,7 +190,15 @@ impl Default for Settings {
     }
 }
 
-struct State {
+#[derive(Copy, Clone, Debug)]
+enum InputFormat {
+    Raw,
+    S334_1a,
+}
+
+// Decoding state of a caption channel, CC1 is output on the always "src" pad and the other
+// channels on "src_cc2" to "src_cc4", added when they output their first lines
+struct Decoder {
     mode: Option<Cea608Mode>,
     last_cc_data: Option<u16>,
     rows: BTreeMap<u32, Row>,
@@ -207,9 +212,9 @@ struct State {
     settings: Settings,
 }
 
-impl Default for State {
+impl Default for Decoder {
     fn default() -> Self {
-        State {
+        Decoder {
             mode: None,
             last_cc_data: None,
             rows: BTreeMap::new(),
@@ -230,9 +235,40 @@ impl Default for State {
     }
 }
 
+struct State {
+    input_format: InputFormat,
+    caption_channels: CaptionChannels,
+    decoders: [Decoder; 4],
+    settings: Settings,
+}
+
+impl Default for State {
+    fn default() -> Self {
+        State {
+            input_format: InputFormat::Raw,
+            caption_channels: CaptionChannels::default(),
+            decoders: Default::default(),
+            settings: Settings::default(),
+        }
+    }
+}
+
+impl State {
+    fn new(settings: Settings) -> Self {
+        let mut state = State::default();
+        for decoder in &mut state.decoders {
+            decoder.settings = settings.clone();
+        }
+        state.settings = settings;
+
+        state
+    }
+}
+
 pub struct Cea608ToJson {
     srcpad: gst::Pad,
     sinkpad: gst::Pad,
+    channel_srcpads: ChannelSrcPads,
 
     state: AtomicRefCell<State>,
     settings: Mutex<Settings>,
@@ -262,10 +298,6 @@ fn is_specialna(cc_data: u16) -> bool {
     0x1130 == (0x7770 & cc_data)
 }
 
-fn is_xds(cc_data: u16) -> bool {
-    0x0000 == (0x7070 & cc_data) && 0x0000 != (0x0F0F & cc_data)
-}
-
 fn is_westeu(cc_data: u16) -> bool {
     0x1220 == (0x7660 & cc_data)
 }
@@ -288,7 +320,6 @@ struct Preamble {
     row: i32,
     col: i32,
     style: TextStyle,
-    chan: i32,
     underline: i32,
 }
 
@@ -313,14 +344,12 @@ fn parse_preamble(cc_data: u16) -> Preamble {
             row,
             col,
             style: style.into(),
-            chan,
             underline,
         }
     }
 }
 
 struct MidrowChange {
-    chan: i32,
     style: TextStyle,
     underline: bool,
 }
@@ -334,14 +363,13 @@ fn parse_midrowchange(cc_data: u16) -> MidrowChange {
         ffi::eia608_parse_midrowchange(cc_data, &mut chan, &mut style, &mut underline);
 
         MidrowChange {
-            chan,
             style: style.into(),
             underline: underline > 0,
         }
     }
 }
 
-fn eia608_to_utf8(cc_data: u16) -> (Option<char>, Option<char>, i32) {
+fn eia608_to_utf8(cc_data: u16) -> (Option<char>, Option<char>) {
     unsafe {
         let mut chan = 0;
         let mut char1 = [0u8; 5usize];
@@ -378,7 +406,7 @@ fn eia608_to_utf8(cc_data: u16) -> (Option<char>, Option<char>, i32) {
             None
         };
 
-        (char1, char2, chan)
+        (char1, char2)
     }
 }
 
@@ -421,7 +449,7 @@ fn dump(
     }
 }
 
-impl State {
+impl Decoder {
     fn update_mode(&mut self, imp: &Cea608ToJson, mode: Cea608Mode) -> Option<TimestampedLines> {
         if mode.is_rollup() && self.mode == Some(Cea608Mode::PopOn) {
             // https://www.law.cornell.edu/cfr/text/47/79.101 (f)(2)(v)
@@ -547,10 +575,6 @@ impl State {
     fn decode_preamble(&mut self, imp: &Cea608ToJson, cc_data: u16) -> Option<TimestampedLines> {
         let preamble = parse_preamble(cc_data);
 
-        if preamble.chan != 0 {
-            return None;
-        }
-
         gst::log!(CAT, imp: imp, "preamble: {:?}", preamble);
 
         let drain_roll_up = self.cursor.row != preamble.row as u32;
@@ -635,10 +659,6 @@ impl State {
 
         gst::log!(CAT, imp: imp, "Command for CC {}", chan);
 
-        if chan != 0 {
-            return None;
-        }
-
         match cmd {
             ffi::eia608_control_t_eia608_control_resume_direct_captioning => {
                 return self.update_mode(imp, Cea608Mode::PaintOn);
@@ -752,11 +772,7 @@ impl State {
     }
 
     fn decode_text(&mut self, imp: &Cea608ToJson, cc_data: u16) {
-        let (char1, char2, chan) = eia608_to_utf8(cc_data);
-
-        if chan != 0 {
-            return;
-        }
+        let (char1, char2) = eia608_to_utf8(cc_data);
 
         if let Some(row) = self.rows.get_mut(&self.cursor.row) {
             if is_westeu(cc_data) {
@@ -787,31 +803,20 @@ impl State {
         if let Some(row) = self.rows.get_mut(&self.cursor.row) {
             let midrowchange = parse_midrowchange(cc_data);
 
-            if midrowchange.chan == 0 {
-                row.push_midrow(&mut self.cursor, midrowchange.style, midrowchange.underline);
-            }
+            row.push_midrow(&mut self.cursor, midrowchange.style, midrowchange.underline);
         }
     }
 
-    fn handle_cc_data(
-        &mut self,
-        imp: &Cea608ToJson,
-        pts: Option<gst::ClockTime>,
-        duration: Option<gst::ClockTime>,
-        cc_data: u16,
-    ) -> Option<TimestampedLines> {
+    // Decodes a word routed to the channel of the decoder
+    fn handle_cc_data(&mut self, imp: &Cea608ToJson, cc_data: u16) -> Option<TimestampedLines> {
         if (is_specialna(cc_data) || is_control(cc_data)) && Some(cc_data) == self.last_cc_data {
             gst::log!(CAT, imp: imp, "Skipping duplicate");
             return None;
         }
 
         self.last_cc_data = Some(cc_data);
-        self.current_pts = pts;
-        self.current_duration = duration;
 
-        if is_xds(cc_data) {
-            gst::log!(CAT, imp: imp, "XDS, ignoring");
-        } else if is_control(cc_data) {
+        if is_control(cc_data) {
             gst::log!(CAT, imp: imp, "control!");
             return self.decode_control(imp, cc_data);
         } else if is_basicna(cc_data) || is_specialna(cc_data) || is_westeu(cc_data) {
@@ -836,8 +841,12 @@ impl State {
 }
 
 impl Cea608ToJson {
-    fn output(&self, lines: TimestampedLines) -> Result<gst::FlowSuccess, gst::FlowError> {
-        gst::debug!(CAT, imp: self, "outputting: {:?}", lines);
+    fn output(
+        &self,
+        channel: Channel,
+        lines: TimestampedLines,
+    ) -> Result<gst::FlowSuccess, gst::FlowError> {
+        gst::debug!(CAT, imp: self, "outputting for {}: {:?}", channel.name(), lines);
 
         let json = serde_json::to_string(&lines.lines).map_err(|err| {
             gst::element_imp_error!(
@@ -858,7 +867,8 @@ impl Cea608ToJson {
 
         gst::log!(CAT, imp: self, "Pushing {:?}", buf);
 
-        self.srcpad.push(buf)
+        self.channel_srcpads
+            .push(self.obj().upcast_ref(), &self.sinkpad, channel, buf)
     }
 
     fn sink_chain(
@@ -888,30 +898,94 @@ impl Cea608ToJson {
             gst::FlowError::Error
         })?;
 
-        if data.len() < 2 {
-            gst::error!(CAT, obj: pad, "Invalid closed caption packet size");
+        let mut outputs = vec![];
+        {
+            let state = &mut *state;
+            for decoder in &mut state.decoders {
+                decoder.current_pts = pts;
+                decoder.current_duration = duration;
+            }
+
+            let input_format = state.input_format;
+            let mut handle_word = |field: u8, cc_data: u16| {
+                dump(self, cc_data, pts, duration);
+
+                match state.caption_channels.route(field, cc_data) {
+                    Some(Channel::Xds) => {
+                        gst::log!(CAT, imp: self, "XDS, ignoring");
+                    }
+                    Some(channel) => {
+                        if let Some(lines) =
+                            state.decoders[channel.index()].handle_cc_data(self, cc_data)
+                        {
+                            outputs.push((channel, lines));
+                        }
+                    }
+                    // Padding and invalid words separate duplicate commands
+                    None => {
+                        let field = field as usize;
+                        for decoder in &mut state.decoders[field * 2..field * 2 + 2] {
+                            decoder.last_cc_data = Some(cc_data);
+                        }
+                    }
+                }
+            };
+
+            match input_format {
+                InputFormat::Raw => {
+                    if data.len() < 2 {
+                        gst::error!(CAT, obj: pad, "Invalid closed caption packet size");
 
-            return Ok(gst::FlowSuccess::Ok);
+                        return Ok(gst::FlowSuccess::Ok);
+                    }
+
+                    for pair in data.chunks_exact(2) {
+                        handle_word(0, (pair[0] as u16) << 8 | pair[1] as u16);
+                    }
+                }
+                InputFormat::S334_1a => {
+                    if data.len() % 3 != 0 {
+                        gst::warning!(
+                            CAT,
+                            obj: pad,
+                            "cc_data length is not a multiple of 3, truncating"
+                        );
+                    }
+
+                    for triple in data.chunks_exact(3) {
+                        handle_word(triple[0] & 0x01, (triple[1] as u16) << 8 | triple[2] as u16);
+                    }
+                }
+            }
         }
 
-        let cc_data = (data[0] as u16) << 8 | data[1] as u16;
+        let unbuffered = state.settings.unbuffered;
+        drop(data);
+        drop(state);
+
+        let mut output_channels = [false; 4];
+        for (channel, lines) in outputs {
+            output_channels[channel.index()] = true;
+            self.output(channel, lines)?;
+        }
 
-        dump(self, cc_data, pts, duration);
+        if unbuffered {
+            for channel in Channel::CAPTIONS {
+                if output_channels[channel.index()] {
+                    continue;
+                }
 
-        if let Some(lines) = state.handle_cc_data(self, pts, duration, cc_data) {
-            drop(state);
-            self.output(lines)
-        } else if state.settings.unbuffered {
-            drop(state);
-            self.srcpad.push_event(
-                gst::event::Gap::builder(pts.unwrap())
-                    .duration(duration)
-                    .build(),
-            );
-            Ok(gst::FlowSuccess::Ok)
-        } else {
-            Ok(gst::FlowSuccess::Ok)
+                if let Some(srcpad) = self.channel_srcpads.get(channel) {
+                    srcpad.push_event(
+                        gst::event::Gap::builder(pts.unwrap())
+                            .duration(duration)
+                            .build(),
+                    );
+                }
+            }
         }
+
+        Ok(gst::FlowSuccess::Ok)
     }
 
     fn sink_event(&self, pad: &gst::Pad, event: gst::Event) -> bool {
@@ -919,7 +993,14 @@ impl Cea608ToJson {
 
         gst::log!(CAT, obj: pad, "Handling event {:?}", event);
         match event.view() {
-            EventView::Caps(..) => {
+            EventView::Caps(c) => {
+                let s = c.caps().structure(0).unwrap();
+                self.state.borrow_mut().input_format = if s.get::<&str>("format") == Ok("s334-1a") {
+                    InputFormat::S334_1a
+                } else {
+                    InputFormat::Raw
+                };
+
                 // We send our own caps downstream
                 let caps = gst::Caps::builder("application/x-json")
                     .field("format", "cea608")
@@ -928,18 +1009,24 @@ impl Cea608ToJson {
             }
             EventView::FlushStop(..) => {
                 let mut state = self.state.borrow_mut();
-                let old_settings = state.settings.clone();
-                *state = State::default();
-                state.settings = old_settings;
+                let input_format = state.input_format;
+                *state = State::new(state.settings.clone());
+                state.input_format = input_format;
                 drop(state);
+                self.channel_srcpads.reset_flow();
                 gst::Pad::event_default(pad, Some(&*self.obj()), event)
             }
             EventView::Eos(..) => {
-                if let Some(lines) = self.state.borrow_mut().drain_pending(self) {
-                    let _ = self.output(lines);
-                }
-                if let Some(lines) = self.state.borrow_mut().drain(self, true) {
-                    let _ = self.output(lines);
+                for channel in Channel::CAPTIONS {
+                    let mut state = self.state.borrow_mut();
+                    let decoder = &mut state.decoders[channel.index()];
+                    let pending = decoder.drain_pending(self);
+                    let lines = decoder.drain(self, true);
+                    drop(state);
+
+                    for lines in pending.into_iter().chain(lines) {
+                        let _ = self.output(channel, lines);
+                    }
                 }
 
                 gst::Pad::event_default(pad, Some(&*self.obj()), event)
@@ -983,6 +1070,7 @@ impl ObjectSubclass for Cea608ToJson {
         Self {
             srcpad,
             sinkpad,
+            channel_srcpads: ChannelSrcPads::new(&srcpad),
             state: AtomicRefCell::new(State::default()),
             settings: Mutex::new(Settings::default()),
         }
@@ -1063,8 +1151,16 @@ impl ElementImpl for Cea608ToJson {
             )
             .unwrap();
 
+            let channel_src_pad_template = gst::PadTemplate::new(
+                "src_%s",
+                gst::PadDirection::Src,
+                gst::PadPresence::Sometimes,
+                &caps,
+            )
+            .unwrap();
+
             let caps = gst::Caps::builder("closedcaption/x-cea-608")
-                .field("format", "raw")
+                .field("format", gst::List::new(["raw", "s334-1a"]))
                 .build();
 
             let sink_pad_template = gst::PadTemplate::new(
@@ -1075,7 +1171,11 @@ impl ElementImpl for Cea608ToJson {
             )
             .unwrap();
 
-            vec![src_pad_template, sink_pad_template]
+            vec![
+                src_pad_template,
+                channel_src_pad_template,
+                sink_pad_template,
+            ]
         });
 
         PAD_TEMPLATES.as_ref()
@@ -1091,8 +1191,7 @@ impl ElementImpl for Cea608ToJson {
         match transition {
             gst::StateChange::ReadyToPaused => {
                 let mut state = self.state.borrow_mut();
-                *state = State::default();
-                state.settings = self.settings.lock().unwrap().clone();
+                *state = State::new(self.settings.lock().unwrap().clone());
             }
             _ => (),
         }
@@ -1103,6 +1202,8 @@ impl ElementImpl for Cea608ToJson {
             gst::StateChange::PausedToReady => {
                 let mut state = self.state.borrow_mut();
                 *state = State::default();
+                drop(state);
+                self.channel_srcpads.remove(self.obj().upcast_ref());
             }
             _ => (),
         }
@@ -10,8 +10,10 @@ use gst::glib;
 use gst::prelude::*;
 use gst::subclass::prelude::*;
 
-use crate::caption_frame::{CaptionFrame, Status};
+use crate::caption_frame::{CaptionChannels, Channel, Error, Status};
+use crate::ttutils::ChannelSrcPads;
 use atomic_refcell::AtomicRefCell;
+use std::mem;
 
 use once_cell::sync::Lazy;
 
@@ -22,29 +24,60 @@ enum Format {
     Raw,
 }
 
-struct State {
-    format: Option<Format>,
+#[derive(Copy, Clone, Debug)]
+enum InputFormat {
+    Raw,
+    S334_1a,
+}
+
+// Output state of a caption channel, CC1 is output on the always "src" pad and the other
+// channels on "src_cc2" to "src_cc4", added when they output their first caption
+struct ChannelState {
     wrote_header: bool,
-    caption_frame: CaptionFrame,
     previous_text: Option<(gst::ClockTime, String)>,
     index: u64,
 }
 
-impl Default for State {
+impl Default for ChannelState {
     fn default() -> Self {
-        State {
-            format: None,
+        ChannelState {
             wrote_header: false,
-            caption_frame: CaptionFrame::default(),
             previous_text: None,
             index: 1,
         }
     }
 }
 
+struct State {
+    format: Option<Format>,
+    input_format: InputFormat,
+    caption_channels: CaptionChannels,
+    channels: [ChannelState; 4],
+    // cc_data words of one field of the current buffer, and the events they decoded to
+    cc_data: Vec<u16>,
+    events: Vec<(Option<Channel>, Result<Status, Error>)>,
+    // Text of the last output caption, its allocation is reused for the next one
+    spare_text: String,
+}
+
+impl Default for State {
+    fn default() -> Self {
+        State {
+            format: None,
+            input_format: InputFormat::Raw,
+            caption_channels: CaptionChannels::default(),
+            channels: Default::default(),
+            cc_data: Vec::new(),
+            events: Vec::new(),
+            spare_text: String::new(),
+        }
+    }
+}
+
 pub struct Cea608ToTt {
     srcpad: gst::Pad,
     sinkpad: gst::Pad,
+    channel_srcpads: ChannelSrcPads,
 
     state: AtomicRefCell<State>,
 }
@@ -79,83 +112,214 @@ impl Cea608ToTt {
             gst::FlowError::Error
         })?;
 
-        let pts = (buffer_pts.nseconds() as f64) / 1_000_000_000.0;
-
         let data = buffer.map_readable().map_err(|_| {
             gst::error!(CAT, obj: pad, "Can't map buffer readable");
 
             gst::FlowError::Error
         })?;
 
-        if data.len() < 2 {
-            gst::error!(CAT, obj: pad, "Invalid closed caption packet size");
+        let buffers = self.decode_buffer(pad, &mut state, format, &data, buffer_pts);
+        drop(data);
+        drop(state);
 
-            return Ok(gst::FlowSuccess::Ok);
-        }
+        self.push_buffers(buffers)
+    }
 
-        let previous_text = match state
-            .caption_frame
-            .decode((data[0] as u16) << 8 | data[1] as u16, pts)
-        {
-            Ok(Status::Ok) => return Ok(gst::FlowSuccess::Ok),
-            Err(_) => {
-                gst::error!(CAT, obj: pad, "Failed to decode closed caption packet");
-                return Ok(gst::FlowSuccess::Ok);
+    // Decodes the words of a buffer, returns the buffers of the captions to push on the pads of
+    // their channels
+    fn decode_buffer(
+        &self,
+        pad: &gst::Pad,
+        state: &mut State,
+        format: Format,
+        data: &[u8],
+        buffer_pts: gst::ClockTime,
+    ) -> Vec<(Channel, gst::Buffer)> {
+        let pts = (buffer_pts.nseconds() as f64) / 1_000_000_000.0;
+
+        state.events.clear();
+        match state.input_format {
+            InputFormat::Raw => {
+                if data.len() < 2 {
+                    gst::error!(CAT, obj: pad, "Invalid closed caption packet size");
+
+                    return Vec::new();
+                }
+
+                state.cc_data.clear();
+                state.cc_data.extend(
+                    data.chunks_exact(2)
+                        .map(|pair| (pair[0] as u16) << 8 | pair[1] as u16),
+                );
+                Self::decode_field(state, 0, pts);
             }
-            Ok(Status::Clear) => {
-                gst::debug!(CAT, obj: pad, "Clearing previous closed caption packet");
-                state.previous_text.take()
+            InputFormat::S334_1a => {
+                if data.len() % 3 != 0 {
+                    gst::warning!(
+                        CAT,
+                        obj: pad,
+                        "cc_data length is not a multiple of 3, truncating"
+                    );
+                }
+
+                for field in 0..2 {
+                    state.cc_data.clear();
+                    state.cc_data.extend(
+                        data.chunks_exact(3)
+                            .filter(|triple| triple[0] & 0x01 == field)
+                            .map(|triple| (triple[1] as u16) << 8 | triple[2] as u16),
+                    );
+                    Self::decode_field(state, field, pts);
+                }
             }
-            Ok(Status::Ready) => {
-                gst::debug!(CAT, obj: pad, "Have new closed caption packet");
-                let text = match state.caption_frame.to_text(false) {
-                    Ok(text) => text,
-                    Err(_) => {
+        }
+
+        let mut buffers = Vec::new();
+        for i in 0..state.events.len() {
+            let (channel, status) = state.events[i];
+
+            let channel = match channel {
+                Some(Channel::Xds) => {
+                    if let Ok(Status::Ready) = status {
+                        gst::debug!(CAT, obj: pad, "Have XDS packet, ignoring");
+                    }
+                    continue;
+                }
+                Some(channel) => channel,
+                None => {
+                    gst::error!(CAT, obj: pad, "Failed to decode closed caption packet");
+                    continue;
+                }
+            };
+
+            let channel_state = &mut state.channels[channel.index()];
+            let previous_text = match status {
+                Ok(Status::Ok) => continue,
+                Err(_) => {
+                    gst::error!(
+                        CAT,
+                        obj: pad,
+                        "Failed to decode closed caption packet for {}",
+                        channel.name()
+                    );
+                    continue;
+                }
+                Ok(Status::Clear) => {
+                    gst::debug!(
+                        CAT,
+                        obj: pad,
+                        "Clearing previous closed caption packet for {}",
+                        channel.name()
+                    );
+                    channel_state.previous_text.take()
+                }
+                Ok(Status::Ready) => {
+                    gst::debug!(
+                        CAT,
+                        obj: pad,
+                        "Have new closed caption packet for {}",
+                        channel.name()
+                    );
+                    let mut text = mem::take(&mut state.spare_text);
+                    if state
+                        .caption_channels
+                        .to_text_into(channel, false, &mut text)
+                        .is_err()
+                    {
                         gst::error!(CAT, obj: pad, "Failed to convert caption frame to text");
-                        return Ok(gst::FlowSuccess::Ok);
+                        state.spare_text = text;
+                        continue;
                     }
-                };
 
-                state.previous_text.replace((buffer_pts, text))
-            }
-        };
+                    channel_state.previous_text.replace((buffer_pts, text))
+                }
+            };
 
-        let previous_text = match previous_text {
-            Some(previous_text) => previous_text,
-            None => {
-                gst::debug!(CAT, obj: pad, "Have no previous text");
-                return Ok(gst::FlowSuccess::Ok);
-            }
-        };
+            let (timestamp, text) = match previous_text {
+                Some(previous_text) => previous_text,
+                None => {
+                    gst::debug!(CAT, obj: pad, "Have no previous text");
+                    continue;
+                }
+            };
+
+            let duration = buffer_pts.saturating_sub(timestamp);
+            Self::create_buffers(
+                state,
+                channel,
+                format,
+                timestamp,
+                duration,
+                text,
+                &mut buffers,
+            );
+        }
+        buffers
+    }
 
-        let duration = buffer_pts.saturating_sub(previous_text.0);
+    // Decodes the words of `field` in `state.cc_data` and appends their events
+    fn decode_field(state: &mut State, field: u8, pts: f64) {
+        if state.cc_data.is_empty() {
+            return;
+        }
+
+        state.events.extend(
+            state
+                .caption_channels
+                .decode(field, &state.cc_data, pts)
+                .map(|(_, channel, status)| (channel, status)),
+        );
+    }
 
-        let (timestamp, text) = previous_text;
+    // Appends the buffers of a caption of `channel`, preceded by the header when it is the first
+    fn create_buffers(
+        state: &mut State,
+        channel: Channel,
+        format: Format,
+        timestamp: gst::ClockTime,
+        duration: gst::ClockTime,
+        mut text: String,
+        buffers: &mut Vec<(Channel, gst::Buffer)>,
+    ) {
+        let channel_state = &mut state.channels[channel.index()];
 
-        let header_buffer = if !state.wrote_header {
-            state.wrote_header = true;
+        if !channel_state.wrote_header {
+            channel_state.wrote_header = true;
 
             match format {
-                Format::Vtt => Some(Self::create_vtt_header(timestamp)),
-                Format::Srt | Format::Raw => None,
+                Format::Vtt => buffers.push((channel, Self::create_vtt_header(timestamp))),
+                Format::Srt | Format::Raw => (),
             }
-        } else {
-            None
-        };
+        }
 
         let buffer = match format {
-            Format::Vtt => Self::create_vtt_buffer(timestamp, duration, text),
-            Format::Srt => Self::create_srt_buffer(timestamp, duration, state.index, text),
-            Format::Raw => Self::create_raw_buffer(timestamp, duration, text),
+            Format::Vtt => Self::create_vtt_buffer(timestamp, duration, &text),
+            Format::Srt => Self::create_srt_buffer(timestamp, duration, channel_state.index, &text),
+            Format::Raw => Self::create_raw_buffer(timestamp, duration, mem::take(&mut text)),
         };
-        state.index += 1;
-        drop(state);
+        channel_state.index += 1;
+        // Recycle the text for the next caption, unless the buffer took it over
+        state.spare_text = text;
 
-        if let Some(header_buffer) = header_buffer {
-            self.srcpad.push(header_buffer)?;
+        buffers.push((channel, buffer));
+    }
+
+    fn push_buffers(
+        &self,
+        buffers: Vec<(Channel, gst::Buffer)>,
+    ) -> Result<gst::FlowSuccess, gst::FlowError> {
+        let mut ret = Ok(gst::FlowSuccess::Ok);
+
+        for (channel, buffer) in buffers {
+            ret =
+                self.channel_srcpads
+                    .push(self.obj().upcast_ref(), &self.sinkpad, channel, buffer);
+            if ret.is_err() {
+                break;
+            }
         }
 
-        self.srcpad.push(buffer)
+        ret
     }
 
     fn create_vtt_header(timestamp: gst::ClockTime) -> gst::Buffer {
@@ -190,7 +354,7 @@ impl Cea608ToTt {
     fn create_vtt_buffer(
         timestamp: gst::ClockTime,
         duration: gst::ClockTime,
-        text: String,
+        text: &str,
     ) -> gst::Buffer {
         use std::fmt::Write;
 
@@ -222,7 +386,7 @@ impl Cea608ToTt {
         timestamp: gst::ClockTime,
         duration: gst::ClockTime,
         index: u64,
-        text: String,
+        text: &str,
     ) -> gst::Buffer {
         use std::fmt::Write;
 
@@ -271,9 +435,16 @@ impl Cea608ToTt {
 
         gst::log!(CAT, obj: pad, "Handling event {:?}", event);
         match event.view() {
-            EventView::Caps(..) => {
+            EventView::Caps(c) => {
                 let mut state = self.state.borrow_mut();
 
+                let s = c.caps().structure(0).unwrap();
+                state.input_format = if s.get::<&str>("format") == Ok("s334-1a") {
+                    InputFormat::S334_1a
+                } else {
+                    InputFormat::Raw
+                };
+
                 if state.format.is_some() {
                     return true;
                 }
@@ -319,50 +490,44 @@ impl Cea608ToTt {
             }
             EventView::FlushStop(..) => {
                 let mut state = self.state.borrow_mut();
-                state.caption_frame = CaptionFrame::default();
-                state.previous_text = None;
+                state.caption_channels = CaptionChannels::default();
+                for channel_state in &mut state.channels {
+                    channel_state.previous_text = None;
+                }
+                drop(state);
+                self.channel_srcpads.reset_flow();
             }
             EventView::Eos(..) => {
                 let mut state = self.state.borrow_mut();
-                if let Some((timestamp, text)) = state.previous_text.take() {
-                    gst::debug!(CAT, obj: pad, "Outputting final text on EOS");
-
-                    let format = state.format.unwrap();
-
-                    let header_buffer = if !state.wrote_header {
-                        state.wrote_header = true;
-
-                        match format {
-                            Format::Vtt => Some(Self::create_vtt_header(timestamp)),
-                            Format::Srt | Format::Raw => None,
+                let mut buffers = Vec::new();
+
+                if let Some(format) = state.format {
+                    for channel in Channel::CAPTIONS {
+                        if let Some((timestamp, text)) =
+                            state.channels[channel.index()].previous_text.take()
+                        {
+                            gst::debug!(
+                                CAT,
+                                obj: pad,
+                                "Outputting final text of {} on EOS",
+                                channel.name()
+                            );
+
+                            Self::create_buffers(
+                                &mut state,
+                                channel,
+                                format,
+                                timestamp,
+                                gst::ClockTime::ZERO,
+                                text,
+                                &mut buffers,
+                            );
                         }
-                    } else {
-                        None
-                    };
-
-                    let buffer = match format {
-                        Format::Vtt => {
-                            Self::create_vtt_buffer(timestamp, gst::ClockTime::ZERO, text)
-                        }
-                        Format::Srt => Self::create_srt_buffer(
-                            timestamp,
-                            gst::ClockTime::ZERO,
-                            state.index,
-                            text,
-                        ),
-                        Format::Raw => {
-                            Self::create_raw_buffer(timestamp, gst::ClockTime::ZERO, text)
-                        }
-                    };
-                    state.index += 1;
-                    drop(state);
-
-                    if let Some(header_buffer) = header_buffer {
-                        let _ = self.srcpad.push(header_buffer);
                     }
-
-                    let _ = self.srcpad.push(buffer);
                 }
+                drop(state);
+
+                let _ = self.push_buffers(buffers);
             }
             _ => (),
         }
@@ -405,6 +570,7 @@ impl ObjectSubclass for Cea608ToTt {
         Self {
             srcpad,
             sinkpad,
+            channel_srcpads: ChannelSrcPads::new(&srcpad),
             state: AtomicRefCell::new(State::default()),
         }
     }
@@ -465,8 +631,16 @@ impl ElementImpl for Cea608ToTt {
             )
             .unwrap();
 
+            let channel_src_pad_template = gst::PadTemplate::new(
+                "src_%s",
+                gst::PadDirection::Src,
+                gst::PadPresence::Sometimes,
+                &caps,
+            )
+            .unwrap();
+
             let caps = gst::Caps::builder("closedcaption/x-cea-608")
-                .field("format", "raw")
+                .field("format", gst::List::new(["raw", "s334-1a"]))
                 .build();
 
             let sink_pad_template = gst::PadTemplate::new(
@@ -477,7 +651,11 @@ impl ElementImpl for Cea608ToTt {
             )
             .unwrap();
 
-            vec![src_pad_template, sink_pad_template]
+            vec![
+                src_pad_template,
+                channel_src_pad_template,
+                sink_pad_template,
+            ]
         });
 
         PAD_TEMPLATES.as_ref()
@@ -504,6 +682,8 @@ impl ElementImpl for Cea608ToTt {
             gst::StateChange::PausedToReady => {
                 let mut state = self.state.borrow_mut();
                 *state = State::default();
+                drop(state);
+                self.channel_srcpads.remove(self.obj().upcast_ref());
             }
             _ => (),
         }
@@ -424,10 +424,21 @@ pub const SCNiPTR: &'static [u8; 3usize] = b"li\0";
 pub const SCNoPTR: &'static [u8; 3usize] = b"lo\0";
 pub const SCNuPTR: &'static [u8; 3usize] = b"lu\0";
 pub const SCNxPTR: &'static [u8; 3usize] = b"lx\0";
+pub const EIA608_WORD_CLASS: u32 = 15;
+pub const EIA608_WORD_CHANNEL: u32 = 16;
+pub const EIA608_WORD_PARITY: u32 = 32;
+pub const EIA608_WORD_INDEX1_SHIFT: u32 = 8;
+pub const EIA608_WORD_INDEX2_SHIFT: u32 = 16;
 pub const SCREEN_ROWS: u32 = 15;
 pub const SCREEN_COLS: u32 = 32;
+pub const CAPTION_FRAME_CELL_STYLE: u32 = 7;
+pub const CAPTION_FRAME_CELL_UNDERLINE: u32 = 8;
 pub const CAPTION_FRAME_TEXT_BYTES: u32 = 2041;
+pub const CAPTION_FRAME_RUNS: u32 = 480;
+pub const CAPTION_CHANNELS: u32 = 4;
 pub const CAPTION_FRAME_DUMP_BUF_SIZE: u32 = 8192;
+pub const CC_DATA_TRIPLE_BYTES: u32 = 3;
+pub const CC_DATA_MAX_COUNT: u32 = 31;
 extern "C" {
     pub static mut eia608_char_map: [*const ::std::os::raw::c_char; 176usize];
 }
@@ -616,6 +627,18 @@ extern "C" {
 extern "C" {
     pub static mut eia608_style_map: [*const ::std::os::raw::c_char; 0usize];
 }
+pub const eia608_word_class_t_eia608_word_other: eia608_word_class_t = 0;
+pub const eia608_word_class_t_eia608_word_xds: eia608_word_class_t = 1;
+pub const eia608_word_class_t_eia608_word_control: eia608_word_class_t = 2;
+pub const eia608_word_class_t_eia608_word_basicna: eia608_word_class_t = 3;
+pub const eia608_word_class_t_eia608_word_specialna: eia608_word_class_t = 4;
+pub const eia608_word_class_t_eia608_word_westeu: eia608_word_class_t = 5;
+pub const eia608_word_class_t_eia608_word_preamble: eia608_word_class_t = 6;
+pub const eia608_word_class_t_eia608_word_midrowchange: eia608_word_class_t = 7;
+pub type eia608_word_class_t = ::std::os::raw::c_uint;
+extern "C" {
+    pub static eia608_word_table: [u32; 65536usize];
+}
 pub const eia608_style_t_eia608_style_white: eia608_style_t = 0;
 pub const eia608_style_t_eia608_style_green: eia608_style_t = 1;
 pub const eia608_style_t_eia608_style_blue: eia608_style_t = 2;
@@ -701,6 +724,13 @@ extern "C" {
 extern "C" {
     pub fn eia608_from_basicna(bna1: u16, bna2: u16) -> u16;
 }
+extern "C" {
+    pub fn eia608_from_utf8_string(
+        data: *const utf8_char_t,
+        chan: ::std::os::raw::c_int,
+        cc_data: *mut u16,
+    ) -> usize;
+}
 extern "C" {
     pub fn eia608_to_utf8(
         c: u16,
@@ -709,6 +739,17 @@ extern "C" {
         char2: *mut utf8_char_t,
     ) -> ::std::os::raw::c_int;
 }
+extern "C" {
+    pub fn eia608_to_index(
+        cc_data: u16,
+        chan: *mut ::std::os::raw::c_int,
+        c1: *mut ::std::os::raw::c_int,
+        c2: *mut ::std::os::raw::c_int,
+    ) -> ::std::os::raw::c_int;
+}
+extern "C" {
+    pub fn eia608_utf8_to_index(c: *const utf8_char_t) -> ::std::os::raw::c_int;
+}
 extern "C" {
     pub fn eia608_dump(cc_data: u16);
 }
@@ -743,9 +784,8 @@ pub type libcaption_stauts_t = u32;
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
 pub struct caption_frame_cell_t {
-    pub uln: u8,
-    pub sty: u8,
-    pub data: [utf8_char_t; 5usize],
+    pub chr: u8,
+    pub attr: u8,
 }
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
@@ -772,6 +812,8 @@ pub struct caption_frame_t {
     pub back: caption_frame_buffer_t,
     pub write: *mut caption_frame_buffer_t,
     pub status: libcaption_stauts_t,
+    pub generation: u32,
+    pub row_generation: [u32; 15usize],
 }
 extern "C" {
     pub fn caption_frame_init(frame: *mut caption_frame_t);
@@ -779,6 +821,9 @@ extern "C" {
 extern "C" {
     pub static _caption_frame_rollup: [::std::os::raw::c_int; 4usize];
 }
+extern "C" {
+    pub fn caption_frame_changed_rows(frame: *mut caption_frame_t, generation: u32) -> u16;
+}
 extern "C" {
     pub fn caption_frame_write_char(
         frame: *mut caption_frame_t,
@@ -805,6 +850,21 @@ extern "C" {
         timestamp: f64,
     ) -> libcaption_stauts_t;
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct caption_frame_event_t {
+    pub index: usize,
+    pub status: libcaption_stauts_t,
+}
+extern "C" {
+    pub fn caption_frame_decode_buffer(
+        frame: *mut caption_frame_t,
+        cc_data: *const u16,
+        size: usize,
+        timestamp: f64,
+        events: *mut caption_frame_event_t,
+    ) -> usize;
+}
 extern "C" {
     pub fn caption_frame_from_text(
         frame: *mut caption_frame_t,
@@ -818,9 +878,99 @@ extern "C" {
         full: ::std::os::raw::c_int,
     ) -> usize;
 }
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct caption_frame_run_t {
+    pub row: u8,
+    pub col: u8,
+    pub style: u8,
+    pub underline: u8,
+    pub offset: u16,
+    pub size: u16,
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct caption_frame_runs_t {
+    pub count: usize,
+    pub run: [caption_frame_run_t; 480usize],
+    pub text: [utf8_char_t; 2041usize],
+}
+extern "C" {
+    pub fn caption_frame_to_runs(
+        frame: *mut caption_frame_t,
+        rows: u16,
+        runs: *mut caption_frame_runs_t,
+    ) -> usize;
+}
+pub const caption_channel_t_caption_channel_cc1: caption_channel_t = 0;
+pub const caption_channel_t_caption_channel_cc2: caption_channel_t = 1;
+pub const caption_channel_t_caption_channel_cc3: caption_channel_t = 2;
+pub const caption_channel_t_caption_channel_cc4: caption_channel_t = 3;
+pub const caption_channel_t_caption_channel_xds: caption_channel_t = 4;
+pub const caption_channel_t_caption_channel_none: caption_channel_t = 5;
+pub type caption_channel_t = u32;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct caption_channels_t {
+    pub frame: [caption_frame_t; 4usize],
+    pub xds: xds_t,
+    pub data_channel: [u8; 2usize],
+}
+extern "C" {
+    pub fn caption_channels_init(channels: *mut caption_channels_t);
+}
+extern "C" {
+    pub fn caption_channels_route(
+        channels: *mut caption_channels_t,
+        field: ::std::os::raw::c_int,
+        cc_data: u16,
+    ) -> caption_channel_t;
+}
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct caption_channels_event_t {
+    pub index: usize,
+    pub channel: caption_channel_t,
+    pub status: libcaption_stauts_t,
+}
+extern "C" {
+    pub fn caption_channels_decode(
+        channels: *mut caption_channels_t,
+        field: ::std::os::raw::c_int,
+        cc_data: *const u16,
+        size: usize,
+        timestamp: f64,
+        events: *mut caption_channels_event_t,
+    ) -> usize;
+}
 extern "C" {
     pub fn caption_frame_dump_buffer(frame: *mut caption_frame_t, buf: *mut utf8_char_t) -> usize;
 }
 extern "C" {
     pub fn caption_frame_dump(frame: *mut caption_frame_t);
 }
+pub const cc_type_t_cc_type_ntsc_cc_field_1: cc_type_t = 0;
+pub const cc_type_t_cc_type_ntsc_cc_field_2: cc_type_t = 1;
+pub const cc_type_t_cc_type_dtvcc_packet_data: cc_type_t = 2;
+pub const cc_type_t_cc_type_dtvcc_packet_start: cc_type_t = 3;
+pub type cc_type_t = u32;
+pub const cc_data_status_t_CC_DATA_OK: cc_data_status_t = 0;
+pub const cc_data_status_t_CC_DATA_WRONG_LENGTH: cc_data_status_t = 1;
+pub const cc_data_status_t_CC_DATA_WRONG_MAGIC_SEQUENCE: cc_data_status_t = 2;
+pub const cc_data_status_t_CC_DATA_WRONG_CHECKSUM: cc_data_status_t = 3;
+pub type cc_data_status_t = u32;
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct cc_data_t {
+    pub cea608: [[u16; 31usize]; 2usize],
+    pub cea608_count: [u8; 2usize],
+    pub dtvcc: *const u8,
+    pub dtvcc_count: u8,
+    pub error_byte: usize,
+}
+extern "C" {
+    pub fn cc_data_demux(cc: *mut cc_data_t, data: *const u8, size: usize) -> usize;
+}
+extern "C" {
+    pub fn cc_data_demux_cdp(cc: *mut cc_data_t, cdp: *const u8, size: usize) -> cc_data_status_t;
+}
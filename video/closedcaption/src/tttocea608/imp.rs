@@ -13,6 +13,9 @@ use gst::subclass::prelude::*;
 use once_cell::sync::Lazy;
 
 use crate::ffi;
+use std::collections::HashMap;
+use std::ffi::CString;
+use std::mem;
 use std::sync::Mutex;
 
 use crate::ttutils::{Cea608Mode, Chunk, Line, Lines, TextStyle};
@@ -39,6 +42,22 @@ fn eia608_from_utf8_1(c: &[u8; 5]) -> u16 {
     unsafe { ffi::eia608_from_utf8_1(c.as_ptr() as *const _, 0) }
 }
 
+// Encodes a string of characters, pairing the basic North American ones. Characters that can't
+// be encoded are written as spaces
+fn eia608_from_utf8_string(text: &str, cc_data: &mut Vec<u16>) {
+    let text =
+        CString::new(text).unwrap_or_else(|_| CString::new(text.replace('\0', " ")).unwrap());
+
+    cc_data.clear();
+    // At most two words per character, so per byte
+    cc_data.reserve(2 * text.as_bytes().len());
+
+    unsafe {
+        let len = ffi::eia608_from_utf8_string(text.as_ptr(), 0, cc_data.as_mut_ptr());
+        cc_data.set_len(len);
+    }
+}
+
 fn eia608_to_text(cc_data: u16) -> String {
     unsafe {
         let bufsz = ffi::eia608_to_text(std::ptr::null_mut(), 0, cc_data);
@@ -89,6 +108,9 @@ const DEFAULT_MODE: Cea608Mode = Cea608Mode::RollUp2;
 const DEFAULT_ORIGIN_ROW: i32 = -1;
 const DEFAULT_ORIGIN_COLUMN: u32 = 0;
 
+// Number of encoded cues kept around for repeated captions
+const ENCODED_CACHE_CAPACITY: usize = 64;
+
 #[derive(Debug, Clone)]
 struct Settings {
     mode: Cea608Mode,
@@ -120,6 +142,9 @@ struct State {
     column: u32,
     mode: Cea608Mode,
     force_clear: bool,
+    encoded_cache: EncodedCache,
+    // Receives the cc_data of the cue being encoded, for the cache
+    encoded: Option<Vec<u16>>,
 }
 
 impl Default for State {
@@ -136,6 +161,75 @@ impl Default for State {
             underline: false,
             mode: Cea608Mode::PopOn,
             force_clear: false,
+            encoded_cache: EncodedCache::default(),
+            encoded: None,
+        }
+    }
+}
+
+// Everything the cc_data of the lines of a cue depends on
+#[derive(PartialEq, Eq, Hash)]
+struct EncodedKey {
+    lines: Vec<Line>,
+    mode: Cea608Mode,
+    origin_column: u32,
+    column: u32,
+    style: TextStyle,
+    underline: bool,
+    send_roll_up_preamble: bool,
+}
+
+// The cc_data of the lines of a cue and the state they leave behind
+struct Encoded {
+    cc_data: Vec<u16>,
+    column: u32,
+    style: TextStyle,
+    underline: bool,
+    send_roll_up_preamble: bool,
+    last_used: u64,
+}
+
+#[derive(Default)]
+struct EncodedCache {
+    entries: HashMap<EncodedKey, Encoded>,
+    uses: u64,
+    hits: u64,
+    misses: u64,
+}
+
+impl EncodedCache {
+    fn get(&mut self, key: &EncodedKey) -> Option<&Encoded> {
+        self.uses += 1;
+
+        match self.entries.get_mut(key) {
+            Some(encoded) => {
+                encoded.last_used = self.uses;
+                self.hits += 1;
+                Some(encoded)
+            }
+            None => {
+                self.misses += 1;
+                None
+            }
+        }
+    }
+
+    fn insert(&mut self, key: EncodedKey, mut encoded: Encoded) {
+        if self.entries.len() >= ENCODED_CACHE_CAPACITY {
+            // Uses are counted for every lookup, so no two entries were last used together
+            if let Some(lru) = self.entries.values().map(|encoded| encoded.last_used).min() {
+                self.entries.retain(|_, encoded| encoded.last_used != lru);
+            }
+        }
+
+        encoded.last_used = self.uses;
+        self.entries.insert(key, encoded);
+    }
+
+    fn hit_rate(&self) -> f64 {
+        match self.hits + self.misses {
+            0 => 0.0,
+            lookups => self.hits as f64 / lookups as f64,
         }
     }
 }
@@ -191,7 +285,14 @@ impl State {
                 self.erase_display_frame_no = None;
                 self.column = 0;
                 self.send_roll_up_preamble = true;
-                self.erase_display_memory(imp, bufferlist);
+                // Not part of the cue being encoded, if any
+                self.push_cc_data(
+                    imp,
+                    bufferlist,
+                    eia608_control_command(
+                        ffi::eia608_control_t_eia608_control_erase_display_memory,
+                    ),
+                );
                 return true;
             }
         }
@@ -202,6 +303,19 @@ impl State {
     fn cc_data(&mut self, imp: &TtToCea608, bufferlist: &mut gst::BufferListRef, cc_data: u16) {
         self.check_erase_display(imp, bufferlist);
 
+        if let Some(ref mut encoded) = self.encoded {
+            encoded.push(cc_data);
+        }
+
+        self.push_cc_data(imp, bufferlist, cc_data);
+    }
+
+    fn push_cc_data(
+        &mut self,
+        imp: &TtToCea608,
+        bufferlist: &mut gst::BufferListRef,
+        cc_data: u16,
+    ) {
         let (fps_n, fps_d) = (self.framerate.numer() as u64, self.framerate.denom() as u64);
 
         let pts = self
@@ -485,85 +599,21 @@ impl TtToCea608 {
         chars.take_while(|c| !c.is_ascii_whitespace()).count() as u32
     }
 
-    fn generate(
+    // Encodes the lines of a cue, starting at column `col`
+    fn encode_lines(
         &self,
-        mut state: &mut State,
+        state: &mut State,
         settings: &Settings,
-        pts: gst::ClockTime,
-        duration: gst::ClockTime,
-        lines: Lines,
-    ) -> Result<gst::BufferList, gst::FlowError> {
+        mut_list: &mut gst::BufferListRef,
+        lines: &[Line],
+        col: &mut u32,
+    ) {
         let origin_column = settings.origin_column;
         let mut row = 13;
-        let mut bufferlist = gst::BufferList::new();
-        let mut_list = bufferlist.get_mut().unwrap();
-
-        let mut col = if state.mode == Cea608Mode::PopOn || state.mode == Cea608Mode::PaintOn {
-            0
-        } else {
-            state.column
-        };
-
-        let (fps_n, fps_d) = (
-            state.framerate.numer() as u64,
-            state.framerate.denom() as u64,
-        );
-
-        let frame_no = pts.mul_div_round(fps_n, fps_d).unwrap().seconds();
-
-        if state.last_frame_no == 0 {
-            gst::debug!(CAT, imp: self, "Initial skip to frame no {}", frame_no);
-            state.last_frame_no = pts.mul_div_floor(fps_n, fps_d).unwrap().seconds();
-        }
-
-        state.max_frame_no = (pts + duration)
-            .mul_div_round(fps_n, fps_d)
-            .unwrap()
-            .seconds();
-
-        state.pad(self, mut_list, frame_no);
-
-        let mut cleared = false;
-        if let Some(mode) = lines.mode {
-            if mode != state.mode {
-                /* Always erase the display when going to or from pop-on */
-                if state.mode == Cea608Mode::PopOn || mode == Cea608Mode::PopOn {
-                    state.erase_display_frame_no = None;
-                    state.erase_display_memory(self, mut_list);
-                    cleared = true;
-                }
-
-                state.mode = mode;
-                match state.mode {
-                    Cea608Mode::RollUp2 | Cea608Mode::RollUp3 | Cea608Mode::RollUp4 => {
-                        state.send_roll_up_preamble = true;
-                    }
-                    _ => col = origin_column,
-                }
-            }
-        }
-
-        if let Some(clear) = lines.clear {
-            if clear && !cleared {
-                state.erase_display_frame_no = None;
-                state.erase_display_memory(self, mut_list);
-                if state.mode != Cea608Mode::PopOn && state.mode != Cea608Mode::PaintOn {
-                    state.send_roll_up_preamble = true;
-                }
-                col = origin_column;
-            }
-        }
-
-        if state.mode == Cea608Mode::PopOn {
-            state.resume_caption_loading(self, mut_list);
-            state.cc_data(self, mut_list, erase_non_displayed_memory());
-        } else if state.mode == Cea608Mode::PaintOn {
-            state.resume_direct_captioning(self, mut_list);
-        }
-
         let mut prev_char = 0;
+        let mut words = Vec::new();
 
-        for line in &lines.lines {
+        for line in lines {
             gst::log!(CAT, imp: self, "Processing {:?}", line);
 
             if let Some(line_row) = line.row {
@@ -579,9 +629,9 @@ impl TtToCea608 {
                 if state.mode != Cea608Mode::PopOn && state.mode != Cea608Mode::PaintOn {
                     state.send_roll_up_preamble = true;
                 }
-                col = line_column;
+                *col = line_column;
             } else if state.mode == Cea608Mode::PopOn || state.mode == Cea608Mode::PaintOn {
-                col = origin_column;
+                *col = origin_column;
             }
 
             for (j, chunk) in line.chunks.iter().enumerate() {
@@ -597,13 +647,13 @@ impl TtToCea608 {
                         settings,
                         chunk,
                         mut_list,
-                        &mut col,
+                        col,
                         row as i32,
                         line.carriage_return,
                     );
-                } else if self.open_chunk(state, chunk, mut_list, col) {
+                } else if self.open_chunk(state, chunk, mut_list, *col) {
                     prepend_space = false;
-                    col += 1;
+                    *col += 1;
                 }
 
                 if is_punctuation(&chunk.text) {
@@ -620,6 +670,36 @@ impl TtToCea608 {
                     }
                 };
 
+                // Without roll-up wrapping, there's no need to follow the column of every
+                // character and the chunk is encoded at once
+                if !state.mode.is_rollup() {
+                    // As many characters as fit, at least one
+                    let max_chars = 32u32.saturating_sub(*col).max(1) as usize;
+                    let mut chars = text.chars().filter(|c| *c != '\r');
+                    let visible = chars.by_ref().take(max_chars).collect::<String>();
+                    let dropped = chars.collect::<String>();
+                    if !dropped.is_empty() {
+                        gst::warning!(
+                            CAT,
+                            imp: self,
+                            "Dropping characters after 32nd column: {}",
+                            dropped
+                        );
+                    }
+
+                    eia608_from_utf8_string(&visible, &mut words);
+                    for cc_data in words.drain(..) {
+                        state.cc_data(self, mut_list, cc_data);
+
+                        if is_specialna(cc_data) {
+                            state.resume_caption_loading(self, mut_list);
+                        }
+                    }
+
+                    *col += visible.chars().count() as u32;
+                    continue;
+                }
+
                 let mut chars = text.chars().peekable();
 
                 while let Some(c) = chars.next() {
@@ -664,50 +744,38 @@ impl TtToCea608 {
                         state.resume_caption_loading(self, mut_list);
                     }
 
-                    col += 1;
-
-                    if state.mode.is_rollup() {
-                        /* In roll-up mode, we introduce carriage returns automatically.
-                         * Instead of always wrapping once the last column is reached, we
-                         * want to look ahead and check whether the following word will fit
-                         * on the current row. If it won't, we insert a carriage return,
-                         * unless it won't fit on a full row either, in which case it will need
-                         * to be broken up.
-                         */
-                        let next_word_length = if c.is_ascii_whitespace() {
-                            self.peek_word_length(chars.clone())
-                        } else {
-                            0
-                        };
-
-                        if (next_word_length <= 32 - origin_column && col + next_word_length > 31)
-                            || col > 31
-                        {
-                            if prev_char != 0 {
-                                state.cc_data(self, mut_list, prev_char);
-                                prev_char = 0;
-                            }
-
-                            self.open_line(
-                                state,
-                                settings,
-                                chunk,
-                                mut_list,
-                                &mut col,
-                                row as i32,
-                                Some(true),
-                            );
-                        }
-                    } else if col > 31 {
-                        if chars.peek().is_some() {
-                            gst::warning!(
-                                CAT,
-                                imp: self,
-                                "Dropping characters after 32nd column: {}",
-                                c
-                            );
+                    *col += 1;
+
+                    /* In roll-up mode, we introduce carriage returns automatically.
+                     * Instead of always wrapping once the last column is reached, we
+                     * want to look ahead and check whether the following word will fit
+                     * on the current row. If it won't, we insert a carriage return,
+                     * unless it won't fit on a full row either, in which case it will need
+                     * to be broken up.
+                     */
+                    let next_word_length = if c.is_ascii_whitespace() {
+                        self.peek_word_length(chars.clone())
+                    } else {
+                        0
+                    };
+
+                    if (next_word_length <= 32 - origin_column && *col + next_word_length > 31)
+                        || *col > 31
+                    {
+                        if prev_char != 0 {
+                            state.cc_data(self, mut_list, prev_char);
+                            prev_char = 0;
                         }
-                        break;
+
+                        self.open_line(
+                            state,
+                            settings,
+                            chunk,
+                            mut_list,
+                            col,
+                            row as i32,
+                            Some(true),
+                        );
                     }
                 }
             }
@@ -724,6 +792,128 @@ impl TtToCea608 {
         if prev_char != 0 {
             state.cc_data(self, mut_list, prev_char);
         }
+    }
+
+    fn generate(
+        &self,
+        mut state: &mut State,
+        settings: &Settings,
+        pts: gst::ClockTime,
+        duration: gst::ClockTime,
+        lines: Lines,
+    ) -> Result<gst::BufferList, gst::FlowError> {
+        let origin_column = settings.origin_column;
+        let mut bufferlist = gst::BufferList::new();
+        let mut_list = bufferlist.get_mut().unwrap();
+
+        let mut col = if state.mode == Cea608Mode::PopOn || state.mode == Cea608Mode::PaintOn {
+            0
+        } else {
+            state.column
+        };
+
+        let (fps_n, fps_d) = (
+            state.framerate.numer() as u64,
+            state.framerate.denom() as u64,
+        );
+
+        let frame_no = pts.mul_div_round(fps_n, fps_d).unwrap().seconds();
+
+        if state.last_frame_no == 0 {
+            gst::debug!(CAT, imp: self, "Initial skip to frame no {}", frame_no);
+            state.last_frame_no = pts.mul_div_floor(fps_n, fps_d).unwrap().seconds();
+        }
+
+        state.max_frame_no = (pts + duration)
+            .mul_div_round(fps_n, fps_d)
+            .unwrap()
+            .seconds();
+
+        state.pad(self, mut_list, frame_no);
+
+        let mut cleared = false;
+        if let Some(mode) = lines.mode {
+            if mode != state.mode {
+                /* Always erase the display when going to or from pop-on */
+                if state.mode == Cea608Mode::PopOn || mode == Cea608Mode::PopOn {
+                    state.erase_display_frame_no = None;
+                    state.erase_display_memory(self, mut_list);
+                    cleared = true;
+                }
+
+                state.mode = mode;
+                match state.mode {
+                    Cea608Mode::RollUp2 | Cea608Mode::RollUp3 | Cea608Mode::RollUp4 => {
+                        state.send_roll_up_preamble = true;
+                    }
+                    _ => col = origin_column,
+                }
+            }
+        }
+
+        if let Some(clear) = lines.clear {
+            if clear && !cleared {
+                state.erase_display_frame_no = None;
+                state.erase_display_memory(self, mut_list);
+                if state.mode != Cea608Mode::PopOn && state.mode != Cea608Mode::PaintOn {
+                    state.send_roll_up_preamble = true;
+                }
+                col = origin_column;
+            }
+        }
+
+        if state.mode == Cea608Mode::PopOn {
+            state.resume_caption_loading(self, mut_list);
+            state.cc_data(self, mut_list, erase_non_displayed_memory());
+        } else if state.mode == Cea608Mode::PaintOn {
+            state.resume_direct_captioning(self, mut_list);
+        }
+
+        let key = EncodedKey {
+            lines: lines.lines,
+            mode: state.mode,
+            origin_column,
+            column: col,
+            style: state.style,
+            underline: state.underline,
+            send_roll_up_preamble: state.send_roll_up_preamble,
+        };
+
+        /* In roll-up mode, erasing the display in the middle of the cue changes
+         * how the following lines are encoded */
+        if state.mode.is_rollup() && state.erase_display_frame_no.is_some() {
+            self.encode_lines(state, settings, mut_list, &key.lines, &mut col);
+        } else {
+            let mut cache = mem::take(&mut state.encoded_cache);
+
+            if let Some(encoded) = cache.get(&key) {
+                gst::log!(CAT, imp: self, "Using cached cc_data for {:?}", key.lines);
+
+                for cc_data in &encoded.cc_data {
+                    state.cc_data(self, mut_list, *cc_data);
+                }
+
+                col = encoded.column;
+                state.style = encoded.style;
+                state.underline = encoded.underline;
+                state.send_roll_up_preamble = encoded.send_roll_up_preamble;
+            } else {
+                state.encoded = Some(Vec::new());
+                self.encode_lines(state, settings, mut_list, &key.lines, &mut col);
+
+                let encoded = Encoded {
+                    cc_data: state.encoded.take().unwrap(),
+                    column: col,
+                    style: state.style,
+                    underline: state.underline,
+                    send_roll_up_preamble: state.send_roll_up_preamble,
+                    last_used: 0,
+                };
+                cache.insert(key, encoded);
+            }
+
+            state.encoded_cache = cache;
+        }
 
         if state.mode == Cea608Mode::PopOn {
             /* No need to erase the display at this point, end_of_caption will be equivalent */
@@ -1027,6 +1217,11 @@ impl ObjectImpl for TtToCea608 {
                     .default_value(u64::MAX)
                     .mutable_playing()
                     .build(),
+                glib::ParamSpecBoxed::builder::<gst::Structure>("stats")
+                    .nick("Statistics")
+                    .blurb("Statistics of the cache of encoded cues")
+                    .read_only()
+                    .build(),
             ]
         });
 
@@ -1099,6 +1294,18 @@ impl ObjectImpl for TtToCea608 {
                     u64::MAX.to_value()
                 }
             }
+            "stats" => {
+                let state = self.state.lock().unwrap();
+                let cache = &state.encoded_cache;
+
+                gst::Structure::builder("application/x-tttocea608-stats")
+                    .field("cache-hits", cache.hits)
+                    .field("cache-misses", cache.misses)
+                    .field("cache-hit-rate", cache.hit_rate())
+                    .field("cache-size", cache.entries.len() as u32)
+                    .build()
+                    .to_value()
+            }
             _ => unimplemented!(),
         }
     }
@@ -1202,3 +1409,72 @@ impl ElementImpl for TtToCea608 {
         Ok(ret)
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn encode(text: &str) -> Vec<u16> {
+        let mut cc_data = Vec::new();
+        eia608_from_utf8_string(text, &mut cc_data);
+        cc_data
+    }
+
+    #[test]
+    fn test_eia608_from_utf8_string() {
+        // Pairs of basic North American characters, the last one alone
+        assert_eq!(encode("Hi"), [0xc8e9]);
+        assert_eq!(encode("Hi!"), [0xc8e9, 0xa180]);
+
+        // A space for the western european character to replace, paired with the previous
+        // character if any
+        assert_eq!(encode("AÜ"), [0xc120, 0x92a4]);
+        assert_eq!(encode("HiÜ"), [0xc8e9, 0x2080, 0x92a4]);
+
+        // Special characters stop the pairing
+        assert_eq!(encode("A♪B"), [0xc180, 0x9137, 0xc280]);
+
+        // Characters without encoding and invalid bytes are spaces
+        assert_eq!(encode("中"), [0x2080]);
+        assert_eq!(encode("A\0B"), [0xc120, 0xc280]);
+        let mut cc_data = [0; 6];
+        let len = unsafe {
+            ffi::eia608_from_utf8_string(b"A\xffB\0".as_ptr() as *const _, 0, cc_data.as_mut_ptr())
+        };
+        assert_eq!(&cc_data[..len], [0xc120, 0xc280]);
+
+        // Same words as encoding the characters one by one
+        let text = "Élan, façade & «naïve» ♪";
+        let mut expected = Vec::new();
+        let mut prev_char = 0;
+        for c in text.chars() {
+            let mut encoded = [0; 5];
+            c.encode_utf8(&mut encoded);
+            let cc_data = match eia608_from_utf8_1(&encoded) {
+                0 => *SPACE,
+                cc_data => cc_data,
+            };
+
+            if is_basicna(prev_char) {
+                if is_basicna(cc_data) {
+                    expected.push(eia608_from_basicna(prev_char, cc_data));
+                } else if is_westeu(cc_data) {
+                    expected.extend([eia608_from_basicna(prev_char, *SPACE), cc_data]);
+                } else {
+                    expected.extend([prev_char, cc_data]);
+                }
+                prev_char = 0;
+            } else if is_westeu(cc_data) {
+                expected.extend([*SPACE, cc_data]);
+            } else if is_basicna(cc_data) {
+                prev_char = cc_data;
+            } else {
+                expected.push(cc_data);
+            }
+        }
+        if prev_char != 0 {
+            expected.push(prev_char);
+        }
+        assert_eq!(encode(text), expected);
+    }
+}
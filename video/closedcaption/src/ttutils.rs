@@ -6,8 +6,11 @@
 //
 // SPDX-License-Identifier: MPL-2.0
 
+use crate::caption_frame::Channel;
 use gst::glib;
+use gst::prelude::*;
 use serde::{Deserialize, Serialize};
+use std::sync::Mutex;
 
 #[derive(
     Serialize, Deserialize, Debug, Eq, PartialEq, Ord, PartialOrd, Hash, Clone, Copy, glib::Enum,
@@ -22,7 +25,7 @@ pub enum Cea608Mode {
     RollUp4,
 }
 
-#[derive(Clone, Copy, Serialize, Deserialize, Debug, PartialEq, Eq)]
+#[derive(Clone, Copy, Serialize, Deserialize, Debug, PartialEq, Eq, Hash)]
 pub enum TextStyle {
     White,
     Green,
@@ -51,14 +54,14 @@ impl From<u32> for TextStyle {
 }
 
 // TODO allow indenting chunks
-#[derive(Clone, Serialize, Deserialize, Debug)]
+#[derive(Clone, Serialize, Deserialize, Debug, PartialEq, Eq, Hash)]
 pub struct Chunk {
     pub style: TextStyle,
     pub underline: bool,
     pub text: String,
 }
 
-#[derive(Clone, Serialize, Deserialize, Debug)]
+#[derive(Clone, Serialize, Deserialize, Debug, PartialEq, Eq, Hash)]
 pub struct Line {
     pub column: Option<u32>,
     pub row: Option<u32>,
@@ -80,3 +83,124 @@ impl Cea608Mode {
         *self == Cea608Mode::RollUp2 || *self == Cea608Mode::RollUp3 || *self == Cea608Mode::RollUp4
     }
 }
+
+// The source pads of the caption channels of an element and their flow combiner. CC1 goes
+// to the always src pad, the src_%s pads of CC2 to CC4 are added on their first output
+pub struct ChannelSrcPads {
+    srcpad: gst::Pad,
+    pads: Mutex<[Option<gst::Pad>; 3]>,
+    flow_combiner: Mutex<gst_base::UniqueFlowCombiner>,
+}
+
+impl ChannelSrcPads {
+    pub fn new(srcpad: &gst::Pad) -> Self {
+        let mut flow_combiner = gst_base::UniqueFlowCombiner::new();
+        flow_combiner.add_pad(srcpad);
+
+        ChannelSrcPads {
+            srcpad: srcpad.clone(),
+            pads: Mutex::new(Default::default()),
+            flow_combiner: Mutex::new(flow_combiner),
+        }
+    }
+
+    // The pad of a channel, if it exists already
+    pub fn get(&self, channel: Channel) -> Option<gst::Pad> {
+        if channel == Channel::Cc1 {
+            Some(self.srcpad.clone())
+        } else {
+            self.pads.lock().unwrap()[channel.index() - 1].clone()
+        }
+    }
+
+    // The pad of a channel, added to `element` with the sticky events of `sinkpad` if needed
+    pub fn get_or_add(
+        &self,
+        element: &gst::Element,
+        sinkpad: &gst::Pad,
+        channel: Channel,
+    ) -> gst::Pad {
+        if channel == Channel::Cc1 {
+            return self.srcpad.clone();
+        }
+
+        let mut pads = self.pads.lock().unwrap();
+        if let Some(srcpad) = &pads[channel.index() - 1] {
+            return srcpad.clone();
+        }
+
+        let name = format!("src_{}", channel.name());
+        let templ = element.element_class().pad_template("src_%s").unwrap();
+        let srcpad = gst::Pad::builder_with_template(&templ, Some(&name))
+            .flags(gst::PadFlags::FIXED_CAPS)
+            .build();
+
+        // The sticky events of the sink pad, with the caps of the CC1 pad and a stream id of
+        // the channel
+        let stream_id = srcpad.create_stream_id(element, Some(channel.name()));
+        let caps = self.srcpad.current_caps();
+        let mut events = Vec::new();
+        sinkpad.sticky_events_foreach(|ev| {
+            match ev.type_() {
+                gst::EventType::StreamStart => {
+                    events.push(gst::event::StreamStart::new(&stream_id));
+                }
+                gst::EventType::Caps => {
+                    if let Some(caps) = &caps {
+                        events.push(gst::event::Caps::new(caps));
+                    }
+                }
+                _ => events.push(ev.clone()),
+            }
+
+            std::ops::ControlFlow::Continue(gst::EventForeachAction::Keep)
+        });
+
+        let _ = srcpad.set_active(true);
+        for ev in events {
+            let _ = srcpad.store_sticky_event(&ev);
+        }
+
+        pads[channel.index() - 1] = Some(srcpad.clone());
+        drop(pads);
+
+        self.flow_combiner.lock().unwrap().add_pad(&srcpad);
+        element.add_pad(&srcpad).unwrap();
+
+        srcpad
+    }
+
+    // Pushes a buffer on the pad of a channel, adding it if needed, and combines the flow
+    // return with the ones of the other pads
+    pub fn push(
+        &self,
+        element: &gst::Element,
+        sinkpad: &gst::Pad,
+        channel: Channel,
+        buffer: gst::Buffer,
+    ) -> Result<gst::FlowSuccess, gst::FlowError> {
+        let srcpad = self.get_or_add(element, sinkpad, channel);
+        let res = srcpad.push(buffer);
+
+        self.flow_combiner
+            .lock()
+            .unwrap()
+            .update_pad_flow(&srcpad, res)
+    }
+
+    pub fn reset_flow(&self) {
+        self.flow_combiner.lock().unwrap().reset();
+    }
+
+    // Removes the pads of CC2 to CC4 from `element`
+    pub fn remove(&self, element: &gst::Element) {
+        let pads = std::mem::take(&mut *self.pads.lock().unwrap());
+
+        let mut flow_combiner = self.flow_combiner.lock().unwrap();
+        for srcpad in pads.into_iter().flatten() {
+            flow_combiner.remove_pad(&srcpad);
+            let _ = element.remove_pad(&srcpad);
+        }
+        flow_combiner.reset();
+    }
+}
@@ -168,11 +168,11 @@ fn test_have_cdp_notify() {
         0xfc, 0x80, 0x81, /* cc_data triple */
         0x74, /* cdp end of frame byte header */
         0x00, 0x00, /* sequence counter */
-        0x60, /* checksum */
+        0x5b, /* checksum */
     ];
     let invalid_cc608_data = vec![
         0x96, 0x69, 0x10, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xe1, 0xf8, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0x5d,
     ];
 
     let mut h = gst_check::Harness::new("ccdetect");
@@ -209,31 +209,35 @@ fn test_malformed_cdp_notify() {
     let too_short = vec![0x96, 0x69];
     let wrong_magic = vec![
         0x00, 0x00, 0x10, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xe1, 0xfc, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0x58,
     ];
     let length_too_long = vec![
         0x96, 0x69, 0x20, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xe1, 0xfc, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0x49,
     ];
     let length_too_short = vec![
         0x96, 0x69, 0x00, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xe1, 0xfc, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0x69,
     ];
     let wrong_cc_data_header_byte = vec![
         0x96, 0x69, 0x10, 0x8f, 0x43, 0x00, 0x00, 0xff, 0xe1, 0xfc, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0xcc,
     ];
     let big_cc_count = vec![
         0x96, 0x69, 0x10, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xef, 0xfc, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0x4b,
     ];
     let wrong_cc_count_reserved_bits = vec![
         0x96, 0x69, 0x10, 0x8f, 0x43, 0x00, 0x00, 0x72, 0x01, 0xfc, 0x81, 0x82, 0x74, 0x00, 0x00,
-        0x60,
+        0x39,
     ];
     let cc608_after_cc708 = vec![
         0x96, 0x69, 0x13, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xe2, 0xfe, 0x81, 0x82, 0xfc, 0x83, 0x84,
-        0x74, 0x00, 0x00, 0x60,
+        0x74, 0x00, 0x00, 0x50,
+    ];
+    let wrong_checksum = vec![
+        0x96, 0x69, 0x10, 0x8f, 0x43, 0x00, 0x00, 0x72, 0xe1, 0xfc, 0x80, 0x81, 0x74, 0x00, 0x00,
+        0x60,
     ];
 
     let mut h = gst_check::Harness::new("ccdetect");
@@ -273,6 +277,7 @@ fn test_malformed_cdp_notify() {
         0
     );
     assert_push_data!(h, state, cc608_after_cc708, 7_000.nseconds(), 0, 0);
+    assert_push_data!(h, state, wrong_checksum, 8_000.nseconds(), 0, 0);
 }
 
 #[test]
@@ -0,0 +1,138 @@
+// This Source Code Form is subject to the terms of the Mozilla Public License, v2.0.
+// If a copy of the MPL was not distributed with this file, You can obtain one at
+// <https://mozilla.org/MPL/2.0/>.
+//
+// SPDX-License-Identifier: MPL-2.0
+
+use gst::prelude::*;
+use gst::ClockTime;
+use std::sync::{Arc, Mutex};
+
+use pretty_assertions::assert_eq;
+
+fn init() {
+    use std::sync::Once;
+    static INIT: Once = Once::new();
+
+    INIT.call_once(|| {
+        gst::init().unwrap();
+        gstrsclosedcaption::plugin_register_static().unwrap();
+    });
+}
+
+// An unbuffered cea608tojson harness, and the buffers output on the pad of a caption channel,
+// which is added when its first lines are output, before pushing them
+fn new_harness(
+    format: &str,
+    channel_pad: &'static str,
+) -> (gst_check::Harness, Arc<Mutex<Vec<gst::Buffer>>>) {
+    let element = gst::ElementFactory::make("cea608tojson")
+        .property("unbuffered", true)
+        .build()
+        .unwrap();
+    let mut h = gst_check::Harness::with_element(&element, Some("sink"), Some("src"));
+    h.set_src_caps_str(&format!("closedcaption/x-cea-608, format={}", format));
+    h.set_sink_caps_str("application/x-json");
+
+    let channel_buffers = Arc::new(Mutex::new(Vec::<gst::Buffer>::new()));
+    let buffers = channel_buffers.clone();
+    element.connect_pad_added(move |_, pad| {
+        assert_eq!(pad.name(), channel_pad);
+
+        let buffers = buffers.clone();
+        pad.add_probe(gst::PadProbeType::BUFFER, move |_, probe_info| {
+            if let Some(gst::PadProbeData::Buffer(ref buffer)) = probe_info.data {
+                buffers.lock().unwrap().push(buffer.clone());
+            }
+
+            gst::PadProbeReturn::Ok
+        });
+    });
+
+    (h, channel_buffers)
+}
+
+fn push(h: &mut gst_check::Harness, i: u64, data: &[u8]) {
+    let mut buf = gst::Buffer::from_slice(data.to_vec());
+    {
+        let buf = buf.get_mut().unwrap();
+        buf.set_pts(ClockTime::from_seconds(i));
+        buf.set_duration(ClockTime::SECOND);
+    }
+    assert_eq!(h.push(buf), Ok(gst::FlowSuccess::Ok));
+}
+
+// The text of the lines of every buffer that has some
+fn texts<'a>(buffers: impl IntoIterator<Item = &'a gst::Buffer>) -> Vec<String> {
+    buffers
+        .into_iter()
+        .filter_map(|buffer| {
+            let lines: serde_json::Value =
+                serde_json::from_slice(&buffer.map_readable().unwrap()).unwrap();
+            let text = lines["lines"]
+                .as_array()
+                .unwrap()
+                .iter()
+                .flat_map(|line| line["chunks"].as_array().unwrap())
+                .map(|chunk| chunk["text"].as_str().unwrap())
+                .collect::<String>();
+            (!text.is_empty()).then_some(text)
+        })
+        .collect()
+}
+
+#[test]
+fn test_channels() {
+    init();
+
+    let (mut h, cc2_buffers) = new_harness("raw", "src_cc2");
+
+    // Resume caption loading, "Hi" and end of caption on CC2
+    for (i, cc_data) in [[0x1c, 0x20], [0xc8, 0xe9], [0x1c, 0x2f]]
+        .iter()
+        .enumerate()
+    {
+        push(&mut h, i as u64, cc_data);
+    }
+
+    // Nothing is output for CC1
+    assert!(h.try_pull().is_none());
+
+    let buffers = cc2_buffers.lock().unwrap();
+    assert_eq!(texts(&*buffers), ["Hi"]);
+    assert_eq!(
+        buffers.last().unwrap().pts(),
+        Some(ClockTime::from_seconds(2))
+    );
+}
+
+#[test]
+fn test_s334_1a_channels() {
+    init();
+
+    let (mut h, cc3_buffers) = new_harness("s334-1a", "src_cc3");
+
+    // Resume caption loading, "Hi" and end of caption on CC1 in field 1, "Yo" on the
+    // first channel of field 2
+    for (i, (field1, field2)) in [
+        ([0x94, 0x20], [0x94, 0x20]),
+        ([0xc8, 0xe9], [0xd9, 0xef]),
+        ([0x94, 0x2f], [0x94, 0x2f]),
+    ]
+    .iter()
+    .enumerate()
+    {
+        push(
+            &mut h,
+            i as u64,
+            &[0x80, field1[0], field1[1], 0x01, field2[0], field2[1]],
+        );
+    }
+
+    let mut cc1_buffers = Vec::new();
+    while let Some(buffer) = h.try_pull() {
+        cc1_buffers.push(buffer);
+    }
+    assert_eq!(texts(&cc1_buffers), ["Hi"]);
+    assert_eq!(texts(&*cc3_buffers.lock().unwrap()), ["Yo"]);
+}
@@ -8,6 +8,7 @@
 
 use gst::prelude::*;
 use gst::ClockTime;
+use std::sync::{Arc, Mutex};
 
 use pretty_assertions::assert_eq;
 
@@ -91,3 +92,91 @@ fn test_parse() {
             .build()
     );
 }
+
+// Collects the buffers of the pad of a caption channel, which is added when its first
+// caption is output, before pushing it
+fn channel_buffers(element: &gst::Element, name: &'static str) -> Arc<Mutex<Vec<gst::Buffer>>> {
+    let channel_buffers = Arc::new(Mutex::new(Vec::<gst::Buffer>::new()));
+    let buffers = channel_buffers.clone();
+    element.connect_pad_added(move |_, pad| {
+        assert_eq!(pad.name(), name);
+
+        let buffers = buffers.clone();
+        pad.add_probe(gst::PadProbeType::BUFFER, move |_, probe_info| {
+            if let Some(gst::PadProbeData::Buffer(ref buffer)) = probe_info.data {
+                buffers.lock().unwrap().push(buffer.clone());
+            }
+
+            gst::PadProbeReturn::Ok
+        });
+    });
+
+    channel_buffers
+}
+
+#[test]
+fn test_channels() {
+    init();
+
+    let element = gst::ElementFactory::make("cea608tott").build().unwrap();
+    let mut h = gst_check::Harness::with_element(&element, Some("sink"), Some("src"));
+    h.set_src_caps_str("closedcaption/x-cea-608, format=raw");
+    h.set_sink_caps_str("text/x-raw");
+
+    let cc2_buffers = channel_buffers(&element, "src_cc2");
+
+    // Resume caption loading, "Hi", end of caption and erase displayed memory on CC2
+    for (i, cc_data) in [[0x1c, 0x20], [0xc8, 0xe9], [0x1c, 0x2f], [0x1c, 0x2c]]
+        .iter()
+        .enumerate()
+    {
+        let mut buf = gst::Buffer::from_mut_slice(*cc_data);
+        buf.get_mut()
+            .unwrap()
+            .set_pts(ClockTime::from_seconds(i as u64));
+        assert_eq!(h.push(buf), Ok(gst::FlowSuccess::Ok));
+    }
+
+    // Nothing is output for CC1
+    assert!(h.try_pull().is_none());
+
+    let buffers = cc2_buffers.lock().unwrap();
+    assert_eq!(buffers.len(), 1);
+    assert_eq!(buffers[0].pts(), Some(ClockTime::from_seconds(2)));
+    assert_eq!(buffers[0].duration(), Some(ClockTime::from_seconds(1)));
+    assert_eq!(&*buffers[0].map_readable().unwrap(), b"Hi");
+}
+
+#[test]
+fn test_s334_1a_channels() {
+    init();
+
+    let element = gst::ElementFactory::make("cea608tott").build().unwrap();
+    let mut h = gst_check::Harness::with_element(&element, Some("sink"), Some("src"));
+    h.set_src_caps_str("closedcaption/x-cea-608, format=s334-1a");
+    h.set_sink_caps_str("text/x-raw");
+
+    let cc3_buffers = channel_buffers(&element, "src_cc3");
+
+    // Padding on field 1, and resume caption loading, "Hi", end of caption and erase
+    // displayed memory on the first channel of field 2
+    for (i, cc_data) in [[0x94, 0x20], [0xc8, 0xe9], [0x94, 0x2f], [0x94, 0x2c]]
+        .iter()
+        .enumerate()
+    {
+        let mut buf = gst::Buffer::from_mut_slice([0x80, 0x80, 0x80, 0x01, cc_data[0], cc_data[1]]);
+        buf.get_mut()
+            .unwrap()
+            .set_pts(ClockTime::from_seconds(i as u64));
+        assert_eq!(h.push(buf), Ok(gst::FlowSuccess::Ok));
+    }
+
+    // Nothing is output for CC1
+    assert!(h.try_pull().is_none());
+
+    let buffers = cc3_buffers.lock().unwrap();
+    assert_eq!(buffers.len(), 1);
+    assert_eq!(buffers[0].pts(), Some(ClockTime::from_seconds(2)));
+    assert_eq!(buffers[0].duration(), Some(ClockTime::from_seconds(1)));
+    assert_eq!(&*buffers[0].map_readable().unwrap(), b"Hi");
+}
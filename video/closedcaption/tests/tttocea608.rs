@@ -176,6 +176,62 @@ fn test_erase_display_memory_non_spliced() {
     assert_eq!(erase_display_buffers, 1);
 }
 
+/* Here we test that a repeated caption is taken from the cache
+ * of encoded cues and only retimed
+ */
+#[test]
+fn test_repeated_caption() {
+    init();
+
+    let mut h = gst_check::Harness::new_parse("tttocea608 mode=pop-on");
+    h.set_src_caps_str("text/x-raw");
+
+    while h.events_in_queue() != 0 {
+        let _event = h.pull_event().unwrap();
+    }
+
+    let inbuf = new_timed_buffer("Hello", 1_000_000_000.nseconds(), ClockTime::SECOND);
+    assert_eq!(h.push(inbuf), Ok(gst::FlowSuccess::Ok));
+
+    let inbuf = new_timed_buffer("Hello", 3_000_000_000.nseconds(), ClockTime::SECOND);
+    assert_eq!(h.push(inbuf), Ok(gst::FlowSuccess::Ok));
+
+    let mut cc_data = Vec::new();
+    while h.buffers_in_queue() > 0 {
+        let outbuf = h.pull().unwrap();
+        let data = outbuf.map_readable().unwrap();
+        if &*data != [0x80, 0x80] {
+            cc_data.push((outbuf.pts().unwrap(), [data[0], data[1]]));
+        }
+    }
+
+    let caption: [[u8; 2]; 7] = [
+        [0x94, 0x20], /* resume_caption_loading */
+        [0x94, 0xae], /* erase_non_displayed_memory */
+        [0x94, 0x70], /* preamble */
+        [0xc8, 0xe5], /* H e */
+        [0xec, 0xec], /* l l */
+        [0xef, 0x80], /* o, nil */
+        [0x94, 0x2f], /* end_of_caption */
+    ];
+    let mut expected = caption.to_vec();
+    expected.push([0x94, 0x2c]); /* erase_display_memory */
+    expected.extend(caption);
+
+    assert_eq!(
+        cc_data.iter().map(|(_, data)| *data).collect::<Vec<_>>(),
+        expected
+    );
+    assert_eq!(cc_data[0].0, 1_000_000_000.nseconds());
+    assert_eq!(cc_data[8].0, 3_000_000_000.nseconds());
+
+    let stats = h.element().unwrap().property::<gst::Structure>("stats");
+    assert_eq!(stats.get::<u64>("cache-hits").unwrap(), 1);
+    assert_eq!(stats.get::<u64>("cache-misses").unwrap(), 1);
+    assert_eq!(stats.get::<u32>("cache-size").unwrap(), 1);
+    assert_eq!(stats.get::<f64>("cache-hit-rate").unwrap(), 0.5);
+}
+
 /* Here we test that the erase_display_memory control code
  * gets inserted while loading the following pop-on captions
  * when there's not enough of an interval between them.